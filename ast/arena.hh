@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*
+ * AST 节点使用的 bump-pointer 分配器
+ * 从大块内存中顺序切出节点, 单个节点的 delete 不归还内存, clear 时一次释放所有块
+ */
+class Arena
+{
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+  static constexpr size_t ALIGN = alignof(std::max_align_t);
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char *cur = nullptr;
+  size_t left = 0;
+
+public:
+  void *allocate(size_t size)
+  {
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    if (size > left)
+    {
+      size_t block_size = std::max(size, BLOCK_SIZE);
+      blocks.emplace_back(new char[block_size]);
+      cur = blocks.back().get();
+      left = block_size;
+    }
+    void *p = cur;
+    cur += size;
+    left -= size;
+    return p;
+  }
+
+  void clear()
+  {
+    blocks.clear();
+    cur = nullptr;
+    left = 0;
+  }
+};
@@ -5,3 +5,29 @@
 #include "decl_ast.hh"
 #include "func_ast.hh"
 #include "exp_ast.hh"
+
+#include <type_traits>
+
+// arena 释放时不会调用任何析构函数, 节点 (以及 List) 不能持有需要析构的成员
+static_assert(std::is_trivially_destructible_v<List>);
+static_assert(std::is_trivially_destructible_v<CompUnitAST>);
+static_assert(std::is_trivially_destructible_v<DeclAST>);
+static_assert(std::is_trivially_destructible_v<ConstDeclAST>);
+static_assert(std::is_trivially_destructible_v<BTypeAST>);
+static_assert(std::is_trivially_destructible_v<ConstDefAST>);
+static_assert(std::is_trivially_destructible_v<ConstInitValAST>);
+static_assert(std::is_trivially_destructible_v<VarDeclAST>);
+static_assert(std::is_trivially_destructible_v<VarDefAST>);
+static_assert(std::is_trivially_destructible_v<InitValAST>);
+static_assert(std::is_trivially_destructible_v<NumberAST>);
+static_assert(std::is_trivially_destructible_v<LValAST>);
+static_assert(std::is_trivially_destructible_v<UnaryExpAST>);
+static_assert(std::is_trivially_destructible_v<CallExpAST>);
+static_assert(std::is_trivially_destructible_v<FuncRParamsAST>);
+static_assert(std::is_trivially_destructible_v<BinaryExpAST>);
+static_assert(std::is_trivially_destructible_v<FuncDefAST>);
+static_assert(std::is_trivially_destructible_v<FuncTypeAST>);
+static_assert(std::is_trivially_destructible_v<FuncFParamsAST>);
+static_assert(std::is_trivially_destructible_v<FuncFParamAST>);
+static_assert(std::is_trivially_destructible_v<BlockAST>);
+static_assert(std::is_trivially_destructible_v<StmtAST>);
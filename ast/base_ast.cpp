@@ -1,8 +1,11 @@
 
 #include "base_ast.hh"
+Arena BaseAST::arena;
 var_index_t BaseAST::global_var_index = 0;
 var_index_t BaseAST::global_label_index = 0;
 var_index_t BaseAST::global_ptr_index = 0;
 SymbolTable BaseAST::symbol_table = SymbolTable();
-std::string BaseAST::ir = "decl @getint(): i32\ndecl @getch(): i32\ndecl @getarray(*i32): i32\ndecl @putint(i32)\ndecl @putch(i32)\ndecl @putarray(i32, *i32)\ndecl @starttime()\ndecl @stoptime()\n\n";
+KoopaBuilder BaseAST::builder;
+std::vector<koopa_raw_value_t> BaseAST::var_values;
+std::vector<koopa_raw_value_t> BaseAST::ptr_values;
 std::stack<var_index_t> BaseAST::loop_stack = std::stack<var_index_t>();
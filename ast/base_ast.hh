@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -7,9 +8,12 @@
 #include <assert.h>
 #include <unordered_map>
 #include <algorithm>
+#include "arena.hh"
 #include "sysbol_table.hh"
+#include "koopa_builder.hh"
 #include <stdarg.h>
 #include <functional>
+#include <string.h>
 
 enum class RetType
 {
@@ -25,21 +29,45 @@ enum class RetType
 struct RetValue
 {
   int number;
-  std::string ident;
+  Symbol ident;
   RetValue(int n) : number(n) {}
-  RetValue(std::string id) : ident(id) {}
+  RetValue(Symbol id) : ident(id) {}
   RetValue() {}
 };
 
+// 表达式中的运算符, lexer 直接给出; 一元的 "-" 和 "+" 也用 SUB 和 ADD 表示
+enum class ExpOp
+{
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  MOD,
+  LT,
+  GT,
+  LE,
+  GE,
+  EQ,
+  NE,
+  LAND,
+  LOR,
+  NOT
+};
+inline const char *opSpelling(ExpOp op)
+{
+  static const char *spellings[] = {"+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||", "!"};
+  return spellings[static_cast<int>(op)];
+}
+
 typedef std::pair<RetValue, RetType> ret_value_t;
 typedef uint64_t var_index_t;
 enum class ListType
 {
   CONSTDEF,
   VARDEF,
+  FUNCDEF,
   DECL,
   STMT,
-  BLOCKITEM,
   FUNCFPARAM,
   EXP,
   CONSTEXP,
@@ -56,11 +84,26 @@ public:
   // 符号表
   // static std::unordered_map<std::string, int> symbol_table;
   static SymbolTable symbol_table;
-  static std::string ir;
+  // 生成 Koopa raw program, %N 和 %ptrN 对应的值分别记录在 var_values 和 ptr_values 中
+  static KoopaBuilder builder;
+  static std::vector<koopa_raw_value_t> var_values;
+  static std::vector<koopa_raw_value_t> ptr_values;
   static std::stack<var_index_t> loop_stack;
 
+  // 所有节点都从 arena 中分配, 子节点和列表都是 arena 中的裸指针, 节点是平凡可析构的,
+  // 不需要逐个析构, 由 arena 统一释放
+  static Arena arena;
+
+protected:
+  // 不通过基类指针 delete 节点, 析构函数不是虚函数, 派生类因此可以是平凡可析构的
+  ~BaseAST() = default;
+
 public:
-  virtual ~BaseAST() = default;
+  static void *operator new(size_t size)
+  {
+    return arena.allocate(size);
+  }
+  static void operator delete(void *) {}
 
   virtual void Dump() const = 0;
   virtual bool isArray()
@@ -79,14 +122,13 @@ public:
     std::cerr << "calc not implemented\n";
     assert(0);
   }
-  virtual ret_value_t toIR(std::string &ir)
+  virtual ret_value_t toIR()
   {
-    std::cerr << "toIR not implemented\n\n"
-              << ir << "\n";
+    std::cerr << "toIR not implemented\n";
     assert(0);
   }
 
-  virtual void xx(std::string &ir)
+  virtual void xx()
   {
     std::cerr << "xx not implemented\n";
     assert(0);
@@ -106,530 +148,389 @@ public:
   {
     return "Node_" + std::to_string(reinterpret_cast<std::uintptr_t>(this));
   }
-  virtual std::string getIR(std::string op, ret_value_t ret1, ret_value_t ret2) const
+  // 把 toIR 返回的 ret_value_t 转换成 builder 中对应的值
+  static koopa_raw_value_t valueOf(const ret_value_t &ret)
   {
-    if (isEnd(ir))
-    {
-      return "";
-    }
-    std::string ir;
-    if (ret1.second == RetType::NUMBER)
-    {
-      if (ret2.second == RetType::NUMBER)
-      {
-        ir = "\t%" + std::to_string(global_var_index++) + " = " + op + " " + std::to_string(ret1.first.number) + ", " + std::to_string(ret2.first.number) + "\n";
-      }
-      else if (ret2.second == RetType::INDEX)
-      {
-        ir = "\t%" + std::to_string(global_var_index++) + " = " + op + " " + std::to_string(ret1.first.number) + ", %" + std::to_string(ret2.first.number) + "\n";
-      }
-      else
-      {
-        std::cerr << "getIR: unknown ret2 type\n";
-      }
-    }
-    else if (ret1.second == RetType::INDEX)
-    {
-      if (ret2.second == RetType::NUMBER)
-      {
-        ir = "\t%" + std::to_string(global_var_index++) + " = " + op + " %" + std::to_string(ret1.first.number) + ", " + std::to_string(ret2.first.number) + "\n";
-      }
-      else if (ret2.second == RetType::INDEX)
-      {
-        ir = "\t%" + std::to_string(global_var_index++) + " = " + op + " %" + std::to_string(ret1.first.number) + ", %" + std::to_string(ret2.first.number) + "\n";
-      }
-      else
-      {
-        std::cerr << "getIR: unknown ret2 type\n";
-      }
+    switch (ret.second)
+    {
+    case RetType::NUMBER:
+      return builder.integer(ret.first.number);
+    case RetType::INDEX:
+      return var_values[ret.first.number];
+    case RetType::IDENT:
+    case RetType::ARRAY:
+      return builder.symbol(symbol_table.getUniqueIdent(ret.first.ident));
+    case RetType::PTR:
+    case RetType::ARRAYPTR:
+    case RetType::ELEMENTPTR:
+      return ptr_values[ret.first.number];
+    default:
+      std::cerr << "valueOf: unknown ret type\n";
+      assert(0);
     }
-    else
+  }
+  // 记录新生成的 %N 和 %ptrN, 下标与 global_var_index / global_ptr_index 一致
+  static void newVar(koopa_raw_value_t value)
+  {
+    var_values.push_back(value);
+    global_var_index++;
+  }
+  static void newPtr(koopa_raw_value_t value)
+  {
+    ptr_values.push_back(value);
+    global_ptr_index++;
+  }
+  static koopa_raw_value_t indexOf(const ret_value_t &ret, const char *who)
+  {
+    if (ret.second != RetType::NUMBER && ret.second != RetType::INDEX)
     {
-      std::cerr << "getIR: unknown ret1 type\n";
+      std::cerr << who << ": unknown index type\n";
+      assert(0);
     }
-    return ir;
+    return valueOf(ret);
   }
-  virtual std::string storeIR(ret_value_t ret1, ret_value_t ret2) const
+
+  virtual void getIR(std::string op, ret_value_t ret1, ret_value_t ret2) const
   {
-    if (isEnd(ir))
+    if (isEnd())
     {
-      return "";
+      return;
     }
-    std::string ir;
-    // ret2.second must be INDENT or PTR
-    if (ret1.second == RetType::NUMBER)
+    if (ret1.second != RetType::NUMBER && ret1.second != RetType::INDEX)
     {
-      if (ret2.second == RetType::IDENT)
-        ir = "\tstore " + std::to_string(ret1.first.number) + ", @" + symbol_table.getUniqueIdent(ret2.first.ident) + "\n";
-      else
-        ir = "\tstore " + std::to_string(ret1.first.number) + ", %ptr" + std::to_string(ret2.first.number) + "\n";
+      std::cerr << "getIR: unknown ret1 type\n";
+      assert(0);
     }
-    else if (ret1.second == RetType::INDEX)
+    if (ret2.second != RetType::NUMBER && ret2.second != RetType::INDEX)
     {
-      if (ret2.second == RetType::IDENT)
-        ir = "\tstore %" + std::to_string(ret1.first.number) + ", @" + symbol_table.getUniqueIdent(ret2.first.ident) + "\n";
-      else
-        ir = "\tstore %" + std::to_string(ret1.first.number) + ", %ptr" + std::to_string(ret2.first.number) + "\n";
+      std::cerr << "getIR: unknown ret2 type\n";
+      assert(0);
     }
-    else if (ret1.second == RetType::IDENT)
+    newVar(builder.binary(op, valueOf(ret1), valueOf(ret2)));
+  }
+  virtual void storeIR(ret_value_t ret1, ret_value_t ret2) const
+  {
+    if (isEnd())
     {
-      if (ret2.second == RetType::IDENT)
-        ir = "\tstore @" + symbol_table.getUniqueIdent(ret1.first.ident) + ", @" + symbol_table.getUniqueIdent(ret2.first.ident) + "\n";
-      else
-        ir = "\tstore @" + symbol_table.getUniqueIdent(ret1.first.ident) + ", %ptr" + std::to_string(ret2.first.number) + "\n";
+      return;
     }
-    else
+    // ret2.second must be INDENT or PTR
+    if (ret1.second != RetType::NUMBER && ret1.second != RetType::INDEX && ret1.second != RetType::IDENT)
     {
       std::cerr << "storeIR: unknown ret1 type\n";
       assert(0);
     }
-    return ir;
+    koopa_raw_value_t dest = ret2.second == RetType::IDENT ? valueOf(ret2) : ptr_values[ret2.first.number];
+    builder.store(valueOf(ret1), dest);
   }
-  virtual std::string loadIR(ret_value_t ret) const
+  virtual void loadIR(ret_value_t ret) const
   {
-    if (isEnd(ir))
-    {
-      return "";
-    }
-    std::string ir;
-    if (ret.second == RetType::IDENT)
+    if (isEnd())
     {
-      ir = "\t%" + std::to_string(global_var_index++) + " = load @" + symbol_table.getUniqueIdent(ret.first.ident) + "\n";
+      return;
     }
-    else if (ret.second == RetType::PTR)
+    if (ret.second == RetType::IDENT || ret.second == RetType::PTR || ret.second == RetType::ELEMENTPTR)
     {
-      ir = "\t%" + std::to_string(global_var_index++) + " = load %ptr" + std::to_string(ret.first.number) + "\n";
+      newVar(builder.load(valueOf(ret)));
     }
     else if (ret.second == RetType::ARRAYPTR)
     {
-      ir += "\t%ptr" + std::to_string(global_ptr_index++) + " = load @" + symbol_table.getUniqueIdent(ret.first.ident) + "\n";
-    }
-    else if (ret.second == RetType::ELEMENTPTR)
-    {
-      ir += "\t%" + std::to_string(global_var_index++) + " = load %ptr" + std::to_string(ret.first.number) + "\n";
+      // 数组参数: 从 alloc 出的 **i32 中取出指针
+      newPtr(builder.load(builder.symbol(symbol_table.getUniqueIdent(ret.first.ident))));
     }
     else
     {
       std::cerr << "loadIR: unknown ret type\n";
       assert(0);
     }
-    return ir;
   }
 
-  virtual std::string brIR(ret_value_t ret, std::string label1, std::string label2) const
+  virtual void brIR(ret_value_t ret, std::string label1, std::string label2) const
   {
-    if (isEnd(ir))
+    if (isEnd())
     {
-      return "";
+      return;
     }
-    std::string ir;
-    if (ret.second == RetType::NUMBER)
-    {
-      ir = "\tbr " + std::to_string(ret.first.number) + ", %" + label1 + ", %" + label2 + "\n";
-    }
-    else if (ret.second == RetType::INDEX)
-    {
-      ir = "\tbr %" + std::to_string(ret.first.number) + ", %" + label1 + ", %" + label2 + "\n";
-    }
-    else
+    if (ret.second != RetType::NUMBER && ret.second != RetType::INDEX)
     {
       std::cerr << "brIR: unknown ret type\n";
       assert(0);
     }
-    return ir;
-  }
-  virtual std::string labelIR(std::string label) const
-  {
-    return "%" + label + ":\n";
+    builder.branch(valueOf(ret), builder.block(label1), builder.block(label2));
   }
-  virtual std::string jumpIR(std::string label) const
+  virtual void labelIR(std::string label) const
   {
-    if (isEnd(ir))
-    {
-      return "";
-    }
-    return "\tjump %" + label + "\n";
+    builder.label(label);
   }
-
-  virtual std::string get_last_instruction(std::string &ir) const
+  virtual void jumpIR(std::string label) const
   {
-    // 从最后一个换行符开始向前找倒数第二个换行符
-    size_t last_newline = ir.find_last_of('\n');
-    if (last_newline == std::string::npos || last_newline == 0)
+    if (isEnd())
     {
-      // 如果没有找到换行符或者只有一个换行符，则说明没有有效的指令
-      return "";
+      return;
     }
-
-    size_t second_last_newline = ir.find_last_of('\n', last_newline - 1);
-    if (second_last_newline == std::string::npos)
-    {
-      // 如果找不到倒数第二个换行符，说明只有一行指令
-      second_last_newline = 0;
-    }
-    else
-    {
-      // 否则将第二个换行符位置移到下一个字符，开始提取最后一条指令
-      second_last_newline += 1;
-    }
-
-    // 提取最后一条指令
-    std::string last_instruction = ir.substr(second_last_newline, last_newline - second_last_newline);
-    last_instruction.erase(std::remove_if(last_instruction.begin(), last_instruction.end(), ::isspace), last_instruction.end());
-    return last_instruction;
+    builder.jump(builder.block(label));
   }
 
-  // 为了防止在生成 IR 时在终止指令（ret、br、jump）之后还有其他指令，我们需要从ir中提取出最后一条指令，当前ir的最后一个字符一定是换行符(即倒数第二个换行符后到最后一个换行符之间的内容)，并返回是否是终止指令（bool)
-  virtual bool isEnd(std::string &ir, int option = 0) const
+  // 为了防止在生成 IR 时在终止指令（ret、br、jump）之后还有其他指令，检查当前基本块的最后一条指令是否是终止指令
+  virtual bool isEnd(int option = 0) const
   { // option = 0 表示检查是否是终止指令，option = 1 表示检查是否是ret指令, option = 2 表示检查ret指令是否有返回值
-    // 获取最后一条指令
-    std::string last_instruction = get_last_instruction(ir);
-
-    // 检查是否是ret指令
-    if (option == 1)
-    {
-      return last_instruction.compare(0, 3, "ret") == 0;
-    }
-    // 检查是否是ret指令且有返回值(可以通过ret指令的最后一个字符是否是数字来判断)
-    if (option == 2)
-    {
-      return last_instruction.compare(0, 3, "ret") == 0 && isdigit(last_instruction.back());
-    }
-
-    // 检查是否是终止指令
-    return (last_instruction.compare(0, 3, "ret") == 0) ||
-           (last_instruction.compare(0, 2, "br") == 0) ||
-           (last_instruction.compare(0, 4, "jump") == 0);
+    return builder.isEnd(option);
   }
 
   // args 是参数列表，默认为空
-  virtual std::string callIR(std::string &func_name, std::vector<ret_value_t> args = {}) const
+  virtual void callIR(Symbol func_name, std::vector<ret_value_t> args = {}) const
   {
-    if (isEnd(ir))
+    if (isEnd())
     {
-      return "";
+      return;
     }
-    std::string ir;
+    std::vector<koopa_raw_value_t> values;
+    for (auto &arg : args)
+    {
+      if (arg.second == RetType::VOID)
+      {
+        std::cerr << "callIR: unknown arg type\n";
+        assert(0);
+      }
+      values.push_back(valueOf(arg));
+    }
+    koopa_raw_value_t value = builder.call(func_name, values);
     // 查询函数返回值类型
-    if (symbol_table.isVoid(func_name))
+    if (!symbol_table.isVoid(func_name))
     {
-      ir = "\tcall @" + func_name + "(";
+      newVar(value);
     }
-    else
+  }
+
+  // 只为非零元素生成 getelemptr 和 store, 全为零的子数组整个跳过, 同一行的元素共用上一维的地址
+  void localInitArrayIRHelper(koopa_raw_value_t base_ptr, const std::vector<int> &indexs, const std::vector<int> &init_list, size_t &init_index, int dimIndex)
+  {
+    size_t span = 1;
+    for (size_t d = dimIndex + 1; d < indexs.size(); ++d)
     {
-      ir = "\t%" + std::to_string(global_var_index++) + " = call @" + func_name + "(";
+      span *= indexs[d];
     }
-    for (int i = 0; i < args.size(); i++)
+    for (int i = 0; i < indexs[dimIndex]; ++i)
     {
-      if (args[i].second == RetType::NUMBER)
+      auto begin = init_list.begin() + init_index;
+      if (std::all_of(begin, begin + span, [](int v) { return v == 0; }))
       {
-        ir += std::to_string(args[i].first.number);
+        init_index += span;
+        continue;
       }
-      else if (args[i].second == RetType::INDEX)
+      newPtr(builder.getElemPtr(base_ptr, builder.integer(i)));
+      if (dimIndex == indexs.size() - 1)
       {
-        ir += "%" + std::to_string(args[i].first.number);
-      }
-      else if (args[i].second == RetType::IDENT)
-      {
-        ir += "@" + symbol_table.getUniqueIdent(args[i].first.ident);
-      }
-      else if (args[i].second == RetType::ARRAYPTR)
-      {
-        ir += "%ptr" + std::to_string(args[i].first.number);
-      }
-      else if (args[i].second == RetType::ARRAY)
-      {
-        ir += "@" + symbol_table.getUniqueIdent(args[i].first.ident);
-      } else if(args[i].second == RetType::PTR)
-      {
-        ir += "%ptr" + std::to_string(args[i].first.number);
+        storeIR({init_list[init_index++], RetType::NUMBER}, {global_ptr_index - 1, RetType::PTR});
       }
       else
       {
-        std::cerr << "callIR: unknown arg type\n";
-        assert(0);
-      }
-      if (i != args.size() - 1)
-      {
-        ir += ", ";
+        localInitArrayIRHelper(ptr_values.back(), indexs, init_list, init_index, dimIndex + 1);
       }
     }
-    ir += ")\n";
-    return ir;
   }
 
-  std::string localInitArrayIRHelper(const std::string &base_ptr, const std::vector<int> &indexs, const std::vector<int> &init_list, size_t &init_index, int dimIndex)
+  // 有零元素时先用一条 store zeroinit 清零整个数组, 再逐个写入非零元素
+  void localInitArrayIR(Symbol ident, std::vector<int> indexs, std::vector<int> init_list)
   {
-    std::string ir;
-    if (dimIndex == indexs.size() - 1)
+    koopa_raw_value_t base_ptr = builder.symbol(symbol_table.getUniqueIdent(ident));
+    if (std::find(init_list.begin(), init_list.end(), 0) != init_list.end())
     {
-      for (int i = 0; i < indexs[dimIndex]; ++i)
-      {
-        std::string ptr = "%ptr" + std::to_string(global_ptr_index++);
-        ir += "\t" + ptr + " = getelemptr " + base_ptr + ", " + std::to_string(i) + "\n";
-        ir += storeIR({init_list[init_index++], RetType::NUMBER}, {global_ptr_index - 1, RetType::PTR});
-      }
+      builder.store(builder.zeroInit(base_ptr->ty->data.pointer.base), base_ptr);
     }
-    else
-    {
-      for (int i = 0; i < indexs[dimIndex]; ++i)
-      {
-        std::string new_base_ptr = "%ptr" + std::to_string(global_ptr_index++);
-        ir += "\t" + new_base_ptr + " = getelemptr " + base_ptr + ", " + std::to_string(i) + "\n";
-        ir += localInitArrayIRHelper(new_base_ptr, indexs, init_list, init_index, dimIndex + 1);
-      }
-    }
-    return ir;
+    size_t init_index = 0;
+    localInitArrayIRHelper(base_ptr, indexs, init_list, init_index, 0);
   }
 
-  std::string localInitArrayIR(std::string ident, std::vector<int> indexs, std::vector<int> init_list)
+  // 局部变量, ty 为空时分配 i32; 数组参数需要传入指针类型
+  virtual void allocIR(Symbol ident, koopa_raw_type_t ty = nullptr) const
   {
-    std::string base_ptr = "@" + symbol_table.getUniqueIdent(ident);
-    size_t init_index = 0;
-    return localInitArrayIRHelper(base_ptr, indexs, init_list, init_index, 0);
+    if (isEnd())
+    {
+      return;
+    }
+    if (symbol_table.isGlobal())
+    {
+      std::cerr << "allocIR: use globalAllocIR for global variable " << ident << "\n";
+      assert(0);
+    }
+    if (!symbol_table.isPtr(ident) || ty == nullptr)
+    {
+      ty = builder.int32Type();
+    }
+    builder.alloc(symbol_table.getUniqueIdent(ident), ty);
   }
 
-  virtual std::string allocIR(std::string ident, std::string dim = "") const
+  // 全局变量, 没有初始值时为 zeroinit
+  virtual void globalAllocIR(Symbol ident, ret_value_t init = {0, RetType::VOID}) const
   {
-    if (isEnd(ir))
+    koopa_raw_value_t value;
+    if (init.second == RetType::VOID)
     {
-      return "";
+      value = builder.zeroInit(builder.int32Type());
     }
-    if (!symbol_table.isGlobal())
+    else if (init.second == RetType::NUMBER)
     {
-      if (!symbol_table.isPtr(ident))
-        return "\t@" + symbol_table.getUniqueIdent(ident) + " = alloc i32\n";
-      else
-        return "\t@" + symbol_table.getUniqueIdent(ident) + " = alloc " + dim + "\n";
+      value = builder.integer(init.first.number);
     }
-
-    return "global @" + symbol_table.getUniqueIdent(ident) + " = alloc i32, "; // global variable, 不写换行, 后面会写初始化
+    else
+    {
+      std::cerr << "globalAllocIR: global variable " << ident << " must be initialized with a constant\n";
+      assert(0);
+    }
+    builder.globalAlloc(symbol_table.getUniqueIdent(ident), builder.int32Type(), value);
   }
 
-  virtual std::string allocArrayIR(std::string ident = "", std::vector<int> size = {}, std::vector<int> init_list = {})
+  // readonly 为真时是 const 数组, 全局的放进 .rodata
+  virtual void allocArrayIR(Symbol ident = Symbol(), std::vector<int> size = {}, std::vector<int> init_list = {}, bool readonly = false)
   {
-    if (isEnd(ir))
+    if (isEnd())
     {
-      return "";
+      return;
     }
     // Helper function to generate nested initialization list
-    std::function<std::string(const std::vector<int> &, size_t, size_t &)> generateNestedInitList;
-    generateNestedInitList = [&](const std::vector<int> &init_list, size_t dimIndex, size_t &pos) -> std::string
+    std::function<koopa_raw_value_t(size_t, size_t &)> generateNestedInitList;
+    generateNestedInitList = [&](size_t dimIndex, size_t &pos) -> koopa_raw_value_t
     {
-      if (dimIndex == size.size() - 1)
+      std::vector<koopa_raw_value_t> elems;
+      for (int i = 0; i < size[dimIndex]; ++i)
       {
-        std::string result = "{";
-        for (int i = 0; i < size[dimIndex]; ++i)
+        if (dimIndex == size.size() - 1)
         {
-          result += std::to_string(init_list[pos++]);
-          if (i != size[dimIndex] - 1)
-          {
-            result += ", ";
-          }
+          elems.push_back(builder.integer(init_list[pos++]));
         }
-        result += "}";
-        return result;
-      }
-      else
-      {
-        std::string result = "{";
-        for (int i = 0; i < size[dimIndex]; ++i)
+        else
         {
-          result += generateNestedInitList(init_list, dimIndex + 1, pos);
-          if (i != size[dimIndex] - 1)
-          {
-            result += ", ";
-          }
+          elems.push_back(generateNestedInitList(dimIndex + 1, pos));
         }
-        result += "}";
-        return result;
       }
+      return builder.aggregate(builder.arrayType(std::vector<int>(size.begin() + dimIndex, size.end())), elems);
     };
 
-    std::string ir;
-    if (!symbol_table.isGlobal())
-    {
-      ir = "\t@" + symbol_table.getUniqueIdent(ident) + " = alloc ";
-    }
-    else
-    {
-      ir = "global @" + symbol_table.getUniqueIdent(ident) + " = alloc ";
-    }
-
-    // 生成数组的维度部分
-    for (size_t i = 0; i < size.size(); ++i)
-    {
-      ir += "["; // 开始一层新的维度
-    }
-
-    // 添加最内层类型
-    ir += "i32";
-
-    // 从内向外填充维度大小
-    for (auto it = size.rbegin(); it != size.rend(); ++it)
-    {
-      ir += ", " + std::to_string(*it) + "]";
-    }
-
+    koopa_raw_type_t ty = builder.arrayType(size);
     if (symbol_table.isGlobal())
     {
-      ir += ", ";
-      if (init_list.size() == 0)
-      {
-        ir += "zeroinit\n";
-        return ir;
-      }
-      else
-      {
-        size_t pos = 0;
-        ir += generateNestedInitList(init_list, 0, pos) + "\n";
-        return ir;
-      }
+      size_t pos = 0;
+      koopa_raw_value_t init = init_list.size() == 0 ? builder.zeroInit(ty) : generateNestedInitList(0, pos);
+      builder.globalAlloc(symbol_table.getUniqueIdent(ident), ty, init, readonly);
+      return;
     }
 
-    ir += "\n";
-    if (init_list.size() == 0)
+    builder.alloc(symbol_table.getUniqueIdent(ident), ty);
+    if (init_list.size() != 0)
     {
-      return ir;
+      // 局部变量初始化, 零元素由 store zeroinit 统一清零, 非零元素使用 getelemptr 和 store
+      this->localInitArrayIR(ident, size, init_list);
     }
-    else
+  }
+
+  // 取数组 (或数组指针) 的第 0 个元素的地址, 用于数组退化为指针
+  virtual void firstElemIR(ret_value_t src) const
+  {
+    if (isEnd())
     {
-      // 局部变量初始化，使用getelemptr指令和store指令：TODO
-      ir += this->localInitArrayIR(ident, size, init_list);
-      return ir;
+      return;
     }
+    newPtr(builder.getElemPtr(valueOf(src), builder.integer(0)));
   }
 
-  virtual std::string getelemptrIR(std::string ident, std::vector<ret_value_t> indexs) const
+  virtual void getelemptrIR(Symbol ident, std::vector<ret_value_t> indexs) const
   {
-    if (isEnd(ir))
+    if (isEnd())
     {
-      return "";
+      return;
     }
     if (!symbol_table.isArray(ident))
     {
       std::cerr << "getelemptrIR: " << ident << " is not an array\n";
       assert(0);
     }
-    std::string ir;
     // 如果indexs为空，直接返回数组的首地址
     if (indexs.size() == 0)
     {
-      // ir += "\t%ptr" + std::to_string(global_ptr_index++) + " = getelemptr @" + symbol_table.getUniqueIdent(ident) + ", 0\n";
-      return ir;
+      return;
     }
     // 否则，根据indexs的大小，逐层计算getelemptr
-    // 处理第一维度
-    // 判断indexs[0]是否是Number or Index
-    if (indexs[0].second == RetType::NUMBER)
+    koopa_raw_value_t ptr = builder.symbol(symbol_table.getUniqueIdent(ident));
+    for (auto &index : indexs)
     {
-      ir += "\t%ptr" + std::to_string(global_ptr_index++) + " = getelemptr @" + symbol_table.getUniqueIdent(ident) + ", " + std::to_string(indexs[0].first.number) + "\n";
-    }
-    else if (indexs[0].second == RetType::INDEX)
-    {
-      ir += "\t%ptr" + std::to_string(global_ptr_index++) + " = getelemptr @" + symbol_table.getUniqueIdent(ident) + ", %" + std::to_string(indexs[0].first.number) + "\n";
-    }
-    else
-    {
-      std::cerr << "getelemptrIR: unknown index type\n";
-      assert(0);
+      ptr = builder.getElemPtr(ptr, indexOf(index, "getelemptrIR"));
+      newPtr(ptr);
     }
-
-    // 处理后续维度
-    for (int i = 1; i < indexs.size(); i++)
-    {
-      if (indexs[i].second == RetType::NUMBER)
-      {
-        ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getelemptr %ptr" + std::to_string(global_ptr_index - 1) + ", " + std::to_string(indexs[i].first.number) + "\n";
-      }
-      else if (indexs[i].second == RetType::INDEX)
-      {
-        ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getelemptr %ptr" + std::to_string(global_ptr_index - 1) + ", %" + std::to_string(indexs[i].first.number) + "\n";
-      }
-      else
-      {
-        std::cerr << "getelemptrIR: unknown index type\n";
-        assert(0);
-      }
-      global_ptr_index++;
-    }
-    return ir;
-
-    /* // 处理第一维度
-    if(!symbol_table.isPtr(ident))
-      ir += "\t%ptr" + std::to_string(global_ptr_index++) + " = getelemptr @" + symbol_table.getUniqueIdent(ident) + ", " + std::to_string(indexs[0]) + "\n";
-    else{
-      ir += loadIR({RetValue(ident), RetType::ARRAYPTR});
-      ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getptr %ptr" + std::to_string(global_ptr_index - 1) + ", " + std::to_string(indexs[0]) + "\n";
-      global_ptr_index++;
-    }
-
-
-    // 处理后续维度
-    for(int i = 1; i < indexs.size(); i++) {
-      ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getelemptr %ptr" + std::to_string(global_ptr_index - 1) + ", " + std::to_string(indexs[i]) + "\n";
-      global_ptr_index++;
-    }
-    return ir; */
   }
 
-  virtual std::string getptrIR(std::string ident, std::vector<ret_value_t> indexs) const
+  virtual void getptrIR(Symbol ident, std::vector<ret_value_t> indexs) const
   {
-    if (isEnd(ir))
+    if (isEnd())
     {
-      // std::cerr << "getptrIR: ir is end\n";
-      return "";
+      return;
     }
     if (!symbol_table.isPtr(ident))
     {
       std::cerr << "getptrIR: " << ident << " is not a pointer\n";
       assert(0);
     }
-    std::string ir;
     // load pointer
-
-    ir += loadIR({RetValue(ident), RetType::ARRAYPTR});
-    if(indexs.size() == 0)
+    loadIR({RetValue(ident), RetType::ARRAYPTR});
+    if (indexs.size() == 0)
     {
-      std::cout << "getptrIR: indexs is empty\n";
-      return ir;
+      return;
     }
     // 处理第一维度
-    if (indexs[0].second == RetType::NUMBER)
-    {
-      ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getptr %ptr" + std::to_string(global_ptr_index - 1) + ", " + std::to_string(indexs[0].first.number) + "\n";
-    }
-    else if (indexs[0].second == RetType::INDEX)
-    {
-      ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getptr %ptr" + std::to_string(global_ptr_index - 1) + ", %" + std::to_string(indexs[0].first.number) + "\n";
-    }
-    else
-    {
-      std::cerr << "getptrIR: unknown index type\n";
-      assert(0);
-    }
-    global_ptr_index++;
+    koopa_raw_value_t ptr = builder.getPtr(ptr_values.back(), indexOf(indexs[0], "getptrIR"));
+    newPtr(ptr);
     // 处理后续维度，使用getelemptr
     for (int i = 1; i < indexs.size(); i++)
     {
-      if (indexs[i].second == RetType::NUMBER)
-      {
-        ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getelemptr %ptr" + std::to_string(global_ptr_index - 1) + ", " + std::to_string(indexs[i].first.number) + "\n";
-      }
-      else if (indexs[i].second == RetType::INDEX)
-      {
-        ir += "\t%ptr" + std::to_string(global_ptr_index) + " = getelemptr %ptr" + std::to_string(global_ptr_index - 1) + ", %" + std::to_string(indexs[i].first.number) + "\n";
-      }
-      else
+      ptr = builder.getElemPtr(ptr, indexOf(indexs[i], "getptrIR"));
+      newPtr(ptr);
+    }
+  }
+};
+
+struct ListItem
+{
+  ListType first;
+  BaseAST *second;
+};
+
+// 子节点列表, 元素数组从 arena 中分配, 容量不够时翻倍并复制, 旧数组留在 arena 中
+// List 不拥有元素, 复制 List 只复制数组指针, 本身也是平凡可析构的
+class List
+{
+  ListItem *items = nullptr;
+  size_t count = 0;
+  size_t capacity = 0;
+
+public:
+  static void *operator new(size_t size)
+  {
+    return BaseAST::arena.allocate(size);
+  }
+  static void operator delete(void *) {}
+
+  void emplace_back(ListType type, BaseAST *ast)
+  {
+    if (count == capacity)
+    {
+      size_t new_capacity = capacity == 0 ? 4 : capacity * 2;
+      ListItem *new_items = static_cast<ListItem *>(BaseAST::arena.allocate(new_capacity * sizeof(ListItem)));
+      if (count > 0)
       {
-        std::cerr << "getptrIR: unknown index type\n";
-        assert(0);
+        memcpy(new_items, items, count * sizeof(ListItem));
       }
-      global_ptr_index++;
+      items = new_items;
+      capacity = new_capacity;
     }
-    return ir;
-    
+    items[count++] = {type, ast};
   }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  ListItem *begin() { return items; }
+  ListItem *end() { return items + count; }
+  const ListItem *begin() const { return items; }
+  const ListItem *end() const { return items + count; }
+  ListItem &operator[](size_t i) { return items[i]; }
+  const ListItem &operator[](size_t i) const { return items[i]; }
+  ListItem &back() { return items[count - 1]; }
 };
-
-typedef std::vector<std::pair<ListType, std::unique_ptr<BaseAST>>> List;
@@ -3,101 +3,43 @@
 
 class CompUnitAST : public BaseAST { // CompUnit      ::= [CompUnit] (Decl | FuncDef);
  public:
-  // 用智能指针管理对象
-  enum class Type { FUNCDEF, DECL } type;
-  enum class Option { C0, C1 } option;
-  std::unique_ptr<BaseAST> other_comp_unit;
-  std::unique_ptr<BaseAST> func_def_or_decl;
+  // 按源代码顺序保存全局声明和函数定义, 用 ListType::DECL / ListType::FUNCDEF 区分
+  List items;
 
-  ret_value_t toIR(std::string &ir) override {
-    switch (type) {
-      case Type::FUNCDEF:
-        if(option == Option::C0) {
-          return func_def_or_decl->toIR(ir);
-        } else if(option == Option::C1) {
-          other_comp_unit->toIR(ir);
-          return func_def_or_decl->toIR(ir);
-        } else {
-          std::cerr << "CompUnitAST::toIR: unknown option" << std::endl;
-          return ret_value_t(0, RetType::NUMBER);
-        }
-      case Type::DECL:
-        if(option == Option::C0) {
-          return func_def_or_decl->toIR(ir);
-        } else if(option == Option::C1) {
-          other_comp_unit->toIR(ir);
-          return func_def_or_decl->toIR(ir);
-        } else {
-          std::cerr << "CompUnitAST::toIR: unknown option" << std::endl;
-          return ret_value_t(0, RetType::NUMBER);
-        }
-      default:
-        std::cerr << "CompUnitAST::toIR: unknown type" << std::endl;
-        return ret_value_t(0, RetType::NUMBER);
+  CompUnitAST(const List &_items) : items(_items) {}
+
+  ret_value_t toIR() override {
+    for (auto &item : items) {
+      item.second->toIR();
     }
+    return ret_value_t(0, RetType::VOID);
   }
 
   void Dump() const override {
     std::cout << "CompUnitAST { ";
-    switch (type) {
-      case Type::FUNCDEF:
-        if(option == Option::C1) {
-          other_comp_unit->Dump();
-          std::cout << ", ";
-        }
-        func_def_or_decl->Dump();
-        break;
-      case Type::DECL:
-        if(option == Option::C1) {
-          other_comp_unit->Dump();
-          std::cout << ", ";
-        }
-        func_def_or_decl->Dump();
-        break;
+    for (size_t i = 0; i < items.size(); i++) {
+      if (i > 0) {
+        std::cout << ", ";
+      }
+      items[i].second->Dump();
     }
     std::cout << " }";
   }
 
-    void toDot(std::string& dot) const override  {
+  void toDot(std::string& dot) const override  {
     std::string node_id = getUniqueID();
-    if(type == Type::FUNCDEF) {
-      if(option == Option::C0) { // CompUnit      ::=  FuncDef;
-        std::string node_def = node_id + "[label=\"<f0> FuncDef\"];\n";
-        dot += node_def;
-        func_def_or_decl->toDot(dot);
-        dot += "\"" + node_id + "\":f0 ->" + "\"" + func_def_or_decl->getUniqueID() + "\";\n";
-      } else if (option == Option::C1) { // CompUnit      ::=  CompUnit FuncDef; 按照顺序展开
-        std::string node_def = node_id + "[label=\"<f0> CompUnit | <f1> FuncDef\"];\n";
-        dot += node_def;
-
-        other_comp_unit->toDot(dot);
-        dot += "\"" + node_id + "\":f0 ->" + "\"" + other_comp_unit->getUniqueID() + "\";\n";
-
-        func_def_or_decl->toDot(dot);
-        dot += "\"" + node_id + "\":f1 ->" + "\"" + func_def_or_decl->getUniqueID() + "\";\n";
-      } else {
-        std::cerr << "CompUnitAST::toDot: unknown option" << std::endl;
+    std::string node_def = node_id + "[label=\"";
+    for (size_t i = 0; i < items.size(); i++) {
+      if (i > 0) {
+        node_def += " | ";
       }
-    } else if(type == Type::DECL) {
-      if(option == Option::C0) { // CompUnit      ::=  Decl;
-        std::string node_def = node_id + "[label=\"<f0> Decl\"];\n";
-        dot += node_def;
-        func_def_or_decl->toDot(dot);
-        dot += "\"" + node_id + "\":f0 ->" + "\"" + func_def_or_decl->getUniqueID() + "\";\n";
-      } else if (option == Option::C1) { // CompUnit      ::=  CompUnit Decl; 按照顺序展开
-        std::string node_def = node_id + "[label=\"<f0> CompUnit | <f1> Decl\"];\n";
-        dot += node_def;
-
-        other_comp_unit->toDot(dot);
-        dot += "\"" + node_id + "\":f0 ->" + "\"" + other_comp_unit->getUniqueID() + "\";\n";
-
-        func_def_or_decl->toDot(dot);
-        dot += "\"" + node_id + "\":f1 ->" + "\"" + func_def_or_decl->getUniqueID() + "\";\n";
-      } else {
-        std::cerr << "CompUnitAST::toDot: unknown option" << std::endl;
-      }
-    } else {
-      std::cerr << "CompUnitAST::toDot: unknown type" << std::endl;
+      node_def += "<f" + std::to_string(i) + (items[i].first == ListType::FUNCDEF ? "> FuncDef" : "> Decl");
+    }
+    node_def += "\"];\n";
+    dot += node_def;
+    for (size_t i = 0; i < items.size(); i++) {
+      items[i].second->toDot(dot);
+      dot += "\"" + node_id + "\":f" + std::to_string(i) + " ->" + "\"" + items[i].second->getUniqueID() + "\";\n";
     }
   }
-}; 
\ No newline at end of file
+};
@@ -4,15 +4,15 @@
 class DeclAST : public BaseAST { // Decl          ::= ConstDecl | VarDecl;
  public:
 
-    std::unique_ptr<BaseAST> const_or_var_decl;
+    BaseAST *const_or_var_decl = nullptr;
     enum class Type { CONST, VAR } type;
 
-    DeclAST(std::unique_ptr<BaseAST> &_const_or_var_decl, Type _type) : const_or_var_decl(std::move(_const_or_var_decl)), type(_type) {}
-    ret_value_t toIR(std::string &ir) override {
+    DeclAST(BaseAST *_const_or_var_decl, Type _type) : const_or_var_decl(_const_or_var_decl), type(_type) {}
+    ret_value_t toIR() override {
         if(type == Type::CONST) { // Decl          ::= ConstDecl;
-            return const_or_var_decl->toIR(ir);
+            return const_or_var_decl->toIR();
         } else if(type == Type::VAR) { // Decl          ::= VarDecl;
-            return const_or_var_decl->toIR(ir);
+            return const_or_var_decl->toIR();
         } else {
             std::cerr << "DeclAST: unknown type" << std::endl;
             assert(0);
@@ -54,18 +54,13 @@ class DeclAST : public BaseAST { // Decl          ::= ConstDecl | VarDecl;
 class ConstDeclAST : public BaseAST { // ConstDecl     ::= "const" BType ConstDef {"," ConstDef} ";";
 public:
   List const_def_list;
-  std::unique_ptr<BaseAST> btype;
+  BaseAST *btype = nullptr;
 
-  ConstDeclAST(List &_const_def_list, std::unique_ptr<BaseAST> &_btype) {
-    for(auto &item : _const_def_list) {
-      const_def_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
-    btype = std::move(_btype);
-  }
-  ret_value_t toIR(std::string &ir) override {
+  ConstDeclAST(const List &_const_def_list, BaseAST *_btype) : const_def_list(_const_def_list), btype(_btype) {}
+  ret_value_t toIR() override {
     // 遍历ConstDef，生成IR指令
     for(auto &item : const_def_list) {
-      item.second->toIR(ir);
+      item.second->toIR();
     }
     return {0, RetType::VOID};
   }
@@ -104,8 +99,8 @@ public:
 
 class BTypeAST : public BaseAST { // BType         ::= "int";
 public:
-    std::string btype;
-    BTypeAST(const std::string &_btype) : btype(_btype) {}
+    std::string_view btype; // 指向字符串字面量, 节点不持有需要析构的 std::string
+    BTypeAST(std::string_view _btype) : btype(_btype) {}
     void Dump() const override {
         std::cout << "BType { " << btype << " }";
     }
@@ -113,7 +108,7 @@ public:
     void toDot(std::string& dot) const override  {
       // 生成当前节点的唯一标识符
       std::string node_id = getUniqueID();
-      std::string node_label = "BType: " + btype;  // 直接将类型名称加入标签
+      std::string node_label = "BType: " + std::string(btype);  // 直接将类型名称加入标签
       std::string node_def = node_id + " [label=\"" + node_label + "\"];\n";
       dot += node_def;
     }
@@ -121,18 +116,16 @@ public:
 
 class ConstDefAST : public BaseAST { // ConstDef      ::= IDENT {"[" ConstExp "]"} "=" ConstInitVal;
 public:
-    std::string ident;
-    std::unique_ptr<BaseAST> const_init_val;
+    Symbol ident;
+    BaseAST *const_init_val = nullptr;
     List const_exp_list;
     
     // ConstDefAST构造函数，ConstDef      ::= IDENT {"[" ConstExp "]"} "=" ConstInitVal;, 使用const_exp_list
-    ConstDefAST(const std::string &_ident, List &_const_exp_list, std::unique_ptr<BaseAST> &_const_init_val) : ident(_ident), const_init_val(std::move(_const_init_val)) {
-        for(auto &item : _const_exp_list) {
-            const_exp_list.push_back(std::make_pair(item.first, std::move(item.second)));
-        }
+    ConstDefAST(Symbol _ident, const List &_const_exp_list, BaseAST *_const_init_val) : ident(_ident), const_init_val(_const_init_val) {
+        const_exp_list = _const_exp_list;
     }
   
-    ret_value_t toIR(std::string &ir) override {
+    ret_value_t toIR() override {
         if(const_exp_list.size() == 0) { // ConstDef      ::= IDENT {"[" ConstExp "]"} "=" ConstInitVal;
             // 插入符号表，简单情况，没有数组,不生成指令，只插入符号表
            symbol_table.insert(ident, {Item::Type::CONST, const_init_val->calc()});
@@ -153,7 +146,7 @@ public:
             const_init_val->calc(init_list, 0, length, array_size, static_cast<int>(array_size.size()));
 
             // 向 ir 中添加初始化数组的指令
-            ir += allocArrayIR(ident, array_size, init_list);
+            allocArrayIR(ident, array_size, init_list, true);
         }
         return {0, RetType::VOID};
     }
@@ -193,16 +186,14 @@ public:
 class ConstInitValAST : public BaseAST { // ConstInitVal  ::= ConstExp | "{" [ConstInitVal {"," ConstInitVal}] "}";
 public:
     enum class Type { CONSTEXP, ARRAY } type;
-    std::unique_ptr<BaseAST> const_exp;
+    BaseAST *const_exp = nullptr;
     List const_init_val_list;
 
-    ConstInitValAST(std::unique_ptr<BaseAST> &_const_exp) : const_exp(std::move(_const_exp)) { 
+    ConstInitValAST(BaseAST *_const_exp) : const_exp(_const_exp) { 
       type = Type::CONSTEXP;  
     }
-    ConstInitValAST(List &_const_init_val_list) {
-        for(auto &item : _const_init_val_list) {
-            const_init_val_list.push_back(std::make_pair(item.first, std::move(item.second)));
-        }
+    ConstInitValAST(const List &_const_init_val_list) {
+        const_init_val_list = _const_init_val_list;
         type = Type::ARRAY;
     }
     int calc() override {
@@ -246,9 +237,11 @@ public:
             else { // ptr > 0, 自 array_size 的最后一个元素开始，判断到最长可以整除的长度
               int new_sub_array_size = 0;
               int tmp_ptr = ptr;
-              while(tmp_ptr != 0 && array_size.size() - new_sub_array_size - 1 >= 0 && (tmp_ptr) % array_size[array_size.size() - new_sub_array_size - 1] == 0) {
+              // 对齐的维数不能超过当前这一层 {} 的子数组维数, 否则下标会越界
+              int last_dim = static_cast<int>(array_size.size()) - 1;
+              while(tmp_ptr != 0 && new_sub_array_size < sub_array_size - 1 && tmp_ptr % array_size[last_dim - new_sub_array_size] == 0) {
+                tmp_ptr /= array_size[last_dim - new_sub_array_size];
                 new_sub_array_size++;
-                tmp_ptr /= array_size[array_size.size() - new_sub_array_size - 1];
               }
               // 有可能列表初始化时非法的，也就是说ptr不是array_size的整数倍
               if(new_sub_array_size == 0) {
@@ -327,18 +320,13 @@ public:
 class VarDeclAST : public BaseAST { // VarDecl       ::= BType VarDef {"," VarDef} ";";
 public:
   List var_def_list;
-  std::unique_ptr<BaseAST> btype;
+  BaseAST *btype = nullptr;
 
-  VarDeclAST(List &_var_def_list, std::unique_ptr<BaseAST> &_btype) {
-    for(auto &item : _var_def_list) {
-      var_def_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
-    btype = std::move(_btype);
-  }
-  ret_value_t toIR(std::string &ir) override {
+  VarDeclAST(const List &_var_def_list, BaseAST *_btype) : var_def_list(_var_def_list), btype(_btype) {}
+  ret_value_t toIR() override {
     // 遍历VarDef，生成IR指令
     for(auto &item : var_def_list) {
-      item.second->toIR(ir);
+      item.second->toIR();
     }
     return {0, RetType::VOID};
   }
@@ -380,11 +368,11 @@ public:
 class VarDefAST : public BaseAST { // VarDef        ::= IDENT {"[" ConstExp "]"} | IDENT {"[" ConstExp "]"} "=" InitVal;
 public:
   enum class Type { IDENT, INIT} type;
-  std::string ident;
+  Symbol ident;
   List const_exp_list;
-  std::unique_ptr<BaseAST> init_val;
+  BaseAST *init_val = nullptr;
 
-  ret_value_t toIR(std::string &ir) override {
+  ret_value_t toIR() override {
     if(type == Type::IDENT) { // VarDef        ::= IDENT {"[" ConstExp "]"} ;
       // 插入符号表，简单情况，没有数组
         if(const_exp_list.size() == 0) {
@@ -392,10 +380,11 @@ public:
             std::cerr << "VarDefAST: redefined variable" << std::endl;
             assert(0);
           }
-          ir += allocIR(ident);
           // 检查是否是全局变量，如果是全局变量，需要初始化为0
           if(symbol_table.isGlobal()) {
-            ir += "zeroinit\n";
+            globalAllocIR(ident);
+          } else {
+            allocIR(ident);
           }
         } else { // 数组
           if(!symbol_table.insert(ident, {Item::Type::VARRAY, static_cast<int>(const_exp_list.size())})) {
@@ -406,7 +395,7 @@ public:
           for(auto &item : const_exp_list) {
             array_size.push_back(item.second->calc());
           }
-          ir += allocArrayIR(ident, array_size);
+          allocArrayIR(ident, array_size);
         }
 
       
@@ -418,17 +407,13 @@ public:
           std::cerr << "VarDefAST: redefined variable" << std::endl;
           assert(0);
         }
-        ir += allocIR(ident);
-        // 检查是否是全局变量，如果是全局变量，不使用storeIR
-        ret_value_t ret = init_val->toIR(ir);
+        // 检查是否是全局变量，如果是全局变量，不使用storeIR, 初始值在编译期求出
         if(symbol_table.isGlobal()) {
-          if(ret.second == RetType::NUMBER) {
-            ir += std::to_string(ret.first.number) + "\n";
-          } else {
-            std::cerr << "VarDefAST: Global variables can only be initialized by constants." << std::endl;
-          }
+          globalAllocIR(ident, {init_val->calc(), RetType::NUMBER});
         } else {
-          ir += storeIR(ret, {ident, RetType::IDENT});
+          allocIR(ident);
+          ret_value_t ret = init_val->toIR();
+          storeIR(ret, {ident, RetType::IDENT});
         }
       } else { // 数组
         if(!symbol_table.insert(ident, {Item::Type::VARRAY, static_cast<int>(const_exp_list.size())})) {
@@ -445,7 +430,7 @@ public:
         }
         std::vector<int> init_list(length, 0);
         init_val->calc(init_list, 0, length, array_size, array_size.size());
-        ir += allocArrayIR(ident, array_size, init_list);
+        allocArrayIR(ident, array_size, init_list);
       }
     } else {
       std::cerr << "VarDefAST: unknown type" << std::endl;
@@ -455,16 +440,12 @@ public:
   }
 
 
-  VarDefAST(const std::string &_ident, List &_const_exp_list) : ident(_ident) {
-    for(auto &item : _const_exp_list) {
-      const_exp_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
+  VarDefAST(Symbol _ident, const List &_const_exp_list) : ident(_ident) {
+    const_exp_list = _const_exp_list;
     type = Type::IDENT;
   }
-  VarDefAST(const std::string &_ident, List &_const_exp_list, std::unique_ptr<BaseAST> &_init_val) : ident(_ident), init_val(std::move(_init_val)) {
-    for(auto &item : _const_exp_list) {
-      const_exp_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
+  VarDefAST(Symbol _ident, const List &_const_exp_list, BaseAST *_init_val) : ident(_ident), init_val(_init_val) {
+    const_exp_list = _const_exp_list;
     type = Type::INIT;
   }
 
@@ -523,14 +504,12 @@ public:
 class InitValAST : public BaseAST { // InitVal       ::= Exp | "{" [InitVal {"," InitVal}] "}"; 
 public:
     enum class Type { EXP, ARRAY } type;
-    std::unique_ptr<BaseAST> exp;
+    BaseAST *exp = nullptr;
     List init_val_list;
 
-    InitValAST(std::unique_ptr<BaseAST> &_exp) : exp(std::move(_exp)) { type = Type::EXP; }
-    InitValAST(List &_init_val_list) {
-        for(auto &item : _init_val_list) {
-            init_val_list.push_back(std::make_pair(item.first, std::move(item.second)));
-        }
+    InitValAST(BaseAST *_exp) : exp(_exp) { type = Type::EXP; }
+    InitValAST(const List &_init_val_list) {
+        init_val_list = _init_val_list;
         type = Type::ARRAY;
     }
     bool isArray() override {
@@ -573,9 +552,11 @@ public:
             else { // ptr > 0, 自 array_size 的最后一个元素开始，判断到最长可以整除的长度
               int new_sub_array_size = 0;
               int tmp_ptr = ptr;
-              while(tmp_ptr != 0 && array_size.size() - new_sub_array_size - 1 >= 0 && (tmp_ptr) % array_size[array_size.size() - new_sub_array_size - 1] == 0) {
+              // 对齐的维数不能超过当前这一层 {} 的子数组维数, 否则下标会越界
+              int last_dim = static_cast<int>(array_size.size()) - 1;
+              while(tmp_ptr != 0 && new_sub_array_size < sub_array_size - 1 && tmp_ptr % array_size[last_dim - new_sub_array_size] == 0) {
+                tmp_ptr /= array_size[last_dim - new_sub_array_size];
                 new_sub_array_size++;
-                tmp_ptr /= array_size[array_size.size() - new_sub_array_size - 1];
               }
               // 有可能列表初始化时非法的，也就是说ptr不是array_size的整数倍
               if(new_sub_array_size == 0) {
@@ -604,9 +585,9 @@ public:
         
     }
 
-    ret_value_t toIR(std::string &ir) override {
+    ret_value_t toIR() override {
         if(type == Type::EXP) {
-            return exp->toIR(ir);
+            return exp->toIR();
         } else {
             std::cerr << "InitValAST: array not supported" << std::endl;
             assert(0);
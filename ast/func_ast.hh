@@ -9,10 +9,10 @@ public:
     F0,
     F1
   } option;
-  std::unique_ptr<BaseAST> func_type;
-  std::string ident;
-  std::unique_ptr<BaseAST> func_fparams;
-  std::unique_ptr<BaseAST> block;
+  BaseAST *func_type = nullptr;
+  Symbol ident;
+  BaseAST *func_fparams = nullptr;
+  BaseAST *block = nullptr;
 
   /* ir 语法
   FunDef ::= "fun" SYMBOL "(" [FunParams] ")" [":" Type] "{" FunBody "}";
@@ -23,8 +23,8 @@ public:
   EndStatement ::= Branch | Jump | Return;
    */
 
-  // 生成ir 的函数 toIR, 结果存在 字符串 ir 中，遵循ir 语法
-  ret_value_t toIR(std::string &ir) override
+  // 生成ir 的函数 toIR, 通过 builder 直接构造 Koopa raw program
+  ret_value_t toIR() override
   {
     // 添加符号表
     if (!symbol_table.insert(ident, {Item::Type::FUNC, func_type->isVoid() ? 0 : 1}))
@@ -34,24 +34,18 @@ public:
     }
     symbol_table.push();
 
+    builder.beginFunction(ident, func_type->isVoid() ? builder.unitType() : builder.int32Type());
     if (option == Option::F0)
     { // FuncDef       ::= FuncType IDENT "(" ")" Block; 遵循ir语法，生成ir语言FunDef ::= "fun" SYMBOL "(" [FunParams] ")" [":" Type] "{" FunBody "}";
-      ir += "fun @" + ident + "()";
-      func_type->toIR(ir);
-      ir += " {\n";
-      ir += "%entry:\n"; // %entry 与 函数定义关联
-      block->toIR(ir);
+      labelIR("entry"); // %entry 与 函数定义关联
+      block->toIR();
     }
     else if (option == Option::F1)
     { // FuncDef       ::= FuncType IDENT "(" FuncFParams ")" Block; 遵循ir语法，生成ir语言FunDef ::= "fun" SYMBOL "(" FunParams ")" [":" Type] "{" FunBody "}";
-      ir += "fun @" + ident + "(";
-      func_fparams->toIR(ir); // 需要将参数放到子作用域中 todo
-      ir += ")";
-      func_type->toIR(ir);
-      ir += " {\n";
-      ir += "%entry:\n"; // %entry 与 函数定义关联
-      func_fparams->xx(ir);
-      block->toIR(ir);
+      func_fparams->toIR(); // 需要将参数放到子作用域中 todo
+      labelIR("entry"); // %entry 与 函数定义关联
+      func_fparams->xx();
+      block->toIR();
     }
     else
     {
@@ -59,25 +53,25 @@ public:
     }
 
     // 判断函数是否有返回值
-    if (!isEnd(ir, 1))
+    if (!isEnd(1))
     {
       // 如果函数类型是void，则不需要返回值
       if (func_type->isVoid())
       {
-        ir += "\tret\n";
+        builder.ret();
       }
       else
       {
-        ir += "\tret 0\n";
+        builder.ret(builder.integer(0));
       }
     }
-    // 解析ir，最后的ret指令，查看是否有返回值
-    if (!isEnd(ir, 2) && !func_type->isVoid())
+    // 检查最后的ret指令是否有返回值
+    if (!isEnd(2) && !func_type->isVoid())
     {
       std::cerr << "FuncDefAST::toIR: function " << ident << " has no return value" << std::endl;
       assert(0);
     }
-    ir += "}\n";
+    builder.endFunction();
     // 删除符号表
     symbol_table.pop();
     return {0, RetType::VOID};
@@ -129,23 +123,16 @@ public:
 class FuncTypeAST : public BaseAST
 { // FuncType      ::= "void" | "int";
 public:
-  std::string type;
+  std::string_view type; // "void" 或 "int", 指向字符串字面量
 
   bool isVoid() override
   {
     return type == "void";
   }
-  ret_value_t toIR(std::string &ir) override
+  ret_value_t toIR() override
   {
-    if (type == "int")
-    {
-      ir += ": i32";
-    }
-    else if (type == "void")
-    {
-      ir += "";
-    }
-    else
+    // 返回值类型由 FuncDefAST 通过 isVoid 传给 builder
+    if (type != "int" && type != "void")
     {
       std::cerr << "FuncTypeAST::toIR: unknown type" << std::endl;
     }
@@ -160,7 +147,7 @@ public:
   void toDot(std::string &dot) const override
   {
     std::string node_id = getUniqueID();
-    std::string node_label = "FuncType: " + type; // 直接将类型名称加入标签
+    std::string node_label = "FuncType: " + std::string(type); // 直接将类型名称加入标签
     std::string node_def = node_id + " [label=\"" + node_label + "\"];\n";
     dot += node_def;
   }
@@ -170,32 +157,22 @@ class FuncFParamsAST : public BaseAST
 { // FuncFParams   ::= FuncFParam {"," FuncFParam};
 public:
   List fparams_list;
-  FuncFParamsAST(List &_fparams_list)
-  {
-    for (auto &item : _fparams_list)
-    {
-      fparams_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
-  }
+  FuncFParamsAST(const List &_fparams_list) : fparams_list(_fparams_list) {}
 
-  ret_value_t toIR(std::string &ir) override
+  ret_value_t toIR() override
   {
-    for (int i = 0; i < fparams_list.size(); i++)
+    for (auto &item : fparams_list)
     {
-      fparams_list[i].second->toIR(ir);
-      if (i != fparams_list.size() - 1)
-      {
-        ir += ", ";
-      }
+      item.second->toIR();
     }
     return {0, RetType::VOID};
   }
 
-  void xx(std::string &ir) override
+  void xx() override
   {
     for (auto &item : fparams_list)
     {
-      item.second->xx(ir);
+      item.second->xx();
     }
   }
 
@@ -235,26 +212,24 @@ public:
     C0,
     C1
   } option;
-  std::string ident;
+  Symbol ident;
+  Symbol param_ident; // 形参本身的名字 param_xxx, 函数体内用 ident 访问存放它的局部变量
   List const_exp_list;
-  std::unique_ptr<BaseAST> btype;
-  FuncFParamAST(Option _option, const std::string &_ident, List &_const_exp_list, std::unique_ptr<BaseAST> &_btype) : option(_option), ident(_ident), btype(std::move(_btype))
+  BaseAST *btype = nullptr;
+  FuncFParamAST(Option _option, Symbol _ident, const List &_const_exp_list, BaseAST *_btype) : option(_option), ident(_ident), param_ident("param_" + _ident), btype(_btype)
   {
-    for (auto &item : _const_exp_list)
-    {
-      const_exp_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
+    const_exp_list = _const_exp_list;
   }
-  ret_value_t toIR(std::string &ir) override
+  ret_value_t toIR() override
   {
     if (option == Option::C0)
     { // FuncFParam    ::= BType IDENT ;
-      if (!symbol_table.insert("param_" + ident, {Item::Type::VAR, 0}))
+      if (!symbol_table.insert(param_ident, {Item::Type::VAR, 0}))
       { // 检查全局变量或函数是否重名
         std::cerr << "FuncFParamAST::toIR: variable name " << ident << " already exists" << std::endl;
         assert(0);
       }
-      ir += "@" + symbol_table.getUniqueIdent("param_" + ident) + ": i32";
+      builder.addParam(symbol_table.getUniqueIdent(param_ident), builder.int32Type());
     }
     else if (option == Option::C1)
     { // FuncFParam    ::= BType IDENT "[" "]" {"[" ConstExp "]"};
@@ -268,7 +243,7 @@ public:
             %2 = load %1
             ret %2
           } */
-      if (!symbol_table.insert("param_" + ident, {Item::Type::PTR, 0})) // 检查全局变量或函数是否重名
+      if (!symbol_table.insert(param_ident, {Item::Type::PTR, 0})) // 检查全局变量或函数是否重名
       {
         std::cerr << "FuncFParamAST::toIR: variable (ptr)name " << ident << " already exists" << std::endl;
         assert(0);
@@ -280,8 +255,7 @@ public:
       }
       // 生成参数的ir代码
       // 解析dims
-      ir += "@" + symbol_table.getUniqueIdent("param_" + ident) + ": ";
-      ir += genDim(dims);
+      builder.addParam(symbol_table.getUniqueIdent(param_ident), genDim(dims));
     }
     else
     {
@@ -289,31 +263,13 @@ public:
     }
     return {0, RetType::VOID};
   }
-  std::string genDim(std::vector<int> &size)
+  // int a[][2][3] 的类型为 *[[i32, 3], 2], int a[] 的类型为 *i32
+  koopa_raw_type_t genDim(std::vector<int> &size)
   {
-    std::string ir = "*";
-    // 生成数组的维度部分
-    if (size.size() == 0)
-    {
-      return "*i32";
-    }
-    for (size_t i = 0; i < size.size(); ++i)
-    {
-      ir += "["; // 开始一层新的维度
-    }
-
-    // 添加最内层类型
-    ir += "i32";
-
-    // 从内向外填充维度大小
-    for (auto it = size.rbegin(); it != size.rend(); ++it)
-    {
-      ir += ", " + std::to_string(*it) + "]";
-    }
-    return ir;
+    return builder.pointerType(builder.arrayType(size));
   }
   // 在块中将形参存入内存
-  void xx(std::string &ir) override
+  void xx() override
   {
     if (option == Option::C0)
     { // FuncFParam    ::= BType IDENT ;
@@ -322,8 +278,8 @@ public:
         std::cerr << "FuncFParamAST::toIR: variable name: " << ident << " already exists" << std::endl;
         assert(0);
       }
-      ir += allocIR(ident);
-      ir += storeIR({"param_" + ident, RetType::IDENT}, {ident, RetType::IDENT});
+      allocIR(ident);
+      storeIR({param_ident, RetType::IDENT}, {ident, RetType::IDENT});
     }
     else if (option == Option::C1)
     { // FuncFParam    ::= BType IDENT "[" "]" {"[" ConstExp "]"};
@@ -337,8 +293,8 @@ public:
       {
         dims.push_back(item.second->calc());
       }
-      ir += allocIR(ident, genDim(dims));
-      ir += storeIR({"param_" + ident, RetType::IDENT}, {ident, RetType::IDENT});
+      allocIR(ident, genDim(dims));
+      storeIR({param_ident, RetType::IDENT}, {ident, RetType::IDENT});
     }
     else
     {
@@ -395,24 +351,18 @@ public:
 };
 
 class BlockAST : public BaseAST
-{ // Block         ::= "{" {BlockItem} "}";
+{ // Block         ::= "{" {BlockItem} "}";  BlockItem ::= Decl | Stmt, 用 ListType 区分
 public:
   List block_item_list;
   BlockAST() {}
-  BlockAST(List &_block_item_list)
-  {
-    for (auto &item : _block_item_list)
-    {
-      block_item_list.push_back(std::make_pair(item.first, std::move(item.second)));
-    }
-  }
+  BlockAST(const List &_block_item_list) : block_item_list(_block_item_list) {}
 
-  ret_value_t toIR(std::string &ir) override
+  ret_value_t toIR() override
   { // %entry:
 
     for (auto &item : block_item_list)
     {
-      item.second->toIR(ir);
+      item.second->toIR();
     }
     return {0, RetType::VOID};
   }
@@ -440,7 +390,7 @@ public:
       std::string node_def = node_id + "[label=\"<f0> \\{";
       for (int i = 0; i < block_item_list.size(); i++)
       {
-        node_def += " | <f" + std::to_string(i + 1) + "> BlockItem";
+        node_def += " | <f" + std::to_string(i + 1) + (block_item_list[i].first == ListType::DECL ? "> Decl" : "> Stmt");
       }
       node_def += " | <f" + std::to_string(block_item_list.size() + 1) + "> \\}" + "\"];\n";
       dot += node_def;
@@ -454,74 +404,6 @@ public:
   }
 };
 
-class BlockItemAST : public BaseAST
-{ // BlockItem     ::= Decl | Stmt;
-public:
-  std::unique_ptr<BaseAST> decl_or_stmt;
-  enum class Type
-  {
-    DECL,
-    STMT
-  } type;
-
-  BlockItemAST(std::unique_ptr<BaseAST> &_decl_or_stmt, Type _type) : decl_or_stmt(std::move(_decl_or_stmt)), type(_type) {}
-
-  ret_value_t toIR(std::string &ir) override
-  {
-    if (type == Type::DECL)
-    { // BlockItem     ::= Decl;
-      decl_or_stmt->toIR(ir);
-    }
-    else if (type == Type::STMT)
-    { // BlockItem     ::= Stmt;
-      decl_or_stmt->toIR(ir);
-    }
-    else
-    {
-      std::cerr << "BlockItemAST::toIR: unknown type" << std::endl;
-    }
-    return {0, RetType::VOID};
-  }
-
-  void Dump() const override
-  {
-    std::cout << "BlockItemAST { ";
-    switch (type)
-    {
-    case Type::DECL:
-      decl_or_stmt->Dump();
-      break;
-    case Type::STMT:
-      decl_or_stmt->Dump();
-      break;
-    }
-    std::cout << " }";
-  }
-
-  void toDot(std::string &dot) const override
-  {
-    std::string node_id = getUniqueID();
-    if (type == Type::DECL)
-    { // BlockItem     ::= Decl;
-      std::string node_def = node_id + "[label=\"<f0> Decl\"];\n";
-      dot += node_def;
-      decl_or_stmt->toDot(dot);
-      dot += "\"" + node_id + "\":f0 ->" + "\"" + decl_or_stmt->getUniqueID() + "\";\n";
-    }
-    else if (type == Type::STMT)
-    { // BlockItem     ::= Stmt;
-      std::string node_def = node_id + "[label=\"<f0> Stmt\"];\n";
-      dot += node_def;
-      decl_or_stmt->toDot(dot);
-      dot += "\"" + node_id + "\":f0 ->" + "\"" + decl_or_stmt->getUniqueID() + "\";\n";
-    }
-    else
-    {
-      std::cerr << "BlockItemAST::toDot: unknown type" << std::endl;
-    }
-  }
-};
-
 class StmtAST : public BaseAST
 {
 public:
@@ -542,12 +424,12 @@ public:
     EXP0,
     EXP1
   } option;
-  std::unique_ptr<BaseAST> lval;
-  std::unique_ptr<BaseAST> exp;
-  std::unique_ptr<BaseAST> block;
-  std::unique_ptr<BaseAST> if_stmt;
-  std::unique_ptr<BaseAST> else_stmt;
-  StmtAST(std::unique_ptr<BaseAST> &_lval, std::unique_ptr<BaseAST> &_exp) : lval(std::move(_lval)), exp(std::move(_exp))
+  BaseAST *lval = nullptr;
+  BaseAST *exp = nullptr;
+  BaseAST *block = nullptr;
+  BaseAST *if_stmt = nullptr;
+  BaseAST *else_stmt = nullptr;
+  StmtAST(BaseAST *_lval, BaseAST *_exp) : lval(_lval), exp(_exp)
   {
     type = Type::ASSIGN;
   }
@@ -561,38 +443,38 @@ public:
               | "continue" ";"
               | "return" [Exp] ";";
   */
-  ret_value_t toIR(std::string &ir) override
+  ret_value_t toIR() override
   {
-    if (type == Type::RETURN && !isEnd(ir))
+    if (type == Type::RETURN && !isEnd())
     {
 
       if (option == Option::EXP0)
       { // Stmt          ::= "return" ";";
-        ir += "\tret\n";
+        builder.ret();
       }
       else if (option == Option::EXP1)
       { // Stmt          ::= "return" Exp ";";
-        ret_value_t ret = exp->toIR(ir);
+        ret_value_t ret = exp->toIR();
         if (ret.second == RetType::NUMBER)
         {
-          ir += "\tret " + std::to_string(ret.first.number) + "\n";
+          builder.ret(valueOf(ret));
         }
         else if (ret.second == RetType::INDEX)
         {
-          ir += "\tret %" + std::to_string(ret.first.number) + "\n";
+          builder.ret(valueOf(ret));
         }
         else if (ret.second == RetType::VOID)
         {
-          ir += "\tret\n";
+          builder.ret();
         }
         else if (ret.second == RetType::IDENT)
         {
-          ir += loadIR(ret);
-          ir += "\tret %" + std::to_string(global_var_index - 1) + "\n";
+          loadIR(ret);
+          builder.ret(var_values.back());
         }
         else if (ret.second == RetType::ARRAYPTR)
         {
-          ir += "\tret %ptr" + std::to_string(ret.first.number) + "\n";
+          builder.ret(valueOf(ret));
         }
         else
         {
@@ -602,55 +484,48 @@ public:
     }
     else if (type == Type::ASSIGN)
     {
-      ret_value_t exp_ret = exp->toIR(ir);
-      ret_value_t lval_ret = lval->toIR(ir);
-      ir += storeIR(exp_ret, lval_ret);
+      ret_value_t exp_ret = exp->toIR();
+      ret_value_t lval_ret = lval->toIR();
+      storeIR(exp_ret, lval_ret);
     }
     else if (type == Type::EXP)
     {
       if (option == Option::EXP1)
       {
-        exp->toIR(ir);
+        exp->toIR();
       }
     }
     else if (type == Type::BLOCK)
     {
       symbol_table.push();
-      block->toIR(ir);
+      block->toIR();
       symbol_table.pop();
     }
     else if (type == Type::IF)
     { // "if" "(" Exp ")" Stmt
       std::string then_label = "then_" + std::to_string(global_label_index);
       std::string end_label = "end_" + std::to_string(global_label_index++);
-      ir += "\t// if 的条件判断部分\n";
-      ret_value_t exp_ret = exp->toIR(ir);
-      ir += brIR(exp_ret, then_label, end_label);
-      ir += "\n// if 语句的 if 分支 \n";
-      ir += labelIR(then_label);
-      if_stmt->toIR(ir);
-      ir += jumpIR(end_label);
-      ir += "\n// if 语句之后的内容, if/else 分支的交汇处 \n";
-      ir += labelIR(end_label);
+      ret_value_t exp_ret = exp->toIR();
+      brIR(exp_ret, then_label, end_label);
+      labelIR(then_label);
+      if_stmt->toIR();
+      jumpIR(end_label);
+      labelIR(end_label);
     }
     else if (type == Type::IFELSE)
     { // "if" "(" Exp ")" Stmt "else" Stmt
       std::string then_label = "then_" + std::to_string(global_label_index);
       std::string else_label = "else_" + std::to_string(global_label_index);
       std::string end_label = "end_" + std::to_string(global_label_index++);
-      ir += "\t// if 的条件判断部分\n";
-      ret_value_t exp_ret = exp->toIR(ir);
-      ir += brIR(exp_ret, then_label, else_label);
-      ir += "\n// if 语句的 if 分支 \n";
-      ir += labelIR(then_label);
-      if_stmt->toIR(ir);
-      ir += jumpIR(end_label);
-      ir += "\n// if 语句的 else 分支 \n";
-      ir += labelIR(else_label);
-      else_stmt->toIR(ir);
-      ir += jumpIR(end_label);
-      ir += "\n// if 语句之后的内容, if/else 分支的交汇处 \n";
-      ir += labelIR(end_label);
+      ret_value_t exp_ret = exp->toIR();
+      brIR(exp_ret, then_label, else_label);
+      labelIR(then_label);
+      if_stmt->toIR();
+      jumpIR(end_label);
+      labelIR(else_label);
+      else_stmt->toIR();
+      jumpIR(end_label);
+      labelIR(end_label);
     }
     else if (type == Type::WHILE)
     { // "while" "(" Exp ")" Stmt
@@ -660,19 +535,14 @@ public:
       std::string while_body_label = "while_body_" + std::to_string(global_label_index);
       std::string end_label = "end_" + std::to_string(global_label_index++);
 
-      ir += jumpIR(while_entry_label);
-      ir += "\t// while 循环的入口\n";
-      ir += labelIR(while_entry_label);
-      ret_value_t exp_ret = exp->toIR(ir);
-      ir += brIR(exp_ret, while_body_label, end_label);
-
-      ir += "\n// while 循环的主体\n";
-      ir += labelIR(while_body_label);
-      if_stmt->toIR(ir);
-      ir += jumpIR(while_entry_label);
-
-      ir += "\n// while 循环结束\n";
-      ir += labelIR(end_label);
+      jumpIR(while_entry_label);
+      labelIR(while_entry_label);
+      ret_value_t exp_ret = exp->toIR();
+      brIR(exp_ret, while_body_label, end_label);
+      labelIR(while_body_label);
+      if_stmt->toIR();
+      jumpIR(while_entry_label);
+      labelIR(end_label);
       loop_stack.pop(); // 弹出循环的标签号
     }
     else if (type == Type::BREAK)
@@ -684,7 +554,7 @@ public:
         assert(0);
       }
       std::string end_label = "end_" + std::to_string(loop_stack.top());
-      ir += jumpIR(end_label);
+      jumpIR(end_label);
     }
     else if (type == Type::CONTINUE)
     { // "continue" ";";
@@ -695,7 +565,7 @@ public:
         assert(0);
       }
       std::string while_entry_label = "while_entry_" + std::to_string(loop_stack.top());
-      ir += jumpIR(while_entry_label);
+      jumpIR(while_entry_label);
     }
     else
     {
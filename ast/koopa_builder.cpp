@@ -0,0 +1,399 @@
+#include "koopa_builder.hh"
+#include <cassert>
+#include <iostream>
+
+KoopaBuilder::KoopaBuilder()
+{
+  types.emplace_back();
+  types.back().tag = KOOPA_RTT_INT32;
+  int32_ty = &types.back();
+  types.emplace_back();
+  types.back().tag = KOOPA_RTT_UNIT;
+  unit_ty = &types.back();
+
+  // sysy 运行时库
+  koopa_raw_type_t ptr_ty = pointerType(int32_ty);
+  declareFunction("getint", {}, int32_ty);
+  declareFunction("getch", {}, int32_ty);
+  declareFunction("getarray", {ptr_ty}, int32_ty);
+  declareFunction("putint", {int32_ty}, unit_ty);
+  declareFunction("putch", {int32_ty}, unit_ty);
+  declareFunction("putarray", {int32_ty, ptr_ty}, unit_ty);
+  declareFunction("starttime", {}, unit_ty);
+  declareFunction("stoptime", {}, unit_ty);
+}
+
+const char *KoopaBuilder::intern(const std::string &name)
+{
+  names.push_back(name);
+  return names.back().c_str();
+}
+
+koopa_raw_slice_t KoopaBuilder::slice(const std::vector<const void *> &items, koopa_raw_slice_item_kind_t kind)
+{
+  if (items.empty())
+  {
+    return {nullptr, 0, kind};
+  }
+  buffers.push_back(items);
+  return {buffers.back().data(), static_cast<uint32_t>(items.size()), kind};
+}
+
+koopa_raw_value_data_t *KoopaBuilder::newValue(koopa_raw_type_t ty, const char *name)
+{
+  values.emplace_back();
+  koopa_raw_value_data_t *value = &values.back();
+  value->ty = ty;
+  value->name = name;
+  value->used_by = {nullptr, 0, KOOPA_RSIK_VALUE};
+  return value;
+}
+
+koopa_raw_value_t KoopaBuilder::append(koopa_raw_value_data_t *inst)
+{
+  if (cur_block == nullptr)
+  {
+    std::cerr << "KoopaBuilder: instruction outside of a basic block" << std::endl;
+    assert(0);
+  }
+  block_insts[cur_block].push_back(inst);
+  return inst;
+}
+
+koopa_raw_type_t KoopaBuilder::pointerType(koopa_raw_type_t base)
+{
+  auto it = pointer_types.find(base);
+  if (it != pointer_types.end())
+  {
+    return it->second;
+  }
+  types.emplace_back();
+  types.back().tag = KOOPA_RTT_POINTER;
+  types.back().data.pointer.base = base;
+  return pointer_types[base] = &types.back();
+}
+
+koopa_raw_type_t KoopaBuilder::arrayType(koopa_raw_type_t base, size_t len)
+{
+  auto key = std::make_pair(base, len);
+  auto it = array_types.find(key);
+  if (it != array_types.end())
+  {
+    return it->second;
+  }
+  types.emplace_back();
+  types.back().tag = KOOPA_RTT_ARRAY;
+  types.back().data.array.base = base;
+  types.back().data.array.len = len;
+  return array_types[key] = &types.back();
+}
+
+// dims = {2, 3} 对应 [[i32, 3], 2]
+koopa_raw_type_t KoopaBuilder::arrayType(const std::vector<int> &dims)
+{
+  koopa_raw_type_t ty = int32_ty;
+  for (auto it = dims.rbegin(); it != dims.rend(); ++it)
+  {
+    ty = arrayType(ty, *it);
+  }
+  return ty;
+}
+
+void KoopaBuilder::declareFunction(const std::string &name, const std::vector<koopa_raw_type_t> &params, koopa_raw_type_t ret)
+{
+  beginFunction(name, ret);
+  cur_func->param_types = params;
+  endFunction();
+}
+
+void KoopaBuilder::beginFunction(const std::string &name, koopa_raw_type_t ret)
+{
+  functions.emplace_back();
+  function_infos.emplace_back();
+  cur_func = &function_infos.back();
+  cur_func->data = &functions.back();
+  cur_func->data->name = intern("@" + name);
+  cur_func->ret = ret;
+  function_map[name] = cur_func;
+  block_map.clear();
+  cur_block = nullptr;
+}
+
+koopa_raw_value_t KoopaBuilder::addParam(const std::string &name, koopa_raw_type_t ty)
+{
+  koopa_raw_value_data_t *param = newValue(ty, intern("@" + name));
+  param->kind.tag = KOOPA_RVT_FUNC_ARG_REF;
+  param->kind.data.func_arg_ref.index = cur_func->params.size();
+  cur_func->params.push_back(param);
+  cur_func->param_types.push_back(ty);
+  symbols[name] = param;
+  return param;
+}
+
+void KoopaBuilder::endFunction()
+{
+  types.emplace_back();
+  koopa_raw_type_kind_t &func_ty = types.back();
+  func_ty.tag = KOOPA_RTT_FUNCTION;
+  func_ty.data.function.params = slice(std::vector<const void *>(cur_func->param_types.begin(), cur_func->param_types.end()), KOOPA_RSIK_TYPE);
+  func_ty.data.function.ret = cur_func->ret;
+
+  koopa_raw_function_data_t *data = cur_func->data;
+  data->ty = &func_ty;
+  data->params = slice(std::vector<const void *>(cur_func->params.begin(), cur_func->params.end()), KOOPA_RSIK_VALUE);
+  for (auto bb : cur_func->bbs)
+  {
+    const auto &insts = block_insts[bb];
+    bb->insts = slice(std::vector<const void *>(insts.begin(), insts.end()), KOOPA_RSIK_VALUE);
+  }
+  for (auto &item : block_map)
+  {
+    if (item.second->insts.kind != KOOPA_RSIK_VALUE)
+    {
+      std::cerr << "KoopaBuilder: basic block " << item.first << " is referenced but never placed" << std::endl;
+      assert(0);
+    }
+  }
+  data->bbs = slice(std::vector<const void *>(cur_func->bbs.begin(), cur_func->bbs.end()), KOOPA_RSIK_BASIC_BLOCK);
+  cur_func = nullptr;
+  cur_block = nullptr;
+}
+
+koopa_raw_function_t KoopaBuilder::function(const std::string &name) const
+{
+  auto it = function_map.find(name);
+  if (it == function_map.end())
+  {
+    std::cerr << "KoopaBuilder: undefined function " << name << std::endl;
+    assert(0);
+  }
+  return it->second->data;
+}
+
+koopa_raw_value_t KoopaBuilder::globalAlloc(const std::string &name, koopa_raw_type_t ty, koopa_raw_value_t init, bool readonly)
+{
+  koopa_raw_value_data_t *value = newValue(pointerType(ty), intern("@" + name));
+  value->kind.tag = KOOPA_RVT_GLOBAL_ALLOC;
+  value->kind.data.global_alloc.init = init;
+  global_values.push_back(value);
+  if (readonly)
+  {
+    readonly_globals.insert(value);
+  }
+  symbols[name] = value;
+  return value;
+}
+
+koopa_raw_value_t KoopaBuilder::integer(int v)
+{
+  auto it = integers.find(v);
+  if (it != integers.end())
+  {
+    return it->second;
+  }
+  koopa_raw_value_data_t *value = newValue(int32_ty, nullptr);
+  value->kind.tag = KOOPA_RVT_INTEGER;
+  value->kind.data.integer.value = v;
+  return integers[v] = value;
+}
+
+koopa_raw_value_t KoopaBuilder::zeroInit(koopa_raw_type_t ty)
+{
+  koopa_raw_value_data_t *value = newValue(ty, nullptr);
+  value->kind.tag = KOOPA_RVT_ZERO_INIT;
+  return value;
+}
+
+koopa_raw_value_t KoopaBuilder::aggregate(koopa_raw_type_t ty, const std::vector<koopa_raw_value_t> &elems)
+{
+  koopa_raw_value_data_t *value = newValue(ty, nullptr);
+  value->kind.tag = KOOPA_RVT_AGGREGATE;
+  value->kind.data.aggregate.elems = slice(std::vector<const void *>(elems.begin(), elems.end()), KOOPA_RSIK_VALUE);
+  return value;
+}
+
+koopa_raw_value_t KoopaBuilder::symbol(const std::string &name) const
+{
+  auto it = symbols.find(name);
+  if (it == symbols.end())
+  {
+    std::cerr << "KoopaBuilder: undefined symbol " << name << std::endl;
+    assert(0);
+  }
+  return it->second;
+}
+
+koopa_raw_basic_block_t KoopaBuilder::block(const std::string &name)
+{
+  auto it = block_map.find(name);
+  if (it != block_map.end())
+  {
+    return it->second;
+  }
+  blocks.emplace_back();
+  koopa_raw_basic_block_data_t *bb = &blocks.back();
+  bb->name = intern("%" + name);
+  bb->params = {nullptr, 0, KOOPA_RSIK_VALUE};
+  bb->used_by = {nullptr, 0, KOOPA_RSIK_VALUE};
+  bb->insts = {nullptr, 0, KOOPA_RSIK_UNKNOWN}; // 放入函数后才确定
+  block_map[name] = bb;
+  return bb;
+}
+
+void KoopaBuilder::label(const std::string &name)
+{
+  auto bb = const_cast<koopa_raw_basic_block_data_t *>(block(name));
+  // 上一个块没有终结指令时直接落到新块
+  if (cur_block != nullptr && !isEnd())
+  {
+    jump(bb);
+  }
+  bb->insts.kind = KOOPA_RSIK_VALUE;
+  cur_func->bbs.push_back(bb);
+  cur_block = bb;
+}
+
+bool KoopaBuilder::isEnd(int option) const
+{
+  if (cur_block == nullptr)
+  {
+    return false;
+  }
+  auto it = block_insts.find(cur_block);
+  if (it == block_insts.end() || it->second.empty())
+  {
+    return false;
+  }
+  koopa_raw_value_t last = it->second.back();
+  if (option == 1)
+  {
+    return last->kind.tag == KOOPA_RVT_RETURN;
+  }
+  if (option == 2)
+  {
+    return last->kind.tag == KOOPA_RVT_RETURN && last->kind.data.ret.value != nullptr;
+  }
+  return last->kind.tag == KOOPA_RVT_RETURN || last->kind.tag == KOOPA_RVT_BRANCH || last->kind.tag == KOOPA_RVT_JUMP;
+}
+
+koopa_raw_value_t KoopaBuilder::alloc(const std::string &name, koopa_raw_type_t ty)
+{
+  koopa_raw_value_data_t *inst = newValue(pointerType(ty), intern("@" + name));
+  inst->kind.tag = KOOPA_RVT_ALLOC;
+  symbols[name] = inst;
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::load(koopa_raw_value_t src)
+{
+  koopa_raw_value_data_t *inst = newValue(src->ty->data.pointer.base, nullptr);
+  inst->kind.tag = KOOPA_RVT_LOAD;
+  inst->kind.data.load.src = src;
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::store(koopa_raw_value_t value, koopa_raw_value_t dest)
+{
+  koopa_raw_value_data_t *inst = newValue(unit_ty, nullptr);
+  inst->kind.tag = KOOPA_RVT_STORE;
+  inst->kind.data.store.value = value;
+  inst->kind.data.store.dest = dest;
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::getElemPtr(koopa_raw_value_t src, koopa_raw_value_t index)
+{
+  koopa_raw_value_data_t *inst = newValue(pointerType(src->ty->data.pointer.base->data.array.base), nullptr);
+  inst->kind.tag = KOOPA_RVT_GET_ELEM_PTR;
+  inst->kind.data.get_elem_ptr.src = src;
+  inst->kind.data.get_elem_ptr.index = index;
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::getPtr(koopa_raw_value_t src, koopa_raw_value_t index)
+{
+  koopa_raw_value_data_t *inst = newValue(src->ty, nullptr);
+  inst->kind.tag = KOOPA_RVT_GET_PTR;
+  inst->kind.data.get_ptr.src = src;
+  inst->kind.data.get_ptr.index = index;
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::binary(const std::string &op, koopa_raw_value_t lhs, koopa_raw_value_t rhs)
+{
+  static const std::unordered_map<std::string, koopa_raw_binary_op_t> ops = {
+      {"ne", KOOPA_RBO_NOT_EQ}, {"eq", KOOPA_RBO_EQ}, {"gt", KOOPA_RBO_GT}, {"lt", KOOPA_RBO_LT},
+      {"ge", KOOPA_RBO_GE}, {"le", KOOPA_RBO_LE}, {"add", KOOPA_RBO_ADD}, {"sub", KOOPA_RBO_SUB},
+      {"mul", KOOPA_RBO_MUL}, {"div", KOOPA_RBO_DIV}, {"mod", KOOPA_RBO_MOD}, {"and", KOOPA_RBO_AND},
+      {"or", KOOPA_RBO_OR}, {"xor", KOOPA_RBO_XOR}, {"shl", KOOPA_RBO_SHL}, {"shr", KOOPA_RBO_SHR},
+      {"sar", KOOPA_RBO_SAR}};
+  auto it = ops.find(op);
+  if (it == ops.end())
+  {
+    std::cerr << "KoopaBuilder: unknown binary op " << op << std::endl;
+    assert(0);
+  }
+  koopa_raw_value_data_t *inst = newValue(int32_ty, nullptr);
+  inst->kind.tag = KOOPA_RVT_BINARY;
+  inst->kind.data.binary.op = it->second;
+  inst->kind.data.binary.lhs = lhs;
+  inst->kind.data.binary.rhs = rhs;
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::branch(koopa_raw_value_t cond, koopa_raw_basic_block_t true_bb, koopa_raw_basic_block_t false_bb)
+{
+  koopa_raw_value_data_t *inst = newValue(unit_ty, nullptr);
+  inst->kind.tag = KOOPA_RVT_BRANCH;
+  inst->kind.data.branch.cond = cond;
+  inst->kind.data.branch.true_bb = true_bb;
+  inst->kind.data.branch.false_bb = false_bb;
+  inst->kind.data.branch.true_args = {nullptr, 0, KOOPA_RSIK_VALUE};
+  inst->kind.data.branch.false_args = {nullptr, 0, KOOPA_RSIK_VALUE};
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::jump(koopa_raw_basic_block_t target)
+{
+  koopa_raw_value_data_t *inst = newValue(unit_ty, nullptr);
+  inst->kind.tag = KOOPA_RVT_JUMP;
+  inst->kind.data.jump.target = target;
+  inst->kind.data.jump.args = {nullptr, 0, KOOPA_RSIK_VALUE};
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::call(const std::string &callee, const std::vector<koopa_raw_value_t> &args)
+{
+  auto it = function_map.find(callee);
+  if (it == function_map.end())
+  {
+    std::cerr << "KoopaBuilder: undefined function " << callee << std::endl;
+    assert(0);
+  }
+  koopa_raw_value_data_t *inst = newValue(it->second->ret, nullptr);
+  inst->kind.tag = KOOPA_RVT_CALL;
+  inst->kind.data.call.callee = it->second->data;
+  inst->kind.data.call.args = slice(std::vector<const void *>(args.begin(), args.end()), KOOPA_RSIK_VALUE);
+  return append(inst);
+}
+
+koopa_raw_value_t KoopaBuilder::ret(koopa_raw_value_t value)
+{
+  koopa_raw_value_data_t *inst = newValue(unit_ty, nullptr);
+  inst->kind.tag = KOOPA_RVT_RETURN;
+  inst->kind.data.ret.value = value;
+  return append(inst);
+}
+
+koopa_raw_program_t KoopaBuilder::build()
+{
+  koopa_raw_program_t program;
+  program.values = slice(std::vector<const void *>(global_values.begin(), global_values.end()), KOOPA_RSIK_VALUE);
+  std::vector<const void *> funcs;
+  for (auto &info : function_infos)
+  {
+    funcs.push_back(info.data);
+  }
+  program.funcs = slice(funcs, KOOPA_RSIK_FUNCTION);
+  return program;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "koopa.h"
+
+/*
+ * 在内存中直接构造 Koopa raw program
+ * 以前 toIR 把整个程序拼成一个字符串, 后端再用 koopa_parse_from_string 解析回 raw program,
+ * 现在 AST 通过这里的接口直接生成 raw 结构, 只有 -koopa 模式才把它转成文本输出
+ *
+ * - 名字不带前缀, 值和函数自动加 "@", 基本块自动加 "%"
+ * - 所有 raw 结构都归 KoopaBuilder 所有, build() 返回的 program 在 builder 析构前有效
+ * - 基本块可以先被 br/jump 引用, 之后再用 label() 放到函数中
+ */
+class KoopaBuilder
+{
+  struct FunctionInfo
+  {
+    koopa_raw_function_data_t *data;
+    std::vector<koopa_raw_type_t> param_types;
+    std::vector<koopa_raw_value_t> params;
+    std::vector<koopa_raw_basic_block_data_t *> bbs;
+    koopa_raw_type_t ret;
+  };
+
+  std::deque<koopa_raw_type_kind_t> types;
+  std::deque<koopa_raw_value_data_t> values;
+  std::deque<koopa_raw_basic_block_data_t> blocks;
+  std::deque<koopa_raw_function_data_t> functions;
+  std::deque<std::vector<const void *>> buffers;
+  std::deque<std::string> names;
+  std::deque<FunctionInfo> function_infos;
+
+  koopa_raw_type_t int32_ty;
+  koopa_raw_type_t unit_ty;
+  std::map<koopa_raw_type_t, koopa_raw_type_t> pointer_types;
+  std::map<std::pair<koopa_raw_type_t, size_t>, koopa_raw_type_t> array_types;
+
+  std::vector<koopa_raw_value_t> global_values;
+  std::unordered_set<koopa_raw_value_t> readonly_globals;
+  std::unordered_map<std::string, FunctionInfo *> function_map;
+  std::unordered_map<std::string, koopa_raw_value_t> symbols;
+  std::unordered_map<std::string, koopa_raw_basic_block_data_t *> block_map;
+  std::unordered_map<koopa_raw_basic_block_data_t *, std::vector<koopa_raw_value_t>> block_insts;
+  std::unordered_map<int, koopa_raw_value_t> integers;
+
+  FunctionInfo *cur_func = nullptr;
+  koopa_raw_basic_block_data_t *cur_block = nullptr;
+
+  const char *intern(const std::string &name);
+  koopa_raw_slice_t slice(const std::vector<const void *> &items, koopa_raw_slice_item_kind_t kind);
+  koopa_raw_value_data_t *newValue(koopa_raw_type_t ty, const char *name);
+  koopa_raw_value_t append(koopa_raw_value_data_t *inst);
+
+public:
+  KoopaBuilder();
+
+  // 类型
+  koopa_raw_type_t int32Type() const { return int32_ty; }
+  koopa_raw_type_t unitType() const { return unit_ty; }
+  koopa_raw_type_t pointerType(koopa_raw_type_t base);
+  koopa_raw_type_t arrayType(koopa_raw_type_t base, size_t len);
+  koopa_raw_type_t arrayType(const std::vector<int> &dims);
+
+  // 全局的函数和变量
+  void declareFunction(const std::string &name, const std::vector<koopa_raw_type_t> &params, koopa_raw_type_t ret);
+  void beginFunction(const std::string &name, koopa_raw_type_t ret);
+  koopa_raw_value_t addParam(const std::string &name, koopa_raw_type_t ty);
+  void endFunction();
+  koopa_raw_function_t function(const std::string &name) const;
+  // readonly 表示由 const 声明; Koopa IR 无法表示只读, 由 readonlyGlobals 交给后端
+  koopa_raw_value_t globalAlloc(const std::string &name, koopa_raw_type_t ty, koopa_raw_value_t init, bool readonly = false);
+  const std::unordered_set<koopa_raw_value_t> &readonlyGlobals() const { return readonly_globals; }
+  koopa_raw_value_t integer(int value);
+  koopa_raw_value_t zeroInit(koopa_raw_type_t ty);
+  koopa_raw_value_t aggregate(koopa_raw_type_t ty, const std::vector<koopa_raw_value_t> &elems);
+  koopa_raw_value_t symbol(const std::string &name) const;
+
+  // 基本块
+  koopa_raw_basic_block_t block(const std::string &name);
+  void label(const std::string &name);
+  // option = 0 当前块是否已有终结指令, 1 是否以 ret 结束, 2 是否以带返回值的 ret 结束
+  bool isEnd(int option = 0) const;
+
+  // 指令
+  koopa_raw_value_t alloc(const std::string &name, koopa_raw_type_t ty);
+  koopa_raw_value_t load(koopa_raw_value_t src);
+  koopa_raw_value_t store(koopa_raw_value_t value, koopa_raw_value_t dest);
+  koopa_raw_value_t getElemPtr(koopa_raw_value_t src, koopa_raw_value_t index);
+  koopa_raw_value_t getPtr(koopa_raw_value_t src, koopa_raw_value_t index);
+  koopa_raw_value_t binary(const std::string &op, koopa_raw_value_t lhs, koopa_raw_value_t rhs);
+  koopa_raw_value_t branch(koopa_raw_value_t cond, koopa_raw_basic_block_t true_bb, koopa_raw_basic_block_t false_bb);
+  koopa_raw_value_t jump(koopa_raw_basic_block_t target);
+  koopa_raw_value_t call(const std::string &callee, const std::vector<koopa_raw_value_t> &args);
+  koopa_raw_value_t ret(koopa_raw_value_t value = nullptr);
+
+  koopa_raw_program_t build();
+};
@@ -1,56 +1,95 @@
 #pragma once
+#include <assert.h>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
-#include <map>
-// 
-/* 
-* this class is a symbol table for the compiler, the table is a vector of items, 
-* each item has a ident(string), type(enum class), and value(depend on the type, implemented by union)
-*  
+//
+/*
+* this class is a symbol table for the compiler.
+* 标识符在词法分析时驻留 (intern) 成 Symbol, 同名标识符共享一个 id, 之后只比较和索引 id
+*
 * functions:
-* 1. insert: insert a new symbol to the table, return true if success, otherwise return false
-* 2. find: find a symbol in the table, return the item if found, otherwise return nullptr
-* 
+* 1. insert: insert a new symbol to the current scope, return true if success, otherwise return false
+* 2. find: find the innermost visible definition of a symbol, return the item if found, otherwise return nullptr
+*
 * data structure:
-* item: enum class Type {CONST, VAR} , value(int) 目前只有int类型，引入数组后需要修改
-* single_table: map<string, item>
-* sysbol_table: // 为了实现作用域嵌套，理论上使用栈的数据结构更加方便。但是这里使用vector来实现，因为vector可以方便访问{上一层}的符号表，栈底是全局符号表
+* item: 种类 (CONST, VAR, ...), value, 所在作用域编号, 以及生成 IR 时使用的唯一名字
+* shadow: 按 Symbol id 索引, 每个符号一个栈, 栈顶是当前可见的定义, 查找是 O(1) 的
+* undo: 记录每次 insert 的符号, pop 作用域时按日志把这些符号的栈顶弹出
+* scopes: 每层作用域在 undo 中的起点和它的编号, 栈底是全局作用域
 * let's start!
- */class Item {
+ */
+class Symbol {
+public:
+    int id = -1;
+    Symbol() {}
+    explicit Symbol(int id) : id(id) {}
+    Symbol(const std::string &name) : id(intern(name)) {}
+    Symbol(const char *name) : id(intern(name)) {}
+    const std::string &str() const { return names()[id]; }
+    operator const std::string &() const { return str(); }
+    bool operator==(const Symbol &other) const { return id == other.id; }
+    bool operator!=(const Symbol &other) const { return id != other.id; }
+
+    // 返回 name 的 id, 第一次出现时分配新的 id; 已经出现过的名字不会再分配字符串
+    static int intern(std::string_view name) {
+        auto it = ids().find(name);
+        if (it != ids().end()) return it->second;
+        int id = static_cast<int>(names().size());
+        names().emplace_back(name);
+        ids().emplace(names().back(), id);
+        return id;
+    }
+    static int count() { return static_cast<int>(names().size()); }
+
+private:
+    // deque 追加元素时不会移动已有的字符串, str() 返回的引用一直有效
+    static std::deque<std::string> &names() {
+        static std::deque<std::string> names;
+        return names;
+    }
+    // 键指向 names 中的字符串
+    static std::unordered_map<std::string_view, int> &ids() {
+        static std::unordered_map<std::string_view, int> ids;
+        return ids;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const Symbol &sym) { return os << sym.str(); }
+inline std::string operator+(const std::string &lhs, const Symbol &rhs) { return lhs + rhs.str(); }
+inline std::string operator+(const char *lhs, const Symbol &rhs) { return lhs + rhs.str(); }
+
+class Item {
 public:
     enum class Type {CONST, VAR, FUNC, CARRAY, VARRAY, PTR};
     Type type;
     int value;
+    int scope = 0; // 所在作用域的编号
+    std::string name; // IR 中的唯一名字: 标识符_作用域编号
     Item(Type type, int value): type(type), value(value) {} // 如果是函数的话，value表示FuncType，如果FuncType是0表示void，否则表示int类型, 如果是数组的话，value表示数组的维度长度（方括号的个数）
     Item() {}
-    bool isConst() { return type == Type::CONST; }
-    bool isVar() { return type == Type::VAR; }
-    bool isFunc() { return type == Type::FUNC; }
-    bool isPtr() { return type == Type::PTR; }
-    bool isArray() { return type == Type::CARRAY || type == Type::VARRAY;}
-    int getValue() { return value; }
-};
-
-class SingleTable {
-public:
-    std::map<std::string, Item> table;
-    int index;
-    SingleTable(int idx) : index(idx) {} // 初始化索引值
-    bool insert(std::string ident, Item item) {
-        if (table.find(ident) != table.end()) return false;
-        table[ident] = item;
-        return true;
-    }
-    Item* find(std::string ident) {
-        if (table.find(ident) == table.end()) return nullptr;
-        return &table[ident];
-    }
+    bool isConst() const { return type == Type::CONST; }
+    bool isVar() const { return type == Type::VAR; }
+    bool isFunc() const { return type == Type::FUNC; }
+    bool isPtr() const { return type == Type::PTR; }
+    bool isArray() const { return type == Type::CARRAY || type == Type::VARRAY;}
+    int getValue() const { return value; }
 };
 
 class SymbolTable {
-public:
-    std::vector<SingleTable> tables;
+    struct Scope {
+        size_t undo_begin;
+        int index;
+    };
+    std::vector<std::vector<Item>> shadow;
+    std::vector<int> undo;
+    std::vector<Scope> scopes;
     int only_increase_index;
+
+public:
     SymbolTable() {
         only_increase_index = 0;
         push();
@@ -64,84 +103,84 @@ public:
         insert("starttime", Item(Item::Type::FUNC, 0));
         insert("stoptime", Item(Item::Type::FUNC, 0));
     }
-    bool insert(std::string ident, Item item) {
-        return tables.back().insert(ident, item);
+    bool insert(Symbol sym, Item item) {
+        if (sym.id >= static_cast<int>(shadow.size())) shadow.resize(Symbol::count());
+        auto &stack = shadow[sym.id];
+        int index = scopes.back().index;
+        if (!stack.empty() && stack.back().scope == index) return false;
+        item.scope = index;
+        item.name = sym.str() + "_" + std::to_string(index);
+        stack.push_back(std::move(item));
+        undo.push_back(sym.id);
+        return true;
     }
-    Item* find(std::string ident) {
-        for (int i = tables.size() - 1; i >= 0; i--) {
-            Item* item = tables[i].find(ident);
-            if (item != nullptr) return item;
-        }
-        return nullptr;
-    }
-    bool isConst(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return false;
-        return item->isConst();
-    }
-    bool isVar(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return false;
-        return item->isVar();
-    }
-    bool isFunc(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return false;
-        return item->isFunc();
-    }
-    int getValue(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return 0;
-        return item->getValue();
-    }
-    bool isVoid(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return false;
-        return item->getValue() == 0;
-    }
-    bool isPtr(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return false;
-        return item->isPtr();
-    }
-    bool isArray(std::string ident) {
-        Item* item = find(ident);
-        if (item == nullptr) return false;
-        return item->isArray();
+    // 返回的指针在下一次 insert 或 pop 之前有效
+    Item* find(Symbol sym) {
+        if (sym.id < 0 || sym.id >= static_cast<int>(shadow.size()) || shadow[sym.id].empty()) return nullptr;
+        return &shadow[sym.id].back();
+    }
+    bool isConst(Symbol sym) {
+        Item* item = find(sym);
+        return item != nullptr && item->isConst();
+    }
+    bool isVar(Symbol sym) {
+        Item* item = find(sym);
+        return item != nullptr && item->isVar();
+    }
+    bool isFunc(Symbol sym) {
+        Item* item = find(sym);
+        return item != nullptr && item->isFunc();
+    }
+    int getValue(Symbol sym) {
+        Item* item = find(sym);
+        return item == nullptr ? 0 : item->getValue();
+    }
+    bool isVoid(Symbol sym) {
+        Item* item = find(sym);
+        return item != nullptr && item->getValue() == 0;
+    }
+    bool isPtr(Symbol sym) {
+        Item* item = find(sym);
+        return item != nullptr && item->isPtr();
+    }
+    bool isArray(Symbol sym) {
+        Item* item = find(sym);
+        return item != nullptr && item->isArray();
     }
     void push() {
-        tables.emplace_back(only_increase_index++);
+        scopes.push_back({undo.size(), only_increase_index++});
     }
     void pop() {
-        tables.pop_back();
-    }
-    std::string getUniqueIdent(std::string ident) {
-        // print();
-        int x = 999;
-        for (int i = tables.size() - 1; i >= 0; i--) {
-            if (tables[i].find(ident) != nullptr) {
-                x = tables[i].index;
-                break;
-            }
+        while (undo.size() > scopes.back().undo_begin) {
+            shadow[undo.back()].pop_back();
+            undo.pop_back();
         }
-        if(x == 999)
-        {
+        scopes.pop_back();
+    }
+    const std::string &getUniqueIdent(Symbol sym) {
+        Item* item = find(sym);
+        if (item == nullptr) {
             print();
+            std::cerr << "getUniqueIdent: undefined ident " << sym << std::endl;
+            assert(0);
         }
-        return ident + "_" + std::to_string(x);
+        return item->name;
     }
     void print() {
         std::cout << "---------------------------------------------" << std::endl;
-        for (int i = 0; i < tables.size(); i++) {
+        for (size_t i = 0; i < scopes.size(); i++) {
             std::cout << "table " << i << ", ";
-            std::cout << "index " << tables[i].index << std::endl;
-            for (auto it = tables[i].table.begin(); it != tables[i].table.end(); it++) {
-                std::cout << it->first << " " << it->second.value << std::endl;
+            std::cout << "index " << scopes[i].index << std::endl;
+            size_t end = i + 1 < scopes.size() ? scopes[i + 1].undo_begin : undo.size();
+            for (size_t k = scopes[i].undo_begin; k < end; k++) {
+                for (const auto &item : shadow[undo[k]]) {
+                    if (item.scope == scopes[i].index) std::cout << Symbol(undo[k]) << " " << item.value << std::endl;
+                }
             }
         }
     }
 
     bool isGlobal() {
-        return tables.back().index == 0;
+        return scopes.back().index == 0;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * 一行汇编: label 非空时是标签行, 否则是指令 op args...
+ * 后端先把一个函数的代码收集成 AsmInst 序列, 做完窥孔优化再输出
+ */
+struct AsmInst {
+  std::string op;
+  std::vector<std::string> args;
+  std::string label;
+
+  bool is_label() const { return !label.empty(); }
+};
+
+std::ostream &operator<<(std::ostream &os, const AsmInst &inst);
+
+// 在一个函数的汇编上反复应用窥孔规则直到不再变化, 返回是否修改
+bool peephole(std::vector<AsmInst> &code);
@@ -0,0 +1,92 @@
+#include "passes.hh"
+#include "loops.hh"
+
+using ir::Op;
+
+namespace {
+
+class Layout {
+  ir::Function &func;
+  DominatorTree dom;
+  LoopInfo loops;
+  std::vector<int> rotated_body; // 可以旋转的循环头 -> 循环中的后继, 否则为 -1
+  std::vector<char> placed;
+  std::vector<int> order;
+
+  bool in_loop_of(int header, int block) const {
+    int l = loops.innermost[header];
+    return l >= 0 && loops.contains(l, block);
+  }
+
+  /*
+   * 循环头以 br 结尾, 一个后继在循环内, 一个在循环外时可以旋转:
+   * 先放循环体, 循环头放在最后, latch 落入循环头, 条件成立时跳回循环体, 否则落入出口
+   */
+  void find_rotatable() {
+    rotated_body.assign(func.blocks.size(), -1);
+    for (const auto &loop : loops.loops) {
+      int h = loop.header;
+      const auto &term = func.insts[func.blocks[h].insts.back()];
+      if (h == 0 || term.op != Op::Br) continue;
+      int t = term.targets[0], f = term.targets[1];
+      bool t_in = in_loop_of(h, t) && t != h, f_in = in_loop_of(h, f) && f != h;
+      if (t_in != f_in) rotated_body[h] = t_in ? t : f;
+    }
+  }
+
+  // 从 from 转到 to 时接着摆放的块: 从循环外进入可旋转的循环时先放循环体
+  int follow(int from, int to) const {
+    if (placed[to]) return -1;
+    int body = rotated_body[to];
+    if (body >= 0 && !in_loop_of(to, from) && !placed[body]) return body;
+    return to;
+  }
+
+  // b 之后落入的块: jump 的目标, 或 br 中与 b 在同一层循环的后继 (都可以时取条件成立的一边)
+  int next_of(int b) const {
+    const auto &term = func.insts[func.blocks[b].insts.back()];
+    if (term.op == Op::Jump) return follow(b, term.targets[0]);
+    if (term.op != Op::Br) return -1;
+    int best = -1;
+    for (int t : term.targets) {
+      int n = follow(b, t);
+      if (n < 0) continue;
+      if (loops.innermost[n] == loops.innermost[b]) return n;
+      if (best < 0) best = n;
+    }
+    return best;
+  }
+
+  void chain(int b) {
+    while (b >= 0 && !placed[b]) {
+      placed[b] = 1;
+      order.push_back(b);
+      b = next_of(b);
+    }
+  }
+
+public:
+  explicit Layout(ir::Function &func) : func(func), dom(func), loops(func, dom) {}
+
+  bool run() {
+    find_rotatable();
+    placed.assign(func.blocks.size(), 0);
+    chain(0);
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+      if (!placed[b]) chain(b);
+    }
+    bool changed = false;
+    for (size_t i = 0; i < order.size(); ++i) {
+      if (order[i] != static_cast<int>(i)) changed = true;
+    }
+    if (changed) func.reorder_blocks(order);
+    return changed;
+  }
+};
+
+} // namespace
+
+bool BlockLayout::run_on_function(ir::Module &, ir::Function &func) {
+  bool changed = func.remove_unreachable();
+  return Layout(func).run() || changed;
+}
@@ -0,0 +1,133 @@
+#include "passes.hh"
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+/*
+ * 指针的来源: 全局变量 (param < 0 时, id 为全局变量下标) 或函数参数 (id 为函数下标, param 为参数序号)
+ * offset 为相对来源的字节偏移, 经过变量下标时 exact 为假
+ */
+struct Root {
+  int id = -1;
+  int param = -1;
+  long long offset = 0;
+  bool exact = true;
+};
+
+class ReadOnlyGlobals {
+  ir::Module &module;
+  std::vector<char> global_written;
+  std::vector<std::vector<char>> param_written; // 按函数下标, 参数序号索引
+
+  Root root_of(int func_id, Operand ptr) const {
+    const auto &func = module.funcs[func_id];
+    Root root;
+    while (ptr.is_value()) {
+      const auto &inst = func.insts[ptr.id];
+      if (inst.op == Op::GetElemPtr || inst.op == Op::GetPtr) {
+        if (inst.ops[1].is_const()) root.offset += static_cast<long long>(inst.ops[1].id) * inst.size;
+        else root.exact = false;
+        ptr = inst.ops[0];
+      } else if (inst.op == Op::GlobalAddr) {
+        ptr = inst.ops[0];
+      } else if (inst.op == Op::Arg && inst.ty == ir::Type::Ptr) {
+        root.id = func_id;
+        root.param = inst.size;
+        return root;
+      } else {
+        return root;
+      }
+    }
+    if (ptr.kind == Operand::GLOBAL) root.id = ptr.id;
+    return root;
+  }
+
+  // 指令 inst 的第 k 个操作数只是被读取: load 的地址, 派生出新地址, 或传给不写入该参数的函数
+  bool read_only_use(const ir::Inst &inst, size_t k) const {
+    switch (inst.op) {
+      case Op::Load: return true;
+      case Op::GetElemPtr:
+      case Op::GetPtr:
+      case Op::GlobalAddr: return k == 0;
+      case Op::Call: return !module.funcs[inst.callee].is_decl && !param_written[inst.callee][k];
+      default: return false;
+    }
+  }
+
+  bool mark(const Root &root) {
+    char &written = root.param < 0 ? global_written[root.id] : param_written[root.id][root.param];
+    if (written) return false;
+    written = 1;
+    return true;
+  }
+
+public:
+  explicit ReadOnlyGlobals(ir::Module &module) : module(module) {}
+
+  // 先假定都没有被写入, 再从 store, 逃逸和写入参数的调用出发标记, 直到不再变化
+  void analyze() {
+    global_written.assign(module.globals.size(), 0);
+    param_written.clear();
+    for (auto &func : module.funcs) param_written.emplace_back(func.params.size(), 0);
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (size_t f = 0; f < module.funcs.size(); ++f) {
+        const auto &func = module.funcs[f];
+        for (auto &block : func.blocks) {
+          for (int id : block.insts) {
+            const auto &inst = func.insts[id];
+            for (size_t k = 0; k < inst.ops.size(); ++k) {
+              Root root = root_of(f, inst.ops[k]);
+              if (root.id < 0 || read_only_use(inst, k)) continue;
+              if (mark(root)) changed = true;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // 只读全局变量的常量下标 load 直接取初值
+  bool fold_loads() {
+    bool changed = false;
+    for (size_t f = 0; f < module.funcs.size(); ++f) {
+      auto &func = module.funcs[f];
+      for (auto &block : func.blocks) {
+        for (int id : std::vector<int>(block.insts)) {
+          const auto &inst = func.insts[id];
+          if (inst.op != Op::Load || inst.ty != ir::Type::I32) continue;
+          Root root = root_of(f, inst.ops[0]);
+          if (root.id < 0 || root.param >= 0 || !root.exact || !module.globals[root.id].readonly) continue;
+          const auto &global = module.globals[root.id];
+          if (root.offset < 0 || root.offset + 4 > global.size || root.offset % 4 != 0) continue;
+          int value = global.init.empty() ? 0 : global.init[root.offset / 4];
+          func.replace_all_uses(id, Operand::constant(value));
+          func.remove_inst(id);
+          changed = true;
+        }
+      }
+    }
+    return changed;
+  }
+
+  bool run() {
+    analyze();
+    bool changed = false;
+    // const 声明的全局变量在 from_koopa 时已经是只读的, 这里补上从未被写入的非 const 全局变量
+    for (size_t g = 0; g < module.globals.size(); ++g) {
+      if (module.globals[g].readonly || global_written[g]) continue;
+      module.globals[g].readonly = true;
+      changed = true;
+    }
+    return fold_loads() || changed;
+  }
+};
+
+} // namespace
+
+bool ConstGlobals::run(ir::Module &module) {
+  return ReadOnlyGlobals(module).run();
+}
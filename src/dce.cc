@@ -0,0 +1,76 @@
+#include "passes.hh"
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+// 只被写入、从不被读取的局部变量 (地址只经过 getelemptr / getptr 传给 store)
+bool write_only(const ir::Function &func, int alloc, std::vector<int> &users) {
+  std::vector<int> worklist = {alloc};
+  while (!worklist.empty()) {
+    int v = worklist.back();
+    worklist.pop_back();
+    for (int user : func.uses[v]) {
+      const auto &inst = func.insts[user];
+      if (inst.op == Op::Store && inst.ops[1] == Operand::value(v) && inst.ops[0] != Operand::value(v)) {
+        users.push_back(user);
+      } else if ((inst.op == Op::GetElemPtr || inst.op == Op::GetPtr) && inst.ops[0] == Operand::value(v)) {
+        users.push_back(user);
+        worklist.push_back(user);
+      } else {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+bool DCE::run_on_function(ir::Module &, ir::Function &func) {
+  bool changed = false;
+
+  // 先删除只写不读的局部变量及其 store
+  for (auto &block : func.blocks) {
+    for (int id : std::vector<int>(block.insts)) {
+      if (func.insts[id].op != Op::Alloc || func.insts[id].dead) continue;
+      std::vector<int> users;
+      if (!write_only(func, id, users)) continue;
+      for (int user : users) func.remove_inst(user);
+      func.remove_inst(id);
+      changed = true;
+    }
+  }
+
+  // 标记: 从有副作用的指令出发, 沿操作数标记所有被用到的值
+  std::vector<char> live(func.insts.size(), 0);
+  std::vector<int> worklist;
+  for (auto &block : func.blocks) {
+    for (int id : block.insts) {
+      if (ir::is_pure(func.insts[id].op) || func.insts[id].op == Op::Load) continue;
+      live[id] = 1;
+      worklist.push_back(id);
+    }
+  }
+  while (!worklist.empty()) {
+    int id = worklist.back();
+    worklist.pop_back();
+    for (auto &op : func.insts[id].ops) {
+      if (op.is_value() && !live[op.id]) {
+        live[op.id] = 1;
+        worklist.push_back(op.id);
+      }
+    }
+  }
+
+  // 清除: 死值之间可能互相引用 (如循环中的 phi), 一起删除即可
+  for (auto &block : func.blocks) {
+    for (int id : std::vector<int>(block.insts)) {
+      if (live[id]) continue;
+      func.remove_inst(id);
+      changed = true;
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,90 @@
+#include "dominance.hh"
+#include <algorithm>
+
+DominatorTree::DominatorTree(const ir::Function &func) {
+  size_t n = func.blocks.size();
+  idom.assign(n, -1);
+  children.assign(n, {});
+  rpo = func.reverse_post_order();
+  std::vector<int> order(n, -1);
+  for (size_t i = 0; i < rpo.size(); ++i) order[rpo[i]] = i;
+
+  auto intersect = [&](int a, int b) {
+    while (a != b) {
+      while (order[a] > order[b]) a = idom[a];
+      while (order[b] > order[a]) b = idom[b];
+    }
+    return a;
+  };
+  if (n == 0) return;
+  idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo.size(); ++i) {
+      int b = rpo[i];
+      int new_idom = -1;
+      for (int p : func.blocks[b].preds) {
+        if (order[p] < 0 || idom[p] < 0) continue;
+        new_idom = new_idom < 0 ? p : intersect(p, new_idom);
+      }
+      if (new_idom != idom[b]) {
+        idom[b] = new_idom;
+        changed = true;
+      }
+    }
+  }
+  idom[0] = -1;
+  for (size_t i = 1; i < rpo.size(); ++i) children[idom[rpo[i]]].push_back(rpo[i]);
+
+  // 先序 / 后序编号, 用于 O(1) 判断支配关系
+  pre.assign(n, -1);
+  post.assign(n, -1);
+  int pre_count = 0, post_count = 0;
+  std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+  pre[0] = pre_count++;
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.second < children[top.first].size()) {
+      int c = children[top.first][top.second++];
+      pre[c] = pre_count++;
+      stack.push_back({c, 0});
+    } else {
+      post[top.first] = post_count++;
+      stack.pop_back();
+    }
+  }
+}
+
+bool DominatorTree::dominates(int a, int b) const {
+  if (pre[a] < 0 || pre[b] < 0) return false;
+  return pre[a] <= pre[b] && post[b] <= post[a];
+}
+
+std::vector<int> DominatorTree::preorder() const {
+  std::vector<int> order;
+  if (idom.empty()) return order;
+  std::vector<int> stack = {0};
+  while (!stack.empty()) {
+    int b = stack.back();
+    stack.pop_back();
+    order.push_back(b);
+    for (auto it = children[b].rbegin(); it != children[b].rend(); ++it) stack.push_back(*it);
+  }
+  return order;
+}
+
+std::vector<std::vector<int>> DominatorTree::frontiers(const ir::Function &func) const {
+  std::vector<std::vector<int>> df(func.blocks.size());
+  for (int b : rpo) {
+    const auto &preds = func.blocks[b].preds;
+    if (preds.size() < 2) continue;
+    for (int p : preds) {
+      if (!reachable(p)) continue;
+      for (int runner = p; runner != idom[b]; runner = idom[runner]) {
+        if (std::find(df[runner].begin(), df[runner].end(), b) == df[runner].end()) df[runner].push_back(b);
+      }
+    }
+  }
+  return df;
+}
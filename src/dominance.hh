@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include "ir.hh"
+
+/*
+ * 支配树, 使用 Cooper, Harvey & Kennedy 的迭代算法
+ * 只考虑从入口可达的块, 不可达块的 idom 为 -1
+ */
+class DominatorTree {
+  std::vector<int> pre;  // 支配树先序编号
+  std::vector<int> post; // 支配树后序编号
+
+public:
+  std::vector<int> idom;
+  std::vector<std::vector<int>> children;
+  std::vector<int> rpo; // CFG 的逆后序
+
+  explicit DominatorTree(const ir::Function &func);
+  bool reachable(int b) const { return b == 0 || idom[b] >= 0; }
+  // a 是否支配 b (自身支配自身)
+  bool dominates(int a, int b) const;
+  // 支配树的先序遍历
+  std::vector<int> preorder() const;
+  // 支配边界 DF(b)
+  std::vector<std::vector<int>> frontiers(const ir::Function &func) const;
+};
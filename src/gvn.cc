@@ -0,0 +1,226 @@
+#include "passes.hh"
+#include <algorithm>
+#include <unordered_map>
+#include "dominance.hh"
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+struct KeyHash {
+  size_t operator()(const std::vector<int> &key) const {
+    size_t h = key.size();
+    for (int x : key) h = h * 1000003u ^ static_cast<size_t>(x);
+    return h;
+  }
+};
+
+// 纯指令的键: 操作码, 步长和操作数; 可交换运算的操作数排序, a > b 记作 b < a
+std::vector<int> key_of(const ir::Inst &inst) {
+  Op op = inst.op;
+  std::vector<Operand> ops = inst.ops;
+  auto less = [](const Operand &a, const Operand &b) { return a.kind != b.kind ? a.kind < b.kind : a.id < b.id; };
+  if (ir::is_commutative(op) && less(ops[1], ops[0])) std::swap(ops[0], ops[1]);
+  if (op == Op::Gt || op == Op::Ge) {
+    op = op == Op::Gt ? Op::Lt : Op::Le;
+    std::swap(ops[0], ops[1]);
+  }
+  std::vector<int> key = {static_cast<int>(op), inst.size};
+  for (auto &operand : ops) {
+    key.push_back(operand.kind);
+    key.push_back(operand.id);
+  }
+  return key;
+}
+
+/*
+ * 可用的内存值: 地址 -> 该地址上的值 (来自 load 或 store)
+ * 地址按其根对象分类, 写入时只使可能别名的项失效:
+ * - 局部 alloc 只会被同一根的地址访问, 作为参数传出后调用也可能修改它
+ * - 全局变量和来自参数的指针之间可能互为别名
+ * - 汇合了不同根的指针 phi (如强度削减产生的归纳指针) 可能指向任何对象
+ */
+constexpr int ROOT_EXTERN = -1;  // 全局变量或参数指针
+constexpr int ROOT_UNKNOWN = -2; // 可能是任何对象
+constexpr int ROOT_UNSET = -3;   // 计算根时 phi 的初值
+
+struct Memory {
+  struct Entry {
+    Operand addr;
+    Operand value;
+    int root; // alloc 的编号, 或 ROOT_EXTERN, ROOT_UNKNOWN
+  };
+  std::vector<Entry> entries;
+
+  const Operand *find(const Operand &addr) const {
+    for (auto &entry : entries) {
+      if (entry.addr == addr) return &entry.value;
+    }
+    return nullptr;
+  }
+  void kill(int root) {
+    auto end = std::remove_if(entries.begin(), entries.end(), [&](const Entry &entry) {
+      return root == ROOT_UNKNOWN || entry.root == ROOT_UNKNOWN || entry.root == root;
+    });
+    entries.erase(end, entries.end());
+  }
+  void kill_for_call(const std::vector<char> &escaped) {
+    auto end = std::remove_if(entries.begin(), entries.end(), [&](const Entry &entry) {
+      return entry.root < 0 || escaped[entry.root];
+    });
+    entries.erase(end, entries.end());
+  }
+  void set(const Operand &addr, const Operand &value, int root) {
+    for (auto &entry : entries) {
+      if (entry.addr == addr) {
+        entry.value = value;
+        return;
+      }
+    }
+    entries.push_back({addr, value, root});
+  }
+};
+
+class ValueNumbering {
+  ir::Function &func;
+  DominatorTree dom;
+  std::unordered_map<std::vector<int>, int, KeyHash> table;
+  std::vector<int> root;     // 指针值的根 alloc, 或 ROOT_EXTERN, ROOT_UNKNOWN
+  std::vector<char> escaped; // alloc 的地址是否被传给了函数调用
+  std::vector<Memory> memory_out;
+  bool changed = false;
+
+  int root_of(const Operand &ptr) const {
+    if (!ptr.is_value()) return ROOT_EXTERN;
+    return func.insts[ptr.id].op == Op::Alloc ? ptr.id : root[ptr.id];
+  }
+
+  // phi 的根是各入边的公共根, 入边的根不同时为 ROOT_UNKNOWN; 循环中的 phi 需要迭代到不动点
+  void compute_roots() {
+    root.assign(func.insts.size(), ROOT_EXTERN);
+    for (int b : dom.rpo) {
+      for (int id : func.blocks[b].insts) {
+        if (func.insts[id].op == Op::Phi) root[id] = ROOT_UNSET;
+      }
+    }
+    for (bool again = true; again;) {
+      again = false;
+      for (int b : dom.rpo) {
+        for (int id : func.blocks[b].insts) {
+          const auto &inst = func.insts[id];
+          int r = root[id];
+          if (inst.op == Op::GetElemPtr || inst.op == Op::GetPtr) {
+            r = root_of(inst.ops[0]);
+          } else if (inst.op == Op::Phi) {
+            for (auto &op : inst.ops) {
+              int incoming = root_of(op);
+              if (incoming == ROOT_UNSET) continue;
+              r = r == ROOT_UNSET || r == incoming ? incoming : ROOT_UNKNOWN;
+            }
+          }
+          if (r != root[id]) {
+            root[id] = r;
+            again = true;
+          }
+        }
+      }
+    }
+    // 只在不可达的环上的 phi 没有得到根
+    for (int &r : root) {
+      if (r == ROOT_UNSET) r = ROOT_UNKNOWN;
+    }
+    // 传给调用的地址可能被修改; 根未知的指针可能指向任何 alloc
+    escaped.assign(func.insts.size(), 0);
+    for (int b : dom.rpo) {
+      for (int id : func.blocks[b].insts) {
+        const auto &inst = func.insts[id];
+        if (inst.op != Op::Call) continue;
+        for (auto &op : inst.ops) {
+          int r = root_of(op);
+          if (r >= 0) {
+            escaped[r] = 1;
+          } else if (r == ROOT_UNKNOWN) {
+            std::fill(escaped.begin(), escaped.end(), 1);
+          }
+        }
+      }
+    }
+  }
+
+  void replace(int id, const Operand &with) {
+    func.replace_all_uses(id, with);
+    func.remove_inst(id);
+    changed = true;
+  }
+
+  // 处理块 b, 返回新加入表中的键以便离开时撤销
+  std::vector<std::vector<int>> visit_block(int b, Memory memory) {
+    std::vector<std::vector<int>> added;
+    for (int id : std::vector<int>(func.blocks[b].insts)) {
+      const auto &inst = func.insts[id];
+      if (ir::is_pure(inst.op) && inst.op != Op::Phi) {
+        auto key = key_of(inst);
+        auto it = table.find(key);
+        if (it != table.end()) {
+          replace(id, Operand::value(it->second));
+        } else {
+          table.emplace(key, id);
+          added.push_back(std::move(key));
+        }
+      } else if (inst.op == Op::Load) {
+        if (const Operand *value = memory.find(inst.ops[0])) {
+          replace(id, *value);
+        } else {
+          memory.set(inst.ops[0], Operand::value(id), root_of(inst.ops[0]));
+        }
+      } else if (inst.op == Op::Store) {
+        int r = root_of(inst.ops[1]);
+        memory.kill(r);
+        if (inst.size == 0) memory.set(inst.ops[1], inst.ops[0], r);
+      } else if (inst.op == Op::Call) {
+        memory.kill_for_call(escaped);
+      }
+    }
+    memory_out[b] = std::move(memory);
+    return added;
+  }
+
+public:
+  explicit ValueNumbering(ir::Function &func) : func(func), dom(func), memory_out(func.blocks.size()) {}
+
+  bool run() {
+    compute_roots();
+    // 沿支配树先序处理, 表中只有支配当前块的指令;
+    // 内存值只在块的唯一前驱就是其直接支配者时向下传递
+    struct Frame {
+      int block;
+      bool leaving;
+      std::vector<std::vector<int>> added;
+    };
+    std::vector<Frame> stack = {{0, false, {}}};
+    while (!stack.empty()) {
+      Frame frame = std::move(stack.back());
+      stack.pop_back();
+      int b = frame.block;
+      if (frame.leaving) {
+        for (auto &key : frame.added) table.erase(key);
+        memory_out[b] = Memory();
+        continue;
+      }
+      Memory memory;
+      const auto &preds = func.blocks[b].preds;
+      if (preds.size() == 1 && preds[0] == dom.idom[b]) memory = memory_out[preds[0]];
+      auto added = visit_block(b, std::move(memory));
+      stack.push_back({b, true, std::move(added)});
+      for (auto it = dom.children[b].rbegin(); it != dom.children[b].rend(); ++it) stack.push_back({*it, false, {}});
+    }
+    return changed;
+  }
+};
+
+} // namespace
+
+bool GVN::run_on_function(ir::Module &, ir::Function &func) {
+  return ValueNumbering(func).run();
+}
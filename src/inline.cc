@@ -0,0 +1,183 @@
+#include "passes.hh"
+#include <algorithm>
+#include <functional>
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+int size_of(const ir::Function &func) {
+  int size = 0;
+  for (auto &block : func.blocks) size += block.insts.size();
+  return size;
+}
+
+// 把 callee 的函数体复制到 caller 中, 替换块 b 中的调用 call
+class CallInliner {
+  ir::Function &caller;
+  const ir::Function &callee;
+  std::vector<int> &layout;
+
+public:
+  CallInliner(ir::Function &caller, const ir::Function &callee, std::vector<int> &layout)
+      : caller(caller), callee(callee), layout(layout) {}
+
+  void inline_call(int call) {
+    int b = caller.insts[call].block;
+    std::vector<Operand> args = caller.insts[call].ops;
+
+    // 调用之后的指令移到新块 rest 中, b 的后继中的 phi 改为来自 rest
+    int rest = caller.add_block(caller.new_label(callee.name + "_ret"));
+    auto &list = caller.blocks[b].insts;
+    auto pos = std::find(list.begin(), list.end(), call) + 1;
+    std::vector<int> tail(pos, list.end());
+    list.erase(pos, list.end());
+    for (int id : tail) caller.insts[id].block = rest;
+    caller.blocks[rest].insts = tail;
+    for (int s : caller.blocks[b].succs) {
+      for (int id : caller.blocks[s].insts) {
+        if (caller.insts[id].op != Op::Phi) break;
+        for (auto &t : caller.insts[id].targets) {
+          if (t == b) t = rest;
+        }
+      }
+    }
+
+    // 复制块和指令, 参数映射为实参
+    std::vector<int> block_map(callee.blocks.size());
+    std::vector<int> inserted;
+    for (size_t cb = 0; cb < callee.blocks.size(); ++cb) {
+      block_map[cb] = caller.add_block(caller.new_label(callee.name + "_" + callee.blocks[cb].name));
+      inserted.push_back(block_map[cb]);
+    }
+    std::vector<Operand> value_map(callee.insts.size());
+    for (size_t i = 0; i < callee.params.size(); ++i) value_map[callee.params[i]] = args[i];
+    std::vector<std::pair<int, int>> cloned; // (新指令, 原指令)
+    for (size_t cb = 0; cb < callee.blocks.size(); ++cb) {
+      for (int id : callee.blocks[cb].insts) {
+        ir::Inst copy = callee.insts[id];
+        copy.ops.clear();
+        int nid = caller.append(block_map[cb], copy);
+        value_map[id] = Operand::value(nid);
+        cloned.push_back({nid, id});
+      }
+    }
+    std::vector<std::pair<Operand, int>> returns; // (返回值, 所在块)
+    for (auto [nid, id] : cloned) {
+      const auto &orig = callee.insts[id];
+      auto &inst = caller.insts[nid];
+      for (auto &op : orig.ops) {
+        Operand mapped = op.is_value() ? value_map[op.id] : op;
+        inst.ops.push_back(mapped);
+        if (mapped.is_value()) caller.uses[mapped.id].push_back(nid);
+      }
+      for (auto &t : inst.targets) t = block_map[t];
+      if (inst.op == Op::Ret) {
+        // ret 改为跳到 rest
+        if (!inst.ops.empty()) {
+          returns.push_back({inst.ops[0], inst.block});
+          caller.set_operand(nid, 0, Operand());
+        }
+        inst.ops.clear();
+        inst.op = Op::Jump;
+        inst.targets = {rest};
+      }
+    }
+
+    if (caller.insts[call].ty != ir::Type::Unit) {
+      Operand result;
+      if (returns.size() == 1) {
+        result = returns[0].first;
+      } else {
+        int phi = caller.insert(rest, 0, ir::Inst(Op::Phi, caller.insts[call].ty));
+        for (auto &[value, from] : returns) caller.add_incoming(phi, value, from);
+        result = Operand::value(phi);
+      }
+      caller.replace_all_uses(call, result);
+    }
+    caller.remove_inst(call);
+    ir::Inst jump(Op::Jump);
+    jump.targets = {block_map[0]};
+    caller.append(b, jump);
+
+    inserted.push_back(rest);
+    auto at = std::find(layout.begin(), layout.end(), b) + 1;
+    layout.insert(at, inserted.begin(), inserted.end());
+    caller.compute_cfg();
+  }
+};
+
+} // namespace
+
+bool Inliner::run(ir::Module &module) {
+  size_t n = module.funcs.size();
+  std::vector<std::vector<int>> callees(n);
+  std::vector<int> call_sites(n, 0);
+  for (size_t f = 0; f < n; ++f) {
+    for (auto &block : module.funcs[f].blocks) {
+      for (int id : block.insts) {
+        const auto &inst = module.funcs[f].insts[id];
+        if (inst.op != Op::Call) continue;
+        callees[f].push_back(inst.callee);
+        call_sites[inst.callee]++;
+      }
+    }
+  }
+
+  // 能经过调用回到自身的函数是递归的, 不内联
+  std::vector<char> recursive(n, 0);
+  for (size_t f = 0; f < n; ++f) {
+    std::vector<char> seen(n, 0);
+    std::vector<int> stack(callees[f].begin(), callees[f].end());
+    while (!stack.empty() && !recursive[f]) {
+      int g = stack.back();
+      stack.pop_back();
+      if (g == static_cast<int>(f)) recursive[f] = 1;
+      if (seen[g]) continue;
+      seen[g] = 1;
+      stack.insert(stack.end(), callees[g].begin(), callees[g].end());
+    }
+  }
+
+  // 自底向上: 先处理被调函数, 内联进调用者时它已经是内联后的大小
+  std::vector<int> order;
+  std::vector<char> visited(n, 0);
+  std::function<void(int)> post_order = [&](int f) {
+    visited[f] = 1;
+    for (int g : callees[f]) {
+      if (!visited[g]) post_order(g);
+    }
+    order.push_back(f);
+  };
+  for (size_t f = 0; f < n; ++f) {
+    if (!visited[f]) post_order(f);
+  }
+
+  bool changed = false;
+  for (int f : order) {
+    auto &caller = module.funcs[f];
+    if (caller.is_decl) continue;
+    std::vector<int> calls;
+    for (auto &block : caller.blocks) {
+      for (int id : block.insts) {
+        const auto &inst = caller.insts[id];
+        if (inst.op != Op::Call) continue;
+        const auto &callee = module.funcs[inst.callee];
+        if (callee.is_decl || recursive[inst.callee] || inst.callee == f || !callee.blocks[0].preds.empty()) continue;
+        if (size_of(callee) <= threshold || call_sites[inst.callee] == 1) calls.push_back(id);
+      }
+    }
+    if (calls.empty()) continue;
+    std::vector<int> layout(caller.blocks.size());
+    for (size_t b = 0; b < layout.size(); ++b) layout[b] = b;
+    for (int call : calls) {
+      int callee = caller.insts[call].callee;
+      CallInliner(caller, module.funcs[callee], layout).inline_call(call);
+      call_sites[callee]--;
+    }
+    caller.reorder_blocks(layout);
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,693 @@
+#include "ir.hh"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+namespace ir {
+
+bool is_binary(Op op) {
+  return op >= Op::Add && op <= Op::Ge;
+}
+
+bool is_commutative(Op op) {
+  return op == Op::Add || op == Op::Mul || op == Op::And || op == Op::Or || op == Op::Xor || op == Op::Eq ||
+         op == Op::Ne;
+}
+
+bool is_terminator(Op op) {
+  return op == Op::Br || op == Op::Jump || op == Op::Ret;
+}
+
+bool is_pure(Op op) {
+  return is_binary(op) || op == Op::GetElemPtr || op == Op::GetPtr || op == Op::GlobalAddr || op == Op::Phi;
+}
+
+bool fold_binary(Op op, int lhs, int rhs, int &result) {
+  uint32_t a = lhs, b = rhs;
+  switch (op) {
+    case Op::Add: result = a + b; break;
+    case Op::Sub: result = a - b; break;
+    case Op::Mul: result = a * b; break;
+    case Op::Div:
+      if (rhs == 0 || (lhs == INT32_MIN && rhs == -1)) return false;
+      result = lhs / rhs;
+      break;
+    case Op::Mod:
+      if (rhs == 0 || (lhs == INT32_MIN && rhs == -1)) return false;
+      result = lhs % rhs;
+      break;
+    case Op::And: result = a & b; break;
+    case Op::Or: result = a | b; break;
+    case Op::Xor: result = a ^ b; break;
+    case Op::Shl: result = a << (b & 31); break;
+    case Op::Shr: result = a >> (b & 31); break;
+    case Op::Sar: result = lhs >> (b & 31); break;
+    case Op::Eq: result = lhs == rhs; break;
+    case Op::Ne: result = lhs != rhs; break;
+    case Op::Lt: result = lhs < rhs; break;
+    case Op::Gt: result = lhs > rhs; break;
+    case Op::Le: result = lhs <= rhs; break;
+    case Op::Ge: result = lhs >= rhs; break;
+    default: return false;
+  }
+  return true;
+}
+
+const char *op_name(Op op) {
+  switch (op) {
+    case Op::Arg: return "arg";
+    case Op::Alloc: return "alloc";
+    case Op::Load: return "load";
+    case Op::Store: return "store";
+    case Op::GetElemPtr: return "getelemptr";
+    case Op::GetPtr: return "getptr";
+    case Op::GlobalAddr: return "globaladdr";
+    case Op::Add: return "add";
+    case Op::Sub: return "sub";
+    case Op::Mul: return "mul";
+    case Op::Div: return "div";
+    case Op::Mod: return "mod";
+    case Op::And: return "and";
+    case Op::Or: return "or";
+    case Op::Xor: return "xor";
+    case Op::Shl: return "shl";
+    case Op::Shr: return "shr";
+    case Op::Sar: return "sar";
+    case Op::Eq: return "eq";
+    case Op::Ne: return "ne";
+    case Op::Lt: return "lt";
+    case Op::Gt: return "gt";
+    case Op::Le: return "le";
+    case Op::Ge: return "ge";
+    case Op::Phi: return "phi";
+    case Op::Call: return "call";
+    case Op::Br: return "br";
+    case Op::Jump: return "jump";
+    case Op::Ret: return "ret";
+  }
+  return "?";
+}
+
+int Function::add_block(const std::string &name) {
+  blocks.emplace_back();
+  blocks.back().name = name;
+  return blocks.size() - 1;
+}
+
+int Function::new_inst(const Inst &inst) {
+  int id = insts.size();
+  insts.push_back(inst);
+  uses.emplace_back();
+  for (auto &op : inst.ops) {
+    if (op.is_value()) uses[op.id].push_back(id);
+  }
+  return id;
+}
+
+int Function::insert(int b, int pos, const Inst &inst) {
+  int id = new_inst(inst);
+  insts[id].block = b;
+  auto &list = blocks[b].insts;
+  if (pos < 0) {
+    list.push_back(id);
+  } else {
+    list.insert(list.begin() + pos, id);
+  }
+  return id;
+}
+
+int Function::insert_before_terminator(int b, const Inst &inst) {
+  int pos = terminator(b) >= 0 ? static_cast<int>(blocks[b].insts.size()) - 1 : -1;
+  return insert(b, pos, inst);
+}
+
+int Function::terminator(int b) const {
+  const auto &list = blocks[b].insts;
+  if (list.empty() || !is_terminator(insts[list.back()].op)) return -1;
+  return list.back();
+}
+
+void Function::compute_cfg() {
+  for (auto &block : blocks) {
+    block.preds.clear();
+    block.succs.clear();
+  }
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (blocks[b].dead) continue;
+    int term = terminator(b);
+    if (term < 0) continue;
+    for (int t : insts[term].targets) {
+      auto &succs = blocks[b].succs;
+      if (std::find(succs.begin(), succs.end(), t) == succs.end()) {
+        succs.push_back(t);
+        blocks[t].preds.push_back(b);
+      }
+    }
+  }
+}
+
+void Function::compute_uses() {
+  uses.assign(insts.size(), {});
+  for (auto &block : blocks) {
+    if (block.dead) continue;
+    for (int id : block.insts) {
+      for (auto &op : insts[id].ops) {
+        if (op.is_value()) uses[op.id].push_back(id);
+      }
+    }
+  }
+}
+
+static void erase_one(std::vector<int> &list, int x) {
+  auto it = std::find(list.begin(), list.end(), x);
+  if (it != list.end()) list.erase(it);
+}
+
+void Function::set_operand(int user, int index, Operand op) {
+  Operand &old = insts[user].ops[index];
+  if (old.is_value()) erase_one(uses[old.id], user);
+  old = op;
+  if (op.is_value()) uses[op.id].push_back(user);
+}
+
+void Function::replace_all_uses(int v, Operand with) {
+  if (with == Operand::value(v)) return;
+  std::vector<int> users;
+  users.swap(uses[v]);
+  for (int user : users) {
+    for (auto &op : insts[user].ops) {
+      if (op == Operand::value(v)) {
+        op = with;
+        if (with.is_value()) uses[with.id].push_back(user);
+      }
+    }
+  }
+}
+
+void Function::remove_inst(int v) {
+  Inst &inst = insts[v];
+  if (inst.dead) return;
+  inst.dead = true;
+  for (auto &op : inst.ops) {
+    if (op.is_value()) erase_one(uses[op.id], v);
+  }
+  if (inst.block >= 0) erase_one(blocks[inst.block].insts, v);
+}
+
+void Function::remove_block(int b) {
+  Block &block = blocks[b];
+  if (block.dead) return;
+  // 后继中的 phi 不再有来自 b 的值
+  for (int s : block.succs) {
+    for (int id : blocks[s].insts) {
+      if (insts[id].op != Op::Phi) break;
+      remove_incoming(id, b);
+    }
+    erase_one(blocks[s].preds, b);
+  }
+  for (int p : block.preds) erase_one(blocks[p].succs, b);
+  for (int id : std::vector<int>(block.insts)) remove_inst(id);
+  block.dead = true;
+  block.preds.clear();
+  block.succs.clear();
+}
+
+void Function::add_incoming(int phi, Operand op, int pred) {
+  insts[phi].ops.push_back(op);
+  insts[phi].targets.push_back(pred);
+  if (op.is_value()) uses[op.id].push_back(phi);
+}
+
+void Function::remove_incoming(int phi, int pred) {
+  Inst &inst = insts[phi];
+  for (size_t i = 0; i < inst.targets.size(); ++i) {
+    if (inst.targets[i] != pred) continue;
+    set_operand(phi, i, Operand());
+    inst.ops.erase(inst.ops.begin() + i);
+    inst.targets.erase(inst.targets.begin() + i);
+    return;
+  }
+}
+
+bool Function::remove_unreachable() {
+  std::vector<char> reachable(blocks.size(), 0);
+  for (int b : reverse_post_order()) reachable[b] = 1;
+  bool changed = false;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (!reachable[b] && !blocks[b].dead) {
+      remove_block(b);
+      changed = true;
+    }
+  }
+  if (changed) compact();
+  return changed;
+}
+
+void Function::move_before_terminator(int v, int b) {
+  auto &from = blocks[insts[v].block].insts;
+  from.erase(std::find(from.begin(), from.end(), v));
+  auto &to = blocks[b].insts;
+  to.insert(to.end() - (terminator(b) >= 0 ? 1 : 0), v);
+  insts[v].block = b;
+}
+
+void Function::compact() {
+  std::vector<int> order;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    if (!blocks[b].dead) order.push_back(b);
+  }
+  reorder_blocks(order);
+}
+
+void Function::reorder_blocks(const std::vector<int> &order) {
+  assert(!order.empty() && order[0] == 0);
+  std::vector<int> index(blocks.size(), -1);
+  std::vector<Block> sorted;
+  for (int b : order) {
+    index[b] = sorted.size();
+    sorted.push_back(std::move(blocks[b]));
+  }
+  blocks = std::move(sorted);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    for (int id : blocks[b].insts) {
+      insts[id].block = b;
+      for (auto &t : insts[id].targets) {
+        assert(index[t] >= 0);
+        t = index[t];
+      }
+    }
+  }
+  compute_cfg();
+}
+
+std::vector<int> Function::reverse_post_order() const {
+  std::vector<int> order;
+  if (blocks.empty()) return order;
+  std::vector<char> visited(blocks.size(), 0);
+  // 显式栈: (块, 下一个要访问的后继)
+  std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+  visited[0] = 1;
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    const auto &succs = blocks[top.first].succs;
+    if (top.second < succs.size()) {
+      int s = succs[top.second++];
+      if (!visited[s]) {
+        visited[s] = 1;
+        stack.push_back({s, 0});
+      }
+    } else {
+      order.push_back(top.first);
+      stack.pop_back();
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+int Module::find_function(const std::string &name) const {
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    if (funcs[i].name == name) return i;
+  }
+  return -1;
+}
+
+namespace {
+
+int type_size(koopa_raw_type_t ty) {
+  switch (ty->tag) {
+    case KOOPA_RTT_INT32: return 4;
+    case KOOPA_RTT_POINTER: return 4;
+    case KOOPA_RTT_ARRAY: return type_size(ty->data.array.base) * ty->data.array.len;
+    default: return 0;
+  }
+}
+
+Type type_of(koopa_raw_type_t ty) {
+  switch (ty->tag) {
+    case KOOPA_RTT_INT32: return Type::I32;
+    case KOOPA_RTT_POINTER: return Type::Ptr;
+    default: return Type::Unit;
+  }
+}
+
+void flatten(koopa_raw_value_t init, std::vector<int> &words) {
+  switch (init->kind.tag) {
+    case KOOPA_RVT_INTEGER: words.push_back(init->kind.data.integer.value); break;
+    case KOOPA_RVT_ZERO_INIT: words.resize(words.size() + type_size(init->ty) / 4, 0); break;
+    case KOOPA_RVT_AGGREGATE: {
+      auto &elems = init->kind.data.aggregate.elems;
+      for (size_t i = 0; i < elems.len; ++i) flatten(reinterpret_cast<koopa_raw_value_t>(elems.buffer[i]), words);
+      break;
+    }
+    default: assert(false);
+  }
+}
+
+Op binary_op(koopa_raw_binary_op_t op) {
+  switch (op) {
+    case KOOPA_RBO_NOT_EQ: return Op::Ne;
+    case KOOPA_RBO_EQ: return Op::Eq;
+    case KOOPA_RBO_GT: return Op::Gt;
+    case KOOPA_RBO_LT: return Op::Lt;
+    case KOOPA_RBO_GE: return Op::Ge;
+    case KOOPA_RBO_LE: return Op::Le;
+    case KOOPA_RBO_ADD: return Op::Add;
+    case KOOPA_RBO_SUB: return Op::Sub;
+    case KOOPA_RBO_MUL: return Op::Mul;
+    case KOOPA_RBO_DIV: return Op::Div;
+    case KOOPA_RBO_MOD: return Op::Mod;
+    case KOOPA_RBO_AND: return Op::And;
+    case KOOPA_RBO_OR: return Op::Or;
+    case KOOPA_RBO_XOR: return Op::Xor;
+    case KOOPA_RBO_SHL: return Op::Shl;
+    case KOOPA_RBO_SHR: return Op::Shr;
+    case KOOPA_RBO_SAR: return Op::Sar;
+  }
+  assert(false);
+  return Op::Add;
+}
+
+class KoopaConverter {
+  Module &module;
+  const std::unordered_set<koopa_raw_value_t> &readonly_globals;
+  std::unordered_map<koopa_raw_value_t, int> global_index;
+  std::unordered_map<koopa_raw_function_t, int> func_index;
+  std::unordered_map<koopa_raw_value_t, int> value_id;
+  std::unordered_map<koopa_raw_basic_block_t, int> block_index;
+
+  Operand operand(koopa_raw_value_t value) {
+    if (value->kind.tag == KOOPA_RVT_INTEGER) return Operand::constant(value->kind.data.integer.value);
+    auto g = global_index.find(value);
+    if (g != global_index.end()) return Operand::global(g->second);
+    auto v = value_id.find(value);
+    assert(v != value_id.end());
+    return Operand::value(v->second);
+  }
+
+  static Op op_of(koopa_raw_value_t value) {
+    switch (value->kind.tag) {
+      case KOOPA_RVT_ALLOC: return Op::Alloc;
+      case KOOPA_RVT_LOAD: return Op::Load;
+      case KOOPA_RVT_STORE: return Op::Store;
+      case KOOPA_RVT_GET_ELEM_PTR: return Op::GetElemPtr;
+      case KOOPA_RVT_GET_PTR: return Op::GetPtr;
+      case KOOPA_RVT_BINARY: return binary_op(value->kind.data.binary.op);
+      case KOOPA_RVT_CALL: return Op::Call;
+      case KOOPA_RVT_BRANCH: return Op::Br;
+      case KOOPA_RVT_JUMP: return Op::Jump;
+      case KOOPA_RVT_RETURN: return Op::Ret;
+      default:
+        std::cerr << "from_koopa: unsupported instruction kind " << value->kind.tag << std::endl;
+        assert(false);
+    }
+    return Op::Add;
+  }
+
+  void fill(Function &func, koopa_raw_value_t value, Inst &inst) {
+    const auto &kind = value->kind;
+    switch (kind.tag) {
+      case KOOPA_RVT_ALLOC:
+        inst.size = type_size(value->ty->data.pointer.base);
+        inst.array = value->ty->data.pointer.base->tag == KOOPA_RTT_ARRAY;
+        if (value->name) inst.name = value->name + 1;
+        break;
+      case KOOPA_RVT_LOAD: inst.ops = {operand(kind.data.load.src)}; break;
+      case KOOPA_RVT_STORE:
+        // store zeroinit, @arr 清零整个数组
+        if (kind.data.store.value->kind.tag == KOOPA_RVT_ZERO_INIT) {
+          inst.ops = {Operand::constant(0), operand(kind.data.store.dest)};
+          inst.size = type_size(kind.data.store.value->ty);
+          break;
+        }
+        inst.ops = {operand(kind.data.store.value), operand(kind.data.store.dest)};
+        break;
+      case KOOPA_RVT_GET_ELEM_PTR:
+        inst.ops = {operand(kind.data.get_elem_ptr.src), operand(kind.data.get_elem_ptr.index)};
+        inst.size = type_size(kind.data.get_elem_ptr.src->ty->data.pointer.base->data.array.base);
+        break;
+      case KOOPA_RVT_GET_PTR:
+        inst.ops = {operand(kind.data.get_ptr.src), operand(kind.data.get_ptr.index)};
+        inst.size = type_size(kind.data.get_ptr.src->ty->data.pointer.base);
+        break;
+      case KOOPA_RVT_BINARY: inst.ops = {operand(kind.data.binary.lhs), operand(kind.data.binary.rhs)}; break;
+      case KOOPA_RVT_CALL:
+        inst.callee = func_index.at(kind.data.call.callee);
+        for (size_t i = 0; i < kind.data.call.args.len; ++i)
+          inst.ops.push_back(operand(reinterpret_cast<koopa_raw_value_t>(kind.data.call.args.buffer[i])));
+        break;
+      case KOOPA_RVT_BRANCH:
+        assert(kind.data.branch.true_args.len == 0 && kind.data.branch.false_args.len == 0);
+        inst.ops = {operand(kind.data.branch.cond)};
+        inst.targets = {block_index.at(kind.data.branch.true_bb), block_index.at(kind.data.branch.false_bb)};
+        break;
+      case KOOPA_RVT_JUMP:
+        assert(kind.data.jump.args.len == 0);
+        inst.targets = {block_index.at(kind.data.jump.target)};
+        break;
+      case KOOPA_RVT_RETURN:
+        if (kind.data.ret.value) inst.ops = {operand(kind.data.ret.value)};
+        break;
+      default: break;
+    }
+  }
+
+  void convert_function(koopa_raw_function_t raw, Function &func) {
+    value_id.clear();
+    block_index.clear();
+    for (size_t i = 0; i < raw->params.len; ++i) {
+      auto param = reinterpret_cast<koopa_raw_value_t>(raw->params.buffer[i]);
+      Inst arg(Op::Arg, type_of(param->ty));
+      arg.size = i;
+      if (param->name) arg.name = param->name + 1;
+      value_id[param] = func.new_inst(arg);
+      func.params.push_back(value_id[param]);
+    }
+    for (size_t i = 0; i < raw->bbs.len; ++i) {
+      auto bb = reinterpret_cast<koopa_raw_basic_block_t>(raw->bbs.buffer[i]);
+      assert(bb->params.len == 0);
+      block_index[bb] = func.add_block(bb->name ? bb->name + 1 : "bb" + std::to_string(i));
+    }
+    // 先为所有指令分配编号, 操作数可能引用布局上靠后的指令
+    for (size_t i = 0; i < raw->bbs.len; ++i) {
+      auto bb = reinterpret_cast<koopa_raw_basic_block_t>(raw->bbs.buffer[i]);
+      for (size_t j = 0; j < bb->insts.len; ++j) {
+        auto value = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[j]);
+        Inst inst(op_of(value), type_of(value->ty));
+        value_id[value] = func.append(i, inst);
+      }
+    }
+    for (size_t i = 0; i < raw->bbs.len; ++i) {
+      auto bb = reinterpret_cast<koopa_raw_basic_block_t>(raw->bbs.buffer[i]);
+      for (size_t j = 0; j < bb->insts.len; ++j) {
+        auto value = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[j]);
+        fill(func, value, func.insts[value_id[value]]);
+      }
+    }
+    func.compute_cfg();
+    func.compute_uses();
+  }
+
+public:
+  KoopaConverter(Module &module, const std::unordered_set<koopa_raw_value_t> &readonly_globals)
+      : module(module), readonly_globals(readonly_globals) {}
+
+  void convert(const koopa_raw_program_t &raw) {
+    for (size_t i = 0; i < raw.values.len; ++i) {
+      auto value = reinterpret_cast<koopa_raw_value_t>(raw.values.buffer[i]);
+      assert(value->kind.tag == KOOPA_RVT_GLOBAL_ALLOC);
+      Global global;
+      global.name = value->name + 1;
+      global.size = type_size(value->ty->data.pointer.base);
+      global.readonly = readonly_globals.count(value) != 0;
+      auto init = value->kind.data.global_alloc.init;
+      if (init->kind.tag != KOOPA_RVT_ZERO_INIT) {
+        flatten(init, global.init);
+        if (std::all_of(global.init.begin(), global.init.end(), [](int w) { return w == 0; })) global.init.clear();
+      }
+      global_index[value] = module.globals.size();
+      module.globals.push_back(global);
+    }
+    for (size_t i = 0; i < raw.funcs.len; ++i) {
+      auto raw_func = reinterpret_cast<koopa_raw_function_t>(raw.funcs.buffer[i]);
+      func_index[raw_func] = i;
+      Function func;
+      func.name = raw_func->name + 1;
+      func.ret = type_of(raw_func->ty->data.function.ret);
+      auto &params = raw_func->ty->data.function.params;
+      for (size_t j = 0; j < params.len; ++j)
+        func.param_types.push_back(type_of(reinterpret_cast<koopa_raw_type_t>(params.buffer[j])));
+      func.is_decl = raw_func->bbs.len == 0;
+      module.funcs.push_back(std::move(func));
+    }
+    for (size_t i = 0; i < raw.funcs.len; ++i) {
+      auto raw_func = reinterpret_cast<koopa_raw_function_t>(raw.funcs.buffer[i]);
+      if (!module.funcs[i].is_decl) convert_function(raw_func, module.funcs[i]);
+    }
+  }
+};
+
+} // namespace
+
+Module from_koopa(const koopa_raw_program_t &raw, const std::unordered_set<koopa_raw_value_t> &readonly_globals) {
+  Module module;
+  KoopaConverter(module, readonly_globals).convert(raw);
+  return module;
+}
+
+bool verify(const Module &module, const Function &func, std::string &err) {
+  std::ostringstream os;
+  auto check_operand = [&](int user, const Operand &op) {
+    if (op.kind == Operand::GLOBAL && (op.id < 0 || op.id >= static_cast<int>(module.globals.size()))) {
+      os << "%" << user << " uses unknown global " << op.id << "\n";
+    }
+    if (!op.is_value()) return;
+    if (op.id < 0 || op.id >= static_cast<int>(func.insts.size())) {
+      os << "%" << user << " uses unknown value " << op.id << "\n";
+      return;
+    }
+    const Inst &def = func.insts[op.id];
+    if (def.dead || (def.op != Op::Arg && func.blocks[def.block].dead)) {
+      os << "%" << user << " uses deleted value %" << op.id << "\n";
+    }
+    if (def.ty == Type::Unit) {
+      os << "%" << user << " uses %" << op.id << " which has no value\n";
+    }
+    const auto &users = func.uses[op.id];
+    if (std::find(users.begin(), users.end(), user) == users.end()) {
+      os << "%" << user << " is missing from the use list of %" << op.id << "\n";
+    }
+  };
+
+  if (func.uses.size() != func.insts.size()) os << "use lists are out of date\n";
+  for (size_t b = 0; b < func.blocks.size() && os.tellp() == 0; ++b) {
+    const Block &block = func.blocks[b];
+    if (block.dead) continue;
+    if (func.terminator(b) < 0) os << "block %" << block.name << " has no terminator\n";
+    bool phi_allowed = true;
+    for (size_t i = 0; i < block.insts.size(); ++i) {
+      int id = block.insts[i];
+      const Inst &inst = func.insts[id];
+      if (inst.dead || inst.block != static_cast<int>(b)) os << "%" << id << " is misplaced in %" << block.name << "\n";
+      if (is_terminator(inst.op) && i + 1 != block.insts.size()) os << "terminator %" << id << " in the middle of %" << block.name << "\n";
+      if (inst.op == Op::Call && inst.tail && (i + 2 != block.insts.size() || func.insts[block.insts[i + 1]].op != Op::Ret)) {
+        os << "tail call %" << id << " is not followed by ret\n";
+      }
+      if (inst.op == Op::Phi) {
+        if (!phi_allowed) os << "phi %" << id << " after non-phi in %" << block.name << "\n";
+        auto preds = block.preds;
+        auto incoming = inst.targets;
+        std::sort(preds.begin(), preds.end());
+        std::sort(incoming.begin(), incoming.end());
+        if (preds != incoming || inst.ops.size() != inst.targets.size()) os << "phi %" << id << " does not match the predecessors of %" << block.name << "\n";
+      } else {
+        phi_allowed = false;
+      }
+      for (auto &op : inst.ops) check_operand(id, op);
+      if (inst.op == Op::Br || inst.op == Op::Jump) {
+        for (int t : inst.targets) {
+          if (t < 0 || t >= static_cast<int>(func.blocks.size()) || func.blocks[t].dead) os << "%" << id << " jumps to a deleted block\n";
+        }
+        std::vector<int> succs;
+        for (int t : inst.targets) {
+          if (std::find(succs.begin(), succs.end(), t) == succs.end()) succs.push_back(t);
+        }
+        if (succs != block.succs) os << "successors of %" << block.name << " are out of date\n";
+      }
+    }
+  }
+  err = os.str();
+  return err.empty();
+}
+
+namespace {
+
+const char *type_name(Type ty) {
+  switch (ty) {
+    case Type::I32: return "i32";
+    case Type::Ptr: return "ptr";
+    default: return "unit";
+  }
+}
+
+std::string operand_str(const Module &module, const Operand &op) {
+  switch (op.kind) {
+    case Operand::VALUE: return "%" + std::to_string(op.id);
+    case Operand::CONST: return std::to_string(op.id);
+    case Operand::GLOBAL: return "@" + module.globals[op.id].name;
+    default: return "undef";
+  }
+}
+
+} // namespace
+
+void print(std::ostream &os, const Module &module, const Function &func) {
+  os << (func.is_decl ? "decl @" : "fun @") << func.name << "(";
+  for (size_t i = 0; i < func.param_types.size(); ++i) {
+    if (i) os << ", ";
+    if (!func.is_decl) os << "%" << func.params[i] << ": ";
+    os << type_name(func.param_types[i]);
+  }
+  os << ")";
+  if (func.ret != Type::Unit) os << ": " << type_name(func.ret);
+  if (func.is_decl) {
+    os << "\n";
+    return;
+  }
+  os << " {\n";
+  for (auto &block : func.blocks) {
+    if (block.dead) continue;
+    os << "%" << block.name << ":";
+    if (!block.preds.empty()) {
+      os << "  // preds:";
+      for (int p : block.preds) os << " %" << func.blocks[p].name;
+    }
+    os << "\n";
+    for (int id : block.insts) {
+      const Inst &inst = func.insts[id];
+      os << "  ";
+      if (inst.ty != Type::Unit) os << "%" << id << " = ";
+      os << op_name(inst.op);
+      if (inst.op == Op::Alloc) {
+        os << " " << inst.size << (inst.array ? " bytes array" : " bytes");
+        if (!inst.name.empty()) os << "  // " << inst.name;
+      } else if (inst.op == Op::Call) {
+        os << " @" << module.funcs[inst.callee].name << "(";
+        for (size_t i = 0; i < inst.ops.size(); ++i) os << (i ? ", " : "") << operand_str(module, inst.ops[i]);
+        os << ")";
+        if (inst.tail) os << "  // tail";
+      } else if (inst.op == Op::Phi) {
+        for (size_t i = 0; i < inst.ops.size(); ++i)
+          os << (i ? ", " : " ") << "[" << operand_str(module, inst.ops[i]) << ", %" << func.blocks[inst.targets[i]].name << "]";
+      } else {
+        for (size_t i = 0; i < inst.ops.size(); ++i) os << (i ? ", " : " ") << operand_str(module, inst.ops[i]);
+        for (size_t i = 0; i < inst.targets.size(); ++i) os << (inst.ops.empty() && i == 0 ? " " : ", ") << "%" << func.blocks[inst.targets[i]].name;
+        if (inst.op == Op::GetElemPtr || inst.op == Op::GetPtr) os << "  // stride " << inst.size;
+        if (inst.op == Op::Store && inst.size > 0) os << "  // fill " << inst.size << " bytes";
+      }
+      os << "\n";
+    }
+  }
+  os << "}\n";
+}
+
+void print(std::ostream &os, const Module &module) {
+  for (auto &global : module.globals) {
+    os << "global @" << global.name << " = alloc " << global.size << (global.readonly ? " bytes readonly, " : " bytes, ");
+    if (global.init.empty()) {
+      os << "zeroinit\n";
+      continue;
+    }
+    os << "{";
+    for (size_t i = 0; i < global.init.size(); ++i) os << (i ? ", " : "") << global.init[i];
+    os << "}\n";
+  }
+  for (auto &func : module.funcs) {
+    os << "\n";
+    print(os, module, func);
+  }
+}
+
+} // namespace ir
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "koopa.h"
+
+/*
+ * 编译器自己的 SSA IR, 位于 Koopa raw program 和 RISC-V 后端之间, 所有优化都在这里完成
+ * - 每个函数的指令存放在 insts 数组中, 指令的下标就是它的值编号
+ * - 基本块只记录指令编号的序列, blocks[0] 为入口块, blocks 的顺序即代码布局顺序
+ * - 操作数是 (种类, 编号) 对: 函数内的值, 整数常量或全局变量
+ * - uses[v] 记录使用值 v 的指令 (一条指令多次使用时重复出现), 由 compute_uses 建立,
+ *   replace_all_uses / set_operand / remove_inst 会同步维护
+ * - remove_inst 立即把指令从所在块中去掉; 删除的基本块只做标记, compact 时才真正去掉,
+ *   修改控制流的 pass 结束前需要 compute_cfg (或 compact) 使 preds / succs 保持最新
+ * - 修改操作数必须通过 set_operand 等接口, 否则 use-list 会失效
+ */
+namespace ir {
+
+enum class Op : uint8_t {
+  Arg,
+  Alloc,
+  Load,
+  Store,
+  GetElemPtr,
+  GetPtr,
+  GlobalAddr, // 全局变量的地址, 由 licm 在循环中显式生成以便外提 la
+  // 二元运算
+  Add, Sub, Mul, Div, Mod, And, Or, Xor, Shl, Shr, Sar,
+  Eq, Ne, Lt, Gt, Le, Ge,
+  Phi,
+  Call,
+  // 终结指令
+  Br,
+  Jump,
+  Ret,
+};
+
+enum class Type : uint8_t { Unit, I32, Ptr };
+
+bool is_binary(Op op);
+// 交换两个操作数结果不变的二元运算
+bool is_commutative(Op op);
+bool is_terminator(Op op);
+// 没有副作用, 结果只依赖操作数的指令
+bool is_pure(Op op);
+const char *op_name(Op op);
+// 计算常量二元运算, 结果按 32 位补码回绕; 除零等无法在编译期确定的情况返回 false
+bool fold_binary(Op op, int lhs, int rhs, int &result);
+
+struct Operand {
+  enum Kind : uint8_t { NONE, VALUE, CONST, GLOBAL } kind = NONE;
+  int id = 0;
+
+  static Operand value(int v) { return {VALUE, v}; }
+  static Operand constant(int c) { return {CONST, c}; }
+  static Operand global(int g) { return {GLOBAL, g}; }
+  bool is_value() const { return kind == VALUE; }
+  bool is_const() const { return kind == CONST; }
+  bool operator==(const Operand &other) const { return kind == other.kind && id == other.id; }
+  bool operator!=(const Operand &other) const { return !(*this == other); }
+};
+
+struct Inst {
+  Op op;
+  Type ty = Type::Unit;
+  bool dead = false;
+  bool array = false;        // alloc: 分配的是否是数组
+  bool tail = false;         // call: 尾调用, 后端直接跳转到被调函数
+  int block = -1;            // 所在基本块, 参数为 -1
+  int size = 0;              // alloc: 字节数; getelemptr / getptr: 下标的步长; arg: 参数序号;
+                             // store: 大于 0 时把 dest 开始的 size 字节都写成 ops[0] (局部数组的 zeroinit)
+  int callee = -1;           // call: 被调函数在 Module::funcs 中的下标
+  std::vector<Operand> ops;
+  std::vector<int> targets;  // br: {真, 假}; jump: {目标}; phi: 与 ops 一一对应的前驱块
+  std::string name;          // alloc / 参数的名字, 只用于打印
+
+  Inst(Op op = Op::Add, Type ty = Type::Unit) : op(op), ty(ty) {}
+};
+
+struct Block {
+  std::string name;
+  bool dead = false;
+  std::vector<int> insts;
+  std::vector<int> preds;
+  std::vector<int> succs;
+};
+
+struct Function {
+  std::string name;
+  Type ret = Type::Unit;
+  std::vector<Type> param_types;
+  bool is_decl = false;
+  std::vector<int> params;
+  std::vector<Inst> insts;
+  std::vector<Block> blocks;
+  std::vector<std::vector<int>> uses;
+  int label_count = 0;
+
+  int add_block(const std::string &name);
+  // pass 新建的块使用 "基础名.序号" 的名字, 不会与前端生成的名字冲突
+  std::string new_label(const std::string &base) { return base + "." + std::to_string(label_count++); }
+  int new_inst(const Inst &inst);
+  // 在块 b 的第 pos 条指令前插入, pos 为 -1 时追加到末尾 (终结指令之后)
+  int insert(int b, int pos, const Inst &inst);
+  int append(int b, const Inst &inst) { return insert(b, -1, inst); }
+  // 在块 b 的终结指令之前插入
+  int insert_before_terminator(int b, const Inst &inst);
+  int terminator(int b) const;
+
+  void compute_cfg();
+  void compute_uses();
+  void set_operand(int user, int index, Operand op);
+  void replace_all_uses(int v, Operand with);
+  void remove_inst(int v);
+  void remove_block(int b);
+  // 为 phi 加入来自前驱 pred 的值 / 去掉来自 pred 的值
+  void add_incoming(int phi, Operand op, int pred);
+  void remove_incoming(int phi, int pred);
+  // 删除从入口不可达的块并 compact, 返回是否有改动
+  bool remove_unreachable();
+  // 把指令 v 移到块 b 的终结指令之前
+  void move_before_terminator(int v, int b);
+  // 删去已标记删除的指令和块, 重新为块编号 (指令编号保持不变)
+  void compact();
+  // 按 order 重新排列块 (即代码布局), order 须以入口块开头并包含所有未删除的块
+  void reorder_blocks(const std::vector<int> &order);
+  // 逆后序, 只包含从入口可达的块
+  std::vector<int> reverse_post_order() const;
+};
+
+struct Global {
+  std::string name;
+  int size = 0;
+  std::vector<int> init; // 按字展开的初值, 为空表示 zeroinit
+  bool readonly = false; // const 声明的, 或整个程序中没有被写入, 放进 .rodata
+};
+
+struct Module {
+  std::vector<Global> globals;
+  std::vector<Function> funcs;
+
+  int find_function(const std::string &name) const;
+};
+
+// 由 Koopa raw program 构造 IR, readonly_globals 是由 const 声明的全局变量
+Module from_koopa(const koopa_raw_program_t &raw, const std::unordered_set<koopa_raw_value_t> &readonly_globals = {});
+
+// 检查 IR 的结构是否完整, 出错时返回 false 并把原因写入 err
+bool verify(const Module &module, const Function &func, std::string &err);
+
+void print(std::ostream &os, const Module &module, const Function &func);
+void print(std::ostream &os, const Module &module);
+
+} // namespace ir
@@ -0,0 +1,222 @@
+#include "lexer.hh"
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// token 的种类和 yylval 定义在 Bison 生成的头文件中
+#include "sysy.tab.hpp"
+
+Lexer lexer;
+
+int yylex() {
+  return lexer.next();
+}
+
+Lexer::~Lexer() {
+  close();
+}
+
+bool Lexer::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      mapped_size = st.st_size;
+      begin = static_cast<const char *>(addr);
+      madvise(addr, mapped_size, MADV_SEQUENTIAL);
+    }
+  }
+  ::close(fd);
+  if (mapped_size == 0) {
+    // 空文件或管道等不能映射的输入, 整个读进缓冲区
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    buffer = ss.str();
+    begin = buffer.data();
+    end = begin + buffer.size();
+  } else {
+    end = begin + mapped_size;
+  }
+  cur = begin;
+  line_ = col_ = 1;
+  return true;
+}
+
+void Lexer::close() {
+  if (mapped_size != 0) munmap(const_cast<char *>(begin), mapped_size);
+  mapped_size = 0;
+  buffer.clear();
+  begin = cur = end = nullptr;
+}
+
+// 前进 n 个不含换行的字符
+void Lexer::advance(size_t n) {
+  cur += n;
+  col_ += n;
+}
+
+// 跳过空白和注释, \n, \r\n 和 \r 都算一个换行
+void Lexer::skip_space() {
+  while (cur < end) {
+    char c = *cur;
+    if (c == ' ' || c == '\t') {
+      advance(1);
+    } else if (c == '\n' || c == '\r') {
+      cur += (c == '\r' && peek(1) == '\n') ? 2 : 1;
+      line_++;
+      col_ = 1;
+    } else if (c == '/' && peek(1) == '/') {
+      const char *p = cur + 2;
+      while (p < end && *p != '\n' && *p != '\r') ++p;
+      advance(p - cur);
+    } else if (c == '/' && peek(1) == '*') {
+      std::string_view rest(cur + 2, end - cur - 2);
+      size_t close = rest.find("*/");
+      if (close == std::string_view::npos) return; // 没有闭合的注释, 由 punct 当作除号报错
+      const char *stop = cur + 2 + close + 2;
+      for (const char *p = cur; p < stop; ++p) {
+        if (*p == '\n' || (*p == '\r' && (p + 1 == stop || p[1] != '\n'))) {
+          line_++;
+          col_ = 1;
+        } else {
+          col_++;
+        }
+      }
+      cur = stop;
+    } else {
+      return;
+    }
+  }
+}
+
+static bool is_ident_start(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static int hex_value(char c) {
+  if (is_digit(c)) return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+int Lexer::ident() {
+  const char *p = cur + 1;
+  while (p < end && (is_ident_start(*p) || is_digit(*p))) ++p;
+  std::string_view word(cur, p - cur);
+  advance(p - cur);
+  token = word;
+  switch (word.size()) {
+    case 2:
+      if (word == "if") return IF;
+      break;
+    case 3:
+      if (word == "int") return INT;
+      break;
+    case 4:
+      if (word == "void") return VOID;
+      if (word == "else") return ELSE;
+      break;
+    case 5:
+      if (word == "const") return CONST;
+      if (word == "while") return WHILE;
+      if (word == "break") return BREAK;
+      break;
+    case 6:
+      if (word == "return") return RETURN;
+      break;
+    case 8:
+      if (word == "continue") return CONTINUE;
+      break;
+  }
+  yylval.sym_val = Symbol::intern(word);
+  return IDENT;
+}
+
+// 十进制 [1-9][0-9]*, 八进制 0[0-7]*, 十六进制 0[xX][0-9a-fA-F]+, 超出 int 的部分按 32 位截断
+int Lexer::number() {
+  const char *p = cur;
+  uint64_t value = 0;
+  if (*p != '0') {
+    while (p < end && is_digit(*p)) value = value * 10 + (*p++ - '0');
+  } else if (p + 2 < end && (p[1] == 'x' || p[1] == 'X') && hex_value(p[2]) >= 0) {
+    p += 2;
+    while (p < end && hex_value(*p) >= 0) value = value * 16 + hex_value(*p++);
+  } else {
+    ++p;
+    while (p < end && *p >= '0' && *p <= '7') value = value * 8 + (*p++ - '0');
+  }
+  token = std::string_view(cur, p - cur);
+  advance(p - cur);
+  yylval.int_val = static_cast<int>(static_cast<uint32_t>(value));
+  return INT_CONST;
+}
+
+int Lexer::punct() {
+  char c = *cur, d = peek(1);
+  int kind = static_cast<unsigned char>(c);
+  size_t len = 1;
+  // 运算符的 token 值是 ExpOp, 其余单个字符 (括号, 分号, 逗号, 赋值号等) 的 token 种类就是字符本身
+  auto op = [&](int k, ExpOp value, size_t n = 1) {
+    kind = k;
+    yylval.op_val = value;
+    len = n;
+  };
+  switch (c) {
+    case '+': op(ADDOP, ExpOp::ADD); break;
+    case '-': op(ADDOP, ExpOp::SUB); break;
+    case '*': op(MULOP, ExpOp::MUL); break;
+    case '/': op(MULOP, ExpOp::DIV); break;
+    case '%': op(MULOP, ExpOp::MOD); break;
+    case '<':
+      if (d == '=') op(RELOP, ExpOp::LE, 2);
+      else op(RELOP, ExpOp::LT);
+      break;
+    case '>':
+      if (d == '=') op(RELOP, ExpOp::GE, 2);
+      else op(RELOP, ExpOp::GT);
+      break;
+    case '=':
+      if (d == '=') op(EQOP, ExpOp::EQ, 2);
+      break;
+    case '!':
+      if (d == '=') op(EQOP, ExpOp::NE, 2);
+      else op(UNARYOP, ExpOp::NOT);
+      break;
+    case '&':
+      if (d == '&') op(LANDOP, ExpOp::LAND, 2);
+      break;
+    case '|':
+      if (d == '|') op(LOROP, ExpOp::LOR, 2);
+      break;
+  }
+  token = std::string_view(cur, len);
+  advance(len);
+  return kind;
+}
+
+int Lexer::next() {
+  skip_space();
+  token_line = line_;
+  token_col = col_;
+  if (cur >= end) {
+    token = std::string_view();
+    return 0;
+  }
+  if (is_ident_start(*cur)) return ident();
+  if (is_digit(*cur)) return number();
+  return punct();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+ * 手写的 SysY 词法分析器
+ * - 把整个源文件 mmap 到内存 (不能映射时读进缓冲区), token 的文本是指向源文件的 string_view
+ * - 标识符直接驻留成 Symbol, 运算符的值是 ExpOp, 不为 token 分配内存
+ * - 一遍扫描同时维护行号和列号, 记录的是当前 token 开头的位置
+ */
+class Lexer {
+  const char *begin = nullptr;
+  const char *cur = nullptr;
+  const char *end = nullptr;
+  size_t mapped_size = 0; // 非 0 时 begin 指向 mmap 的区域
+  std::string buffer;
+  std::string_view token;
+  int line_ = 1;
+  int col_ = 1;
+  int token_line = 1;
+  int token_col = 1;
+
+  char peek(size_t k = 0) const { return cur + k < end ? cur[k] : '\0'; }
+  void advance(size_t n);
+  void skip_space();
+  int ident();
+  int number();
+  int punct();
+
+public:
+  Lexer() = default;
+  Lexer(const Lexer &) = delete;
+  Lexer &operator=(const Lexer &) = delete;
+  ~Lexer();
+
+  // 打开源文件, 失败时返回 false
+  bool open(const std::string &path);
+  void close();
+
+  // 读下一个 token, 值写入 yylval, 返回 sysy.tab.hpp 中的 token 种类, 文件结束时返回 0
+  int next();
+
+  std::string_view text() const { return token; }
+  int line() const { return token_line; }
+  int col() const { return token_col; }
+};
+
+extern Lexer lexer;
+
+int yylex();
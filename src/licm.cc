@@ -0,0 +1,168 @@
+#include "passes.hh"
+#include <algorithm>
+#include <unordered_map>
+#include "loops.hh"
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+class LoopHoister {
+  ir::Function &func;
+  DominatorTree dom;
+  LoopInfo info;
+  std::unordered_map<int, int> preheader_of; // header -> 本 pass 新建的 preheader
+  bool changed = false;
+
+  bool invariant(int loop, const Operand &op) const {
+    return !op.is_value() || func.insts[op.id].block < 0 || !info.contains(loop, func.insts[op.id].block);
+  }
+
+  // 指针所指的全局变量, 局部数组为 -2, 无法确定 (参数指针) 为 -1
+  int global_of(const Operand &ptr) const {
+    if (ptr.kind == Operand::GLOBAL) return ptr.id;
+    if (!ptr.is_value()) return -1;
+    const auto &inst = func.insts[ptr.id];
+    switch (inst.op) {
+      case Op::Alloc: return -2;
+      case Op::GlobalAddr: return inst.ops[0].id;
+      case Op::GetElemPtr:
+      case Op::GetPtr: return global_of(inst.ops[0]);
+      default: return -1;
+    }
+  }
+
+  // 循环中访存指令的全局变量地址改用 globaladdr, 使 la 可以被外提
+  void materialize_globals() {
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+      if (info.innermost[b] < 0) continue;
+      for (size_t i = 0; i < func.blocks[b].insts.size(); ++i) {
+        int id = func.blocks[b].insts[i];
+        Op op = func.insts[id].op;
+        int index = op == Op::Store ? 1 : 0;
+        if (op != Op::Load && op != Op::Store && op != Op::GetElemPtr && op != Op::GetPtr) continue;
+        Operand ptr = func.insts[id].ops[index];
+        if (ptr.kind != Operand::GLOBAL) continue;
+        ir::Inst addr(Op::GlobalAddr, ir::Type::Ptr);
+        addr.ops = {ptr};
+        int v = func.insert(b, i++, addr);
+        func.set_operand(id, index, Operand::value(v));
+        changed = true;
+      }
+    }
+  }
+
+  // 保证循环有 preheader: 唯一的循环外前驱且只跳到 header
+  int preheader(int loop) {
+    int h = info.loops[loop].header;
+    std::vector<int> outside;
+    for (int p : func.blocks[h].preds) {
+      if (!info.contains(loop, p)) outside.push_back(p);
+    }
+    if (outside.size() == 1 && func.insts[func.terminator(outside[0])].op == Op::Jump) return outside[0];
+
+    int ph = func.add_block(func.new_label("preheader"));
+    ir::Inst jump(Op::Jump);
+    jump.targets = {h};
+    func.append(ph, jump);
+    for (int p : outside) {
+      for (auto &t : func.insts[func.terminator(p)].targets) {
+        if (t == h) t = ph;
+      }
+    }
+    // header 中来自循环外的 phi 来源移到 preheader
+    for (int phi : std::vector<int>(func.blocks[h].insts)) {
+      if (func.insts[phi].op != Op::Phi) break;
+      int merged = func.insert(ph, 0, ir::Inst(Op::Phi, func.insts[phi].ty));
+      for (int p : outside) {
+        const auto &inst = func.insts[phi];
+        for (size_t i = 0; i < inst.targets.size(); ++i) {
+          if (inst.targets[i] == p) func.add_incoming(merged, inst.ops[i], p);
+        }
+        func.remove_incoming(phi, p);
+      }
+      func.add_incoming(phi, Operand::value(merged), ph);
+    }
+    func.compute_cfg();
+    info.add_block(ph, info.loops[loop].parent);
+    preheader_of[h] = ph;
+    changed = true;
+    return ph;
+  }
+
+  void hoist(int loop) {
+    const auto &body = info.loops[loop].blocks;
+    // 循环中的写入: 有调用时不外提 load, 否则记录被写入的全局变量
+    bool has_call = false, unknown_store = false;
+    std::vector<int> stored;
+    for (int b : body) {
+      for (int id : func.blocks[b].insts) {
+        const auto &inst = func.insts[id];
+        if (inst.op == Op::Call) has_call = true;
+        if (inst.op != Op::Store) continue;
+        int g = global_of(inst.ops[1]);
+        if (g == -1) unknown_store = true;
+        if (g >= 0) stored.push_back(g);
+      }
+    }
+    // 只外提标量全局变量的 load, 数组元素的地址在循环不执行时可能越界
+    auto hoistable_load = [&](const ir::Inst &inst) {
+      if (has_call || unknown_store) return false;
+      const auto &ptr = inst.ops[0];
+      bool scalar = ptr.kind == Operand::GLOBAL || (ptr.is_value() && func.insts[ptr.id].op == Op::GlobalAddr);
+      return scalar && std::find(stored.begin(), stored.end(), global_of(ptr)) == stored.end();
+    };
+
+    int ph = -1;
+    bool progress = true;
+    while (progress) {
+      progress = false;
+      for (size_t k = 0; k < body.size(); ++k) {
+        int b = body[k];
+        for (int id : std::vector<int>(func.blocks[b].insts)) {
+          const auto &inst = func.insts[id];
+          bool pure = ir::is_pure(inst.op) && inst.op != Op::Phi;
+          if (!pure && !(inst.op == Op::Load && hoistable_load(inst))) continue;
+          bool movable = true;
+          for (auto &op : inst.ops) movable = movable && invariant(loop, op);
+          if (!movable) continue;
+          if (ph < 0) ph = preheader(loop);
+          func.move_before_terminator(id, ph);
+          progress = changed = true;
+        }
+      }
+    }
+  }
+
+public:
+  explicit LoopHoister(ir::Function &func) : func(func), dom(func), info(func, dom) {}
+
+  bool run() {
+    if (info.loops.empty()) return false;
+    materialize_globals();
+    for (size_t l = 0; l < info.loops.size(); ++l) {
+      if (info.loops[l].header != 0) hoist(l);
+    }
+    if (!preheader_of.empty()) {
+      // 新建的 preheader 放在 header 之前
+      std::vector<int> order;
+      std::vector<char> created(func.blocks.size(), 0);
+      for (auto &[h, ph] : preheader_of) created[ph] = 1;
+      for (size_t b = 0; b < func.blocks.size(); ++b) {
+        if (created[b]) continue;
+        auto it = preheader_of.find(b);
+        if (it != preheader_of.end()) order.push_back(it->second);
+        order.push_back(b);
+      }
+      func.reorder_blocks(order);
+    }
+    return changed;
+  }
+};
+
+} // namespace
+
+bool LICM::run_on_function(ir::Module &, ir::Function &func) {
+  return LoopHoister(func).run();
+}
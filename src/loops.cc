@@ -0,0 +1,62 @@
+#include "loops.hh"
+#include <algorithm>
+
+LoopInfo::LoopInfo(const ir::Function &func, const DominatorTree &dom) {
+  innermost.assign(func.blocks.size(), -1);
+  for (int h : dom.rpo) {
+    Loop loop;
+    loop.header = h;
+    for (int p : func.blocks[h].preds) {
+      if (dom.dominates(h, p)) loop.latches.push_back(p);
+    }
+    if (loop.latches.empty()) continue;
+    // 从 latch 逆着 CFG 走到 header 为止, 经过的块都在循环中
+    std::vector<char> in_loop(func.blocks.size(), 0);
+    in_loop[h] = 1;
+    loop.blocks.push_back(h);
+    std::vector<int> worklist = loop.latches;
+    while (!worklist.empty()) {
+      int b = worklist.back();
+      worklist.pop_back();
+      if (in_loop[b] || !dom.reachable(b)) continue;
+      in_loop[b] = 1;
+      loop.blocks.push_back(b);
+      for (int p : func.blocks[b].preds) worklist.push_back(p);
+    }
+    loops.push_back(std::move(loop));
+  }
+  std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+    return a.blocks.size() < b.blocks.size();
+  });
+  for (size_t i = 0; i < loops.size(); ++i) {
+    for (int b : loops[i].blocks) {
+      if (innermost[b] < 0) innermost[b] = i;
+    }
+  }
+  // 外层循环是包含 header 的更大的循环中最小的一个
+  for (size_t i = 0; i < loops.size(); ++i) {
+    for (size_t j = i + 1; j < loops.size(); ++j) {
+      const auto &outer = loops[j].blocks;
+      if (std::find(outer.begin(), outer.end(), loops[i].header) != outer.end()) {
+        loops[i].parent = j;
+        break;
+      }
+    }
+  }
+  for (int i = loops.size() - 1; i >= 0; --i) {
+    if (loops[i].parent >= 0) loops[i].depth = loops[loops[i].parent].depth + 1;
+  }
+}
+
+bool LoopInfo::contains(int loop, int block) const {
+  for (int l = innermost[block]; l >= 0; l = loops[l].parent) {
+    if (l == loop) return true;
+  }
+  return false;
+}
+
+void LoopInfo::add_block(int block, int loop) {
+  if (block >= static_cast<int>(innermost.size())) innermost.resize(block + 1, -1);
+  innermost[block] = loop;
+  for (int l = loop; l >= 0; l = loops[l].parent) loops[l].blocks.push_back(block);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include "dominance.hh"
+
+// 自然循环: 回边 latch -> header 中 header 支配 latch, 同一 header 的回边合并为一个循环
+struct Loop {
+  int header;
+  int parent = -1;
+  int depth = 1;
+  std::vector<int> blocks; // 包含 header
+  std::vector<int> latches;
+};
+
+/*
+ * 函数的循环嵌套森林
+ * loops 中内层循环排在外层之前, innermost[b] 为包含块 b 的最内层循环, 不在循环中为 -1
+ */
+class LoopInfo {
+public:
+  std::vector<Loop> loops;
+  std::vector<int> innermost;
+
+  LoopInfo(const ir::Function &func, const DominatorTree &dom);
+  bool contains(int loop, int block) const;
+  // 新建的块 block 属于循环 loop (-1 表示不在循环中) 及其所有外层循环
+  void add_block(int block, int loop);
+};
@@ -5,22 +5,27 @@
 #include <string>
 #include <fstream>
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
+#include <pthread.h>
+#include <sys/resource.h>
 #include "koopa.h"
 #include "/root/compiler/sysy-make-template/ast/ast.hh"
 
+#include "ir.hh"
+#include "lexer.hh"
+#include "pass.hh"
 #include "riscv.hh"
+#include "stack_budget.hh"
 using namespace std;
 
-// 声明 lexer 的输入, 以及 parser 函数
-// 为什么不引用 sysy.tab.hpp 呢? 因为首先里面没有 yyin 的定义
-// 其次, 因为这个文件不是我们自己写的, 而是被 Bison 生成出来的
+// 声明 parser 函数
+// 为什么不引用 sysy.tab.hpp 呢? 因为这个文件不是我们自己写的, 而是被 Bison 生成出来的
 // 你的代码编辑器/IDE 很可能找不到这个文件, 然后会给你报错 (虽然编译不会出错)
 // 看起来会很烦人, 于是干脆采用这种看起来 dirty 但实际很有效的手段
-extern FILE *yyin;
-extern int yyparse(unique_ptr<BaseAST> &ast);
+extern int yyparse(BaseAST *&ast);
 
-int genDot(unique_ptr<BaseAST> &ast) {
+int genDot(BaseAST *ast) {
   // .dot
   string dot = "digraph G {\n";
   dot += "node [shape = record,height=.1]\n";
@@ -54,42 +59,91 @@ int genDot(unique_ptr<BaseAST> &ast) {
     return 0;
 }
 
-int main(int argc, char *argv[]) {
+static void usage(const char *prog) {
+    cerr << "Usage: " << prog << " [-dot] [-O0|-O1|-O2] [-time-passes] [-inline-threshold=N] mode input_file -o output_file" << endl;
+}
+
+static int compile(int argc, char *argv[]) {
     if (argc < 4) {
-        cerr << "Usage: " << argv[0] << " [-dot] mode input_file -o output_file" << endl;
+        usage(argv[0]);
         return -1;
     }
 
     bool generateDot = false;
+    bool timePasses = false;
+    int optLevel = -1; // 未指定时 -riscv 为 -O1, -perf 为 -O2
+    bool inlineThresholdSet = false;
+    PipelineOptions options;
     string mode, input, output;
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
         if (arg == "-dot") {
             generateDot = true;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            optLevel = arg[2] - '0';
+        } else if (arg == "-time-passes") {
+            timePasses = true;
+        } else if (arg.rfind("-inline-threshold=", 0) == 0) {
+            const char *value = arg.c_str() + strlen("-inline-threshold=");
+            char *end = nullptr;
+            long threshold = strtol(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || threshold < 0) {
+                cerr << "Invalid value for -inline-threshold: " << value << endl;
+                return -1;
+            }
+            options.inline_threshold = threshold;
+            inlineThresholdSet = true;
         } else if (arg == "-o") {
-            if (i + 1 < argc) {
-                output = argv[++i];
+            if (i + 1 >= argc) {
+                cerr << "Missing output file after -o" << endl;
+                return -1;
+            }
+            output = argv[++i];
+        } else if (arg == "-koopa" || arg == "-riscv" || arg == "-perf") {
+            if (!mode.empty()) {
+                cerr << "Mode specified twice: " << mode << " and " << arg << endl;
+                return -1;
             }
-        } else if (mode.empty()) {
             mode = arg;
+        } else if (!arg.empty() && arg[0] == '-') {
+            cerr << "Unknown option: " << arg << endl;
+            usage(argv[0]);
+            return -1;
         } else if (input.empty()) {
             input = arg;
+        } else {
+            cerr << "Unexpected argument: " << arg << endl;
+            usage(argv[0]);
+            return -1;
         }
     }
 
-    if (input.empty() || output.empty()) {
+    if (mode.empty() || input.empty() || output.empty()) {
         cerr << "Invalid command line. Make sure to include mode, input file, and output file." << endl;
         return -1;
     }
 
-    yyin = fopen(input.c_str(), "r");
-    if (!yyin) {
+    // -perf 是性能测试用的优化驱动: 默认 -O2, 更大的内联阈值, pass 之间不再检查 IR
+    bool perf = mode == "-perf";
+    if (optLevel < 0) {
+        optLevel = perf ? 2 : 1;
+    }
+    if (perf && !inlineThresholdSet) {
+        options.inline_threshold = 80;
+    }
+
+    if (!lexer.open(input)) {
         cerr << "Cannot open input file: " << input << endl;
         return -1;
     }
 
-    unique_ptr<BaseAST> ast;
-    if (yyparse(ast) != 0) {
+    BaseAST *ast = nullptr;
+    int parse_ret = yyparse(ast);
+    if (parse_ret == 2) {
+        cerr << "Input is nested too deeply: more than " << max_parse_depth << " levels for the available stack." << endl;
+        return -1;
+    }
+    if (parse_ret != 0) {
         cerr << "Failed to parse input file." << endl;
         return -1;
     }
@@ -99,21 +153,82 @@ int main(int argc, char *argv[]) {
     }
 
 
-    ast->toIR(ast->ir);
-    string ir = ast->ir;
+    // AST 直接生成内存中的 raw program, 只有 -koopa 模式才需要转成文本
+    ast->toIR();
+    // AST 之后不再使用, 节点都是平凡可析构的, 整个 arena 一次释放
+    BaseAST::arena.clear();
+    koopa_raw_program_t raw = BaseAST::builder.build();
     if (mode == "-koopa") {
-        ofstream irFile(output, ios::out | ios::trunc);
-        if (irFile.is_open()) {
-            irFile << ir;
-            irFile.close();
-        } else {
+        koopa_program_t program;
+        koopa_error_code_t ret = koopa_generate_raw_to_koopa(&raw, &program);
+        if (ret != KOOPA_EC_SUCCESS) {
+            cerr << "Failed to generate Koopa IR." << endl;
+            return -1;
+        }
+        ret = koopa_dump_to_file(program, output.c_str());
+        koopa_delete_program(program);
+        if (ret != KOOPA_EC_SUCCESS) {
             cerr << "Cannot open output file: " << output << endl;
             return -1;
         }
     } else if (mode == "-riscv" || mode == "-perf") {
-        RiscV riscv(output.c_str());
-        riscv.build(ir);
+        // 转成自己的 IR, 经过优化流水线后交给后端
+        ir::Module module = ir::from_koopa(raw, BaseAST::builder.readonlyGlobals());
+        PassManager pm(!perf);
+        options.opt_level = optLevel;
+        build_pipeline(pm, options);
+        pm.run(module);
+        if (timePasses) {
+            pm.report(cerr);
+        }
+        RiscV riscv(output.c_str(), optLevel);
+        riscv.build(module);
     }
 //    ast->symbol_table.print();
     return 0;
-}
\ No newline at end of file
+}
+
+// 深层嵌套的表达式, 语句和很长的 else-if 链会让 AST 和后端的递归遍历很深,
+// 编译在 COMPILE_STACK_SIZE 大小的线程栈上进行, 不依赖 ulimit -s; 栈按需提交, 只预留地址空间
+
+struct CompileArgs {
+    int argc;
+    char **argv;
+    int ret;
+};
+
+// 主线程的栈大小, 即 ulimit -s; 不限制时按编译线程的栈计算
+static size_t mainStackSize() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > COMPILE_STACK_SIZE) {
+        return COMPILE_STACK_SIZE;
+    }
+    return limit.rlim_cur;
+}
+
+static void *compileThread(void *p) {
+    auto *args = static_cast<CompileArgs *>(p);
+    args->ret = compile(args->argc, args->argv);
+    return nullptr;
+}
+
+int main(int argc, char *argv[]) {
+    CompileArgs args{argc, argv, -1};
+    pthread_attr_t attr;
+    pthread_t thread;
+    bool started = false;
+    if (pthread_attr_init(&attr) == 0) {
+        started = pthread_attr_setstacksize(&attr, COMPILE_STACK_SIZE) == 0
+            && pthread_create(&thread, &attr, compileThread, &args) == 0;
+        pthread_attr_destroy(&attr);
+    }
+    if (!started) {
+        // 申请不到大栈时退回到主线程的栈上编译. 这时只有 ulimit -s 大小的栈,
+        // 按同样的每项预算缩小分析栈的上限, 过深的嵌套 (如 5 万个连续的负号或 2 万个分支的 else-if 链)
+        // 报错退出而不是栈溢出; 括号不产生节点, 左结合的运算链 (包括 && 和 ||) 是迭代遍历的, 不受影响
+        max_parse_depth = mainStackSize() / STACK_BYTES_PER_PARSE_DEPTH;
+        return compile(argc, argv);
+    }
+    pthread_join(thread, nullptr);
+    return args.ret;
+}
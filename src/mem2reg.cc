@@ -0,0 +1,187 @@
+#include "passes.hh"
+#include <unordered_map>
+#include "dominance.hh"
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+// alloc 的地址只被 load / store 直接使用 (没有被存储、传参或参与地址计算)
+bool promotable(const ir::Function &func, int alloc) {
+  if (func.insts[alloc].array) return false;
+  for (int user : func.uses[alloc]) {
+    const auto &inst = func.insts[user];
+    if (inst.op == Op::Load) continue;
+    if (inst.op == Op::Store && inst.ops[1] == Operand::value(alloc) && inst.ops[0] != Operand::value(alloc)) continue;
+    return false;
+  }
+  return true;
+}
+
+// 所有来源 (除自身外) 都相同的 phi 可以直接用该来源代替
+bool simplify_trivial_phi(ir::Function &func, int phi) {
+  Operand same;
+  for (auto &op : func.insts[phi].ops) {
+    if (op == Operand::value(phi) || op == same) continue;
+    if (same.kind != Operand::NONE) return false;
+    same = op;
+  }
+  // 只有自身的 phi 只会出现在不可达的环上, 不会被真正读取
+  if (same.kind == Operand::NONE) same = Operand::constant(0);
+  func.replace_all_uses(phi, same);
+  func.remove_inst(phi);
+  return true;
+}
+
+// 删除平凡 phi 和只被 phi 使用的 phi
+void cleanup_phis(ir::Function &func, const std::vector<int> &phis) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int phi : phis) {
+      if (!func.insts[phi].dead && simplify_trivial_phi(func, phi)) changed = true;
+    }
+  }
+  std::vector<char> live(func.insts.size(), 0);
+  std::vector<int> worklist;
+  for (int phi : phis) {
+    if (func.insts[phi].dead) continue;
+    for (int user : func.uses[phi]) {
+      if (func.insts[user].op != Op::Phi) {
+        live[phi] = 1;
+        worklist.push_back(phi);
+        break;
+      }
+    }
+  }
+  while (!worklist.empty()) {
+    int phi = worklist.back();
+    worklist.pop_back();
+    for (auto &op : func.insts[phi].ops) {
+      if (op.is_value() && func.insts[op.id].op == Op::Phi && !live[op.id]) {
+        live[op.id] = 1;
+        worklist.push_back(op.id);
+      }
+    }
+  }
+  // 死 phi 之间可能互相引用, 它们会一起被删除
+  for (int phi : phis) {
+    if (!func.insts[phi].dead && !live[phi]) func.remove_inst(phi);
+  }
+}
+
+} // namespace
+
+bool Mem2Reg::run_on_function(ir::Module &, ir::Function &func) {
+  bool changed = func.remove_unreachable();
+
+  // slot[alloc] 为可提升变量的编号
+  std::vector<int> allocs;
+  std::unordered_map<int, int> slot;
+  for (auto &block : func.blocks) {
+    for (int id : block.insts) {
+      if (func.insts[id].op == Op::Alloc && promotable(func, id)) {
+        slot[id] = allocs.size();
+        allocs.push_back(id);
+      }
+    }
+  }
+  if (allocs.empty()) return changed;
+  auto slot_of = [&](const Operand &op) {
+    if (!op.is_value()) return -1;
+    auto it = slot.find(op.id);
+    return it == slot.end() ? -1 : it->second;
+  };
+
+  // 变量的类型取自它的 load; 没有 load 的变量不需要 phi
+  size_t n = allocs.size();
+  std::vector<ir::Type> types(n, ir::Type::Unit);
+  std::vector<std::vector<int>> def_blocks(n);
+  for (size_t k = 0; k < n; ++k) {
+    for (int user : func.uses[allocs[k]]) {
+      const auto &inst = func.insts[user];
+      if (inst.op == Op::Load) types[k] = inst.ty;
+      else def_blocks[k].push_back(inst.block);
+    }
+  }
+
+  // 在迭代支配边界上放置 phi
+  DominatorTree dom(func);
+  auto df = dom.frontiers(func);
+  std::unordered_map<int, int> phi_slot;
+  std::vector<int> phis;
+  std::vector<int> placed(func.blocks.size(), -1), queued(func.blocks.size(), -1);
+  for (size_t k = 0; k < n; ++k) {
+    if (types[k] == ir::Type::Unit) continue;
+    std::vector<int> worklist;
+    for (int b : def_blocks[k]) {
+      if (queued[b] != static_cast<int>(k)) {
+        queued[b] = k;
+        worklist.push_back(b);
+      }
+    }
+    while (!worklist.empty()) {
+      int b = worklist.back();
+      worklist.pop_back();
+      for (int d : df[b]) {
+        if (placed[d] == static_cast<int>(k)) continue;
+        placed[d] = k;
+        int phi = func.insert(d, 0, ir::Inst(Op::Phi, types[k]));
+        phi_slot[phi] = k;
+        phis.push_back(phi);
+        if (queued[d] != static_cast<int>(k)) {
+          queued[d] = k;
+          worklist.push_back(d);
+        }
+      }
+    }
+  }
+
+  // 沿支配树重命名: stacks[k] 是变量 k 当前的值, 未初始化的变量读到 0
+  std::vector<std::vector<Operand>> stacks(n);
+  auto top = [&](int k) { return stacks[k].empty() ? Operand::constant(0) : stacks[k].back(); };
+  std::vector<std::vector<int>> pushed(func.blocks.size());
+  std::vector<std::pair<int, bool>> walk = {{0, false}};
+  while (!walk.empty()) {
+    auto [b, leaving] = walk.back();
+    walk.pop_back();
+    if (leaving) {
+      for (int k : pushed[b]) stacks[k].pop_back();
+      continue;
+    }
+    walk.push_back({b, true});
+    for (int id : std::vector<int>(func.blocks[b].insts)) {
+      const auto &inst = func.insts[id];
+      if (inst.op == Op::Phi) {
+        auto it = phi_slot.find(id);
+        if (it == phi_slot.end()) continue;
+        stacks[it->second].push_back(Operand::value(id));
+        pushed[b].push_back(it->second);
+      } else if (inst.op == Op::Load) {
+        int k = slot_of(inst.ops[0]);
+        if (k < 0) continue;
+        func.replace_all_uses(id, top(k));
+        func.remove_inst(id);
+      } else if (inst.op == Op::Store) {
+        int k = slot_of(inst.ops[1]);
+        if (k < 0) continue;
+        stacks[k].push_back(inst.ops[0]);
+        pushed[b].push_back(k);
+        func.remove_inst(id);
+      }
+    }
+    for (int s : func.blocks[b].succs) {
+      for (int id : func.blocks[s].insts) {
+        if (func.insts[id].op != Op::Phi) break;
+        auto it = phi_slot.find(id);
+        if (it != phi_slot.end()) func.add_incoming(id, top(it->second), b);
+      }
+    }
+    for (auto it = dom.children[b].rbegin(); it != dom.children[b].rend(); ++it) walk.push_back({*it, false});
+  }
+
+  for (int alloc : allocs) func.remove_inst(alloc);
+  cleanup_phis(func, phis);
+  return true;
+}
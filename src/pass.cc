@@ -0,0 +1,78 @@
+#include "pass.hh"
+#include "passes.hh"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+bool FunctionPass::run(ir::Module &module) {
+  bool changed = false;
+  for (auto &func : module.funcs) {
+    if (!func.is_decl) changed |= run_on_function(module, func);
+  }
+  return changed;
+}
+
+void PassManager::add(std::unique_ptr<Pass> pass) {
+  passes.push_back({std::move(pass)});
+}
+
+void PassManager::verify(const ir::Module &module, const char *after) const {
+  for (auto &func : module.funcs) {
+    if (func.is_decl) continue;
+    std::string err;
+    if (!ir::verify(module, func, err)) {
+      std::cerr << "invalid IR after " << after << " in @" << func.name << ":\n" << err;
+      ir::print(std::cerr, module, func);
+      assert(0);
+    }
+  }
+}
+
+void PassManager::run(ir::Module &module) {
+  if (verify_each) verify(module, "construction");
+  for (auto &entry : passes) {
+    auto start = std::chrono::steady_clock::now();
+    bool changed = entry.pass->run(module);
+    entry.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    entry.changed += changed;
+    if (verify_each) verify(module, entry.pass->name());
+  }
+}
+
+void PassManager::report(std::ostream &os) const {
+  double total = 0;
+  for (auto &entry : passes) total += entry.seconds;
+  char line[128];
+  os << "===== pass timing =====\n";
+  for (auto &entry : passes) {
+    std::snprintf(line, sizeof(line), "%-20s %10.3f ms %6.1f%%%s\n", entry.pass->name(), entry.seconds * 1000,
+                  total > 0 ? entry.seconds / total * 100 : 0.0, entry.changed ? "" : "  (no change)");
+    os << line;
+  }
+  std::snprintf(line, sizeof(line), "%-20s %10.3f ms\n", "total", total * 1000);
+  os << line;
+}
+
+void build_pipeline(PassManager &pm, const PipelineOptions &options) {
+  if (options.opt_level >= 1) {
+    pm.add<Mem2Reg>();
+    pm.add<SCCP>();
+    pm.add<DCE>();
+    pm.add<SimplifyCFG>();
+    // 被调函数先化简, 内联的代价按化简后的大小计算
+    pm.add<Inliner>(options.inline_threshold);
+    pm.add<TailCallElim>();
+    pm.add<ConstGlobals>();
+    pm.add<SCCP>();
+    pm.add<GVN>();
+    pm.add<LICM>();
+    pm.add<StrengthReduce>();
+    pm.add<GVN>();
+    pm.add<DCE>();
+    pm.add<SimplifyCFG>();
+  }
+  // 后端要求通向含 phi 块的边没有分支, 必须放在最后 (之后只调整块的顺序)
+  pm.add<SplitCriticalEdges>();
+  if (options.opt_level >= 1) pm.add<BlockLayout>();
+}
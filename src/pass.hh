@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "ir.hh"
+
+// 作用于整个模块的 pass, run 返回是否修改了 IR
+class Pass {
+public:
+  virtual ~Pass() = default;
+  virtual const char *name() const = 0;
+  virtual bool run(ir::Module &module) = 0;
+};
+
+// 逐个作用于有函数体的函数
+class FunctionPass : public Pass {
+public:
+  bool run(ir::Module &module) override;
+  virtual bool run_on_function(ir::Module &module, ir::Function &func) = 0;
+};
+
+/*
+ * 按加入顺序运行 pass, 统计每个 pass 的耗时
+ * verify_each 为真时每个 pass 之后检查 IR, 出错时打印函数并终止
+ */
+class PassManager {
+  struct Entry {
+    std::unique_ptr<Pass> pass;
+    double seconds = 0;
+    int changed = 0;
+  };
+  std::vector<Entry> passes;
+  bool verify_each;
+
+  void verify(const ir::Module &module, const char *after) const;
+
+public:
+  explicit PassManager(bool verify_each = true) : verify_each(verify_each) {}
+  void add(std::unique_ptr<Pass> pass);
+  template <typename P, typename... Args>
+  void add(Args &&...args) {
+    add(std::unique_ptr<Pass>(new P(std::forward<Args>(args)...)));
+  }
+  bool empty() const { return passes.empty(); }
+  void run(ir::Module &module);
+  void report(std::ostream &os) const;
+};
+
+// 流水线的可调参数
+struct PipelineOptions {
+  int opt_level = 1;
+  int inline_threshold = 40; // 可被内联的函数的最大指令数
+};
+
+// 各优化级别的默认流水线
+void build_pipeline(PassManager &pm, const PipelineOptions &options);
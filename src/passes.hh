@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pass.hh"
+
+// 把只被 load / store 访问的标量 alloc 提升为 SSA 值, 在支配边界插入 phi
+class Mem2Reg : public FunctionPass {
+public:
+  const char *name() const override { return "mem2reg"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 拆分通向含 phi 块的关键边, 后端在前驱末尾 (jump 之前) 完成 phi 的并行赋值
+class SplitCriticalEdges : public FunctionPass {
+public:
+  const char *name() const override { return "split-critical-edges"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 稀疏条件常量传播: 沿可执行的边传播常量, 把条件为常量的分支改为跳转并删除不可达块
+class SCCP : public FunctionPass {
+public:
+  const char *name() const override { return "sccp"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 删除结果未被使用的无副作用指令, 以及只写不读的局部变量
+class DCE : public FunctionPass {
+public:
+  const char *name() const override { return "dce"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 删除不可达块, 合并直线跳转链, 跳过只含 jump 的空块
+class SimplifyCFG : public FunctionPass {
+public:
+  const char *name() const override { return "simplify-cfg"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 全局值编号: 沿支配树消除重复的纯计算 (含地址计算), 以及中间没有写入的重复 load
+class GVN : public FunctionPass {
+public:
+  const char *name() const override { return "gvn"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 循环不变量外提: 把操作数都在循环外定义的纯指令和未被写入的标量全局变量的 load 移到 preheader
+class LICM : public FunctionPass {
+public:
+  const char *name() const override { return "licm"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 强度削弱: 循环中以归纳变量为下标的地址计算改为指针递增, 乘以 2 的幂改为左移
+class StrengthReduce : public FunctionPass {
+public:
+  const char *name() const override { return "strength-reduce"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
+
+// 函数内联: 自底向上把非递归的小函数 (指令数不超过 threshold) 和只有一处调用的函数展开到调用处
+class Inliner : public Pass {
+  int threshold;
+
+public:
+  explicit Inliner(int threshold) : threshold(threshold) {}
+  const char *name() const override { return "inline"; }
+  bool run(ir::Module &module) override;
+};
+
+// 只读全局变量: const 声明的全局变量在 from_koopa 时已是只读的, 地址只被读取 (包括传给不写入该参数的函数)
+// 的非 const 全局变量也标记为只读; 只读全局变量常量下标的 load 折叠为初值
+class ConstGlobals : public Pass {
+public:
+  const char *name() const override { return "const-globals"; }
+  bool run(ir::Module &module) override;
+};
+
+// 尾调用: 自递归的尾调用改为跳回函数开头的循环, 其余尾调用标记给后端改为跳转
+class TailCallElim : public Pass {
+public:
+  const char *name() const override { return "tail-call"; }
+  bool run(ir::Module &module) override;
+};
+
+// 基本块排布: 沿 jump 和同层循环内的分支串起落入链, 把循环头旋转到循环体之后, 使每次迭代只有一次回跳
+class BlockLayout : public FunctionPass {
+public:
+  const char *name() const override { return "block-layout"; }
+  bool run_on_function(ir::Module &module, ir::Function &func) override;
+};
@@ -0,0 +1,328 @@
+#include "asm.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include "regalloc.hh"
+
+namespace {
+
+const int WINDOW = 4;        // 向后寻找使用者时最多跨过的指令数
+const int BRANCH_RANGE = 500; // 条件分支 ±4KiB, 每行最多展开为两条指令, 留出余量
+
+bool deleted(const AsmInst &inst) { return inst.op.empty() && inst.label.empty(); }
+void erase(AsmInst &inst) { inst = AsmInst(); }
+
+bool is_reg(const std::string &s) {
+  static const std::unordered_set<std::string> regs = [] {
+    std::unordered_set<std::string> names;
+    for (int r = 0; r < REG_NUM; ++r) names.insert(reg_name(r));
+    return names;
+  }();
+  return regs.count(s) > 0;
+}
+
+// 后端的临时寄存器只在一条 IR 指令内有效, 跨过跳转和调用后一定是死的
+// (一条 IR 指令也可能展开成带标签的循环, 如数组清零, 所以标签处不做这个假设)
+bool is_scratch(const std::string &r) { return r == "t0" || r == "t1" || r == "t2" || r == "t3"; }
+
+bool is_store(const AsmInst &inst) { return inst.op == "sw" || inst.op == "sh" || inst.op == "sb"; }
+bool is_branch(const AsmInst &inst) { return !inst.op.empty() && inst.op[0] == 'b'; }
+
+// 之后的指令不能跨过它做分析: 标签, 跳转, 分支, 调用, 返回
+bool is_barrier(const AsmInst &inst) {
+  return inst.is_label() || is_branch(inst) || inst.op == "j" || inst.op == "call" || inst.op == "tail" ||
+         inst.op == "ret";
+}
+
+bool imm12(long long v) { return v >= -2048 && v < 2048; }
+
+bool parse_imm(const std::string &s, long long &v) {
+  char *end = nullptr;
+  v = std::strtoll(s.c_str(), &end, 10);
+  return !s.empty() && *end == '\0';
+}
+
+// 访存操作数 off(base) 的基址寄存器, 不是访存操作数时返回空串
+std::string base_of(const std::string &arg) {
+  auto l = arg.find('('), r = arg.find(')');
+  if (l == std::string::npos || r == std::string::npos) return "";
+  return arg.substr(l + 1, r - l - 1);
+}
+
+// 写回寄存器的操作数下标: store, 分支和跳转类指令没有 (call 等的隐式定义由 is_barrier 处理)
+int def_index(const AsmInst &inst) {
+  if (inst.is_label() || is_store(inst) || is_barrier(inst)) return -1;
+  return !inst.args.empty() && is_reg(inst.args[0]) ? 0 : -1;
+}
+
+bool defines(const AsmInst &inst, const std::string &r) {
+  int d = def_index(inst);
+  return d >= 0 && inst.args[d] == r;
+}
+
+bool uses(const AsmInst &inst, const std::string &r) {
+  if (inst.is_label()) return false;
+  size_t first = def_index(inst) >= 0 ? 1 : 0;
+  for (size_t k = first; k < inst.args.size(); ++k) {
+    if (inst.args[k] == r || base_of(inst.args[k]) == r) return true;
+  }
+  return false;
+}
+
+// 把 inst 读取的寄存器 r 换成 s, with_base 为假时不替换访存操作数中的基址
+bool replace_use(AsmInst &inst, const std::string &r, const std::string &s, bool with_base) {
+  size_t first = def_index(inst) >= 0 ? 1 : 0;
+  for (size_t k = first; k < inst.args.size(); ++k) {
+    if (base_of(inst.args[k]) == r && !with_base) return false;
+  }
+  for (size_t k = first; k < inst.args.size(); ++k) {
+    auto &arg = inst.args[k];
+    if (arg == r) {
+      arg = s;
+    } else if (base_of(arg) == r) {
+      arg = arg.substr(0, arg.find('(') + 1) + s + ")";
+    }
+  }
+  return true;
+}
+
+size_t next(const std::vector<AsmInst> &code, size_t i) {
+  do ++i;
+  while (i < code.size() && deleted(code[i]));
+  return i;
+}
+
+// 第 i 条指令之后 r 的值不再被读取
+bool dead_after(const std::vector<AsmInst> &code, size_t i, const std::string &r) {
+  for (size_t j = next(code, i); j < code.size(); j = next(code, j)) {
+    if (uses(code[j], r)) return false;
+    if (code[j].is_label()) return false;
+    if (is_barrier(code[j])) return is_scratch(r);
+    if (defines(code[j], r)) return true;
+  }
+  return is_scratch(r);
+}
+
+// 第 i 条指令之后窗口内第一条读或写 r 的指令, 遇到标签或控制流 (自身读 r 的分支除外) 时返回 -1
+int find_user(const std::vector<AsmInst> &code, size_t i, const std::string &r) {
+  int count = 0;
+  for (size_t j = next(code, i); j < code.size() && count < WINDOW; j = next(code, j), ++count) {
+    if (code[j].is_label()) return -1;
+    if (uses(code[j], r) || defines(code[j], r)) return j;
+    if (is_barrier(code[j])) return -1;
+  }
+  return -1;
+}
+
+// (i, j) 之间没有写 r 的指令
+bool unchanged_between(const std::vector<AsmInst> &code, size_t i, size_t j, const std::string &r) {
+  for (size_t k = next(code, i); k < j; k = next(code, k)) {
+    if (defines(code[k], r)) return false;
+  }
+  return true;
+}
+
+struct Context {
+  std::vector<AsmInst> &code;
+  std::unordered_map<std::string, int> label_pos; // 标签所在的行, 用于估计分支距离
+  std::unordered_map<std::string, int> label_refs; // 标签被引用的次数
+};
+
+// sw rs, X; ...; lw rd, X  =>  sw rs, X; ...; mv rd, rs (rd == rs 时删去 lw)
+bool store_load(Context &ctx, size_t i) {
+  auto &code = ctx.code;
+  if (code[i].op != "sw") return false;
+  const std::string &rs = code[i].args[0], &addr = code[i].args[1];
+  std::string base = base_of(addr);
+  int count = 0;
+  for (size_t j = next(code, i); j < code.size() && count < WINDOW; j = next(code, j), ++count) {
+    auto &inst = code[j];
+    if (inst.op == "lw" && inst.args[1] == addr) {
+      if (inst.args[0] == rs) erase(inst);
+      else inst = AsmInst{"mv", {inst.args[0], rs}, ""};
+      return true;
+    }
+    if (is_barrier(inst) || is_store(inst) || defines(inst, rs) || defines(inst, base)) return false;
+  }
+  return false;
+}
+
+// li t, 0 之后读取 t 的指令直接使用 zero
+bool zero_register(Context &ctx, size_t i) {
+  auto &code = ctx.code;
+  if (code[i].op != "li" || code[i].args[1] != "0" || code[i].args[0] == "zero") return false;
+  std::string t = code[i].args[0];
+  int j = find_user(code, i, t);
+  if (j < 0 || !uses(code[j], t)) return false;
+  if (!defines(code[j], t) && !dead_after(code, j, t)) return false;
+  if (!replace_use(code[j], t, "zero", false)) return false;
+  erase(code[i]);
+  return true;
+}
+
+// li t, imm; op rd, rs, t  =>  opi rd, rs, imm (imm 在 12 位以内, t 之后不再使用)
+bool fold_immediate(Context &ctx, size_t i) {
+  static const std::unordered_map<std::string, std::string> imm_form = {
+    {"add", "addi"}, {"and", "andi"}, {"or", "ori"}, {"xor", "xori"}, {"slt", "slti"}, {"sub", "addi"},
+  };
+  auto &code = ctx.code;
+  long long imm;
+  if (code[i].op != "li" || !parse_imm(code[i].args[1], imm)) return false;
+  std::string t = code[i].args[0];
+  int j = find_user(code, i, t);
+  if (j < 0) return false;
+  auto &inst = code[j];
+  auto it = imm_form.find(inst.op);
+  if (it == imm_form.end() || inst.args.size() != 3) return false;
+  bool commutative = inst.op != "sub" && inst.op != "slt";
+  std::string other;
+  if (inst.args[2] == t && inst.args[1] != t) other = inst.args[1];
+  else if (commutative && inst.args[1] == t && inst.args[2] != t) other = inst.args[2];
+  else return false;
+  if (inst.op == "sub") imm = -imm;
+  if (!imm12(imm)) return false;
+  if (!defines(inst, t) && !dead_after(code, j, t)) return false;
+  inst = AsmInst{it->second, {inst.args[0], other, std::to_string(imm)}, ""};
+  erase(code[i]);
+  return true;
+}
+
+// 不改变值的运算即复制: add/sub/or/xor rd, rs, zero 和 addi/ori/xori/slli/srli/srai rd, rs, 0 => mv rd, rs
+bool identity(Context &ctx, size_t i) {
+  static const std::unordered_set<std::string> reg_form = {"add", "sub", "or", "xor"};
+  static const std::unordered_set<std::string> imm_form = {"addi", "ori", "xori", "slli", "srli", "srai"};
+  auto &inst = ctx.code[i];
+  if (inst.args.size() != 3) return false;
+  std::string src;
+  if (reg_form.count(inst.op) && inst.args[2] == "zero") src = inst.args[1];
+  else if (reg_form.count(inst.op) && inst.op != "sub" && inst.args[1] == "zero") src = inst.args[2];
+  else if (imm_form.count(inst.op) && inst.args[2] == "0") src = inst.args[1];
+  else return false;
+  inst = AsmInst{"mv", {inst.args[0], src}, ""};
+  return true;
+}
+
+// mv r, s; op ..., r, ...  =>  op ..., s, ... (r 之后不再使用), mv x, x 直接删除
+bool forward_copy(Context &ctx, size_t i) {
+  auto &code = ctx.code;
+  if (code[i].op != "mv") return false;
+  std::string r = code[i].args[0], s = code[i].args[1];
+  if (r == s) {
+    erase(code[i]);
+    return true;
+  }
+  int j = find_user(code, i, r);
+  if (j < 0 || !uses(code[j], r) || !unchanged_between(code, i, j, s)) return false;
+  if (!defines(code[j], r) && !dead_after(code, j, r)) return false;
+  replace_use(code[j], r, s, true);
+  erase(code[i]);
+  return true;
+}
+
+// j L 紧跟着标签 L 时可以落入
+bool jump_to_next(Context &ctx, size_t i) {
+  auto &code = ctx.code;
+  if (code[i].op != "j") return false;
+  for (size_t j = next(code, i); j < code.size() && code[j].is_label(); j = next(code, j)) {
+    if (code[j].label == code[i].args[0]) {
+      --ctx.label_refs[code[i].args[0]];
+      erase(code[i]);
+      return true;
+    }
+  }
+  return false;
+}
+
+// 条件相反的分支
+const std::unordered_map<std::string, std::string> &inverse_branch() {
+  static const std::unordered_map<std::string, std::string> inverse = {
+    {"beqz", "bnez"}, {"bnez", "beqz"}, {"beq", "bne"}, {"bne", "beq"},
+    {"blt", "bge"}, {"bge", "blt"}, {"bgt", "ble"}, {"ble", "bgt"},
+  };
+  return inverse;
+}
+
+/*
+ * 后端为了分支距离把条件分支写成跳板:
+ *   bcc ..., T; j F; T: j X
+ * 目标在条件分支的范围内时改为反向的 bncc ..., F; j X, 若 F 正好紧随其后则只需 bcc ..., X
+ */
+bool branch_trampoline(Context &ctx, size_t i) {
+  auto &code = ctx.code;
+  auto inv = inverse_branch().find(code[i].op);
+  if (inv == inverse_branch().end()) return false;
+  size_t j1 = next(code, i), t = next(code, j1), j2 = next(code, t);
+  if (j2 >= code.size() || code[j1].op != "j" || !code[t].is_label() || code[j2].op != "j") return false;
+  const std::string &tmp = code[t].label;
+  if (code[i].args.back() != tmp || ctx.label_refs[tmp] != 1) return false;
+  std::string f = code[j1].args[0], x = code[j2].args[0];
+  auto in_range = [&](const std::string &target) {
+    auto it = ctx.label_pos.find(target);
+    return it != ctx.label_pos.end() && std::abs(it->second - static_cast<int>(i)) < BRANCH_RANGE;
+  };
+  size_t after = next(code, j2);
+  bool falls_to_f = after < code.size() && code[after].is_label() && code[after].label == f;
+  if (falls_to_f && in_range(x)) {
+    code[i].args.back() = x;
+    --ctx.label_refs[f];
+    erase(code[j1]);
+    erase(code[t]);
+    erase(code[j2]);
+    return true;
+  }
+  if (!in_range(f)) return false;
+  code[i].op = inv->second;
+  code[i].args.back() = f;
+  erase(code[j1]);
+  erase(code[t]);
+  return true;
+}
+
+struct Pattern {
+  const char *name;
+  bool (*apply)(Context &ctx, size_t i);
+};
+
+const Pattern patterns[] = {
+  {"store-load", store_load},
+  {"zero-register", zero_register},
+  {"fold-immediate", fold_immediate},
+  {"identity", identity},
+  {"forward-copy", forward_copy},
+  {"jump-to-next", jump_to_next},
+  {"branch-trampoline", branch_trampoline},
+};
+
+} // namespace
+
+std::ostream &operator<<(std::ostream &os, const AsmInst &inst) {
+  if (inst.is_label()) return os << inst.label << ":\n";
+  os << "  " << inst.op;
+  for (size_t k = 0; k < inst.args.size(); ++k) os << (k == 0 ? " " : ", ") << inst.args[k];
+  return os << "\n";
+}
+
+bool peephole(std::vector<AsmInst> &code) {
+  bool changed = false, progress = true;
+  while (progress) {
+    progress = false;
+    Context ctx{code, {}, {}};
+    for (size_t i = 0; i < code.size(); ++i) {
+      if (code[i].is_label()) {
+        ctx.label_pos[code[i].label] = i;
+      } else {
+        for (auto &arg : code[i].args) ++ctx.label_refs[arg];
+      }
+    }
+    for (size_t i = 0; i < code.size(); ++i) {
+      for (const auto &pattern : patterns) {
+        if (deleted(code[i]) || code[i].is_label()) break;
+        if (pattern.apply(ctx, i)) progress = true;
+      }
+    }
+    code.erase(std::remove_if(code.begin(), code.end(), deleted), code.end());
+    changed |= progress;
+  }
+  return changed;
+}
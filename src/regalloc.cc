@@ -0,0 +1,606 @@
+#include "regalloc.hh"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <unordered_set>
+
+const char *reg_name(int reg) {
+  static const char *names[REG_NUM] = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+    "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+    "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+  };
+  assert(reg >= 0 && reg < REG_NUM);
+  return names[reg];
+}
+
+bool is_callee_saved(int reg) {
+  return reg == S0 || reg == S1 || (reg >= S2 && reg <= S11);
+}
+
+const std::vector<int> &RegAllocator::allocatable() {
+  static const std::vector<int> regs = {
+    T4, T5, T6, A0, A1, A2, A3, A4, A5, A6, A7,
+    S0, S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11,
+  };
+  return regs;
+}
+
+Liveness::Liveness(const AllocFunc &func) {
+  int n = func.num_values;
+  int num_blocks = func.blocks.size();
+  live_in.resize(num_blocks);
+  live_out.resize(num_blocks);
+  std::vector<std::vector<int>> preds(num_blocks);
+  for (int b = 0; b < num_blocks; ++b) {
+    for (int s : func.blocks[b].succs) preds[s].push_back(b);
+  }
+  // 每个值向上暴露的使用 (块内使用前没有定义) 所在的块, 以及定义它的块
+  std::vector<std::vector<int>> use_blocks(n), def_blocks(n);
+  std::vector<int> used_in(n, -1), defined_in(n, -1);
+  for (int b = 0; b < num_blocks; ++b) {
+    for (int i = func.blocks[b].begin; i < func.blocks[b].end; ++i) {
+      for (int v : func.insts[i].uses) {
+        if (defined_in[v] == b || used_in[v] == b) continue;
+        used_in[v] = b;
+        use_blocks[v].push_back(b);
+      }
+      for (int v : func.insts[i].defs) {
+        if (defined_in[v] == b) continue;
+        defined_in[v] = b;
+        def_blocks[v].push_back(b);
+      }
+    }
+  }
+  // 按编号逐个值回溯, 各块的表自然有序; 用值编号作标记, 不必每个值清空
+  std::vector<int> kills(num_blocks, -1), in_mark(num_blocks, -1), out_mark(num_blocks, -1);
+  std::vector<int> work;
+  for (int v = 0; v < n; ++v) {
+    if (use_blocks[v].empty()) continue;
+    for (int b : def_blocks[v]) kills[b] = v;
+    for (int b : use_blocks[v]) {
+      in_mark[b] = v;
+      live_in[b].push_back(v);
+      work.push_back(b);
+    }
+    while (!work.empty()) {
+      int b = work.back();
+      work.pop_back();
+      for (int p : preds[b]) {
+        if (out_mark[p] == v) continue;
+        out_mark[p] = v;
+        live_out[p].push_back(v);
+        if (kills[p] == v || in_mark[p] == v) continue;
+        in_mark[p] = v;
+        live_in[p].push_back(v);
+        work.push_back(p);
+      }
+    }
+  }
+}
+
+std::vector<int> assign_spill_slots(const AllocFunc &func, const std::vector<int> &reg, int &num_slots) {
+  int n = func.num_values;
+  std::vector<int> slot(n, -1);
+  std::vector<uint64_t> spilled((n + 63) / 64, 0);
+  bool any = false;
+  for (auto &inst : func.insts) {
+    for (int d : inst.defs) {
+      if (reg[d] >= 0) continue;
+      Liveness::set(spilled, d);
+      any = true;
+    }
+  }
+  num_slots = 0;
+  if (!any) return slot;
+
+  // 溢出值之间的冲突: 定义点处活跃的其他溢出值
+  Liveness liveness(func);
+  std::vector<std::vector<int>> adj(n);
+  std::vector<uint64_t> live((n + 63) / 64, 0);
+  for (size_t b = 0; b < func.blocks.size(); ++b) {
+    for (int v : liveness.live_out[b]) Liveness::set(live, v);
+    for (int i = func.blocks[b].end - 1; i >= func.blocks[b].begin; --i) {
+      const auto &inst = func.insts[i];
+      for (int d : inst.defs) {
+        if (!Liveness::test(spilled, d)) continue;
+        for (size_t w = 0; w < live.size(); ++w) {
+          uint64_t bits = live[w] & spilled[w];
+          while (bits) {
+            int v = w * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (v == d) continue;
+            adj[d].push_back(v);
+            adj[v].push_back(d);
+          }
+        }
+        // 同一条指令 (并行赋值) 定义的值互相冲突
+        for (int e : inst.defs) {
+          if (e != d && Liveness::test(spilled, e)) adj[d].push_back(e);
+        }
+      }
+      for (int d : inst.defs) Liveness::reset(live, d);
+      for (int u : inst.uses) Liveness::set(live, u);
+    }
+    // 扫描到块首时剩下的正是 live_in
+    for (int v : liveness.live_in[b]) Liveness::reset(live, v);
+  }
+
+  // 贪心: 取邻居没有用到的最小槽号
+  std::vector<char> used;
+  for (int v = 0; v < n; ++v) {
+    if (!Liveness::test(spilled, v)) continue;
+    used.assign(num_slots + 1, 0);
+    for (int u : adj[v]) {
+      if (slot[u] >= 0) used[slot[u]] = 1;
+    }
+    int s = 0;
+    while (used[s]) ++s;
+    slot[v] = s;
+    num_slots = std::max(num_slots, s + 1);
+  }
+  return slot;
+}
+
+AllocResult LinearScanAllocator::allocate(const AllocFunc &func) {
+  Liveness liveness(func);
+  int n = func.num_values;
+  // 指令 i 在位置 2i 读操作数, 在位置 2i + 1 写结果
+  std::vector<int> start(n, INT_MAX), end(n, -1);
+  std::vector<int> calls;
+  for (size_t b = 0; b < func.blocks.size(); ++b) {
+    const auto &block = func.blocks[b];
+    for (int v : liveness.live_in[b]) start[v] = std::min(start[v], 2 * block.begin);
+    for (int v : liveness.live_out[b]) end[v] = std::max(end[v], 2 * block.end - 1);
+    for (int i = block.begin; i < block.end; ++i) {
+      const auto &inst = func.insts[i];
+      for (int v : inst.uses) {
+        start[v] = std::min(start[v], 2 * i);
+        end[v] = std::max(end[v], 2 * i);
+      }
+      for (int v : inst.defs) {
+        start[v] = std::min(start[v], 2 * i + 1);
+        end[v] = std::max(end[v], 2 * i + 1);
+      }
+      if (inst.is_call) calls.push_back(2 * i + 1);
+    }
+  }
+
+  std::vector<Interval> intervals;
+  for (int v = 0; v < n; ++v) {
+    if (end[v] < 0) continue;
+    // 调用在 2i + 1 破坏 caller-saved 寄存器, 区间严格包含该位置才算跨越调用
+    auto it = std::upper_bound(calls.begin(), calls.end(), start[v]);
+    bool cross = it != calls.end() && *it < end[v];
+    intervals.push_back({v, start[v], end[v], cross});
+  }
+  std::sort(intervals.begin(), intervals.end(), [](const Interval &a, const Interval &b) {
+    return a.start != b.start ? a.start < b.start : a.value < b.value;
+  });
+
+  AllocResult result;
+  result.reg.assign(n, -1);
+  std::vector<bool> reg_free(REG_NUM, false);
+  for (int r : allocatable()) reg_free[r] = true;
+  std::vector<bool> callee_used(REG_NUM, false);
+  std::vector<const Interval *> active;
+
+  auto usable = [](const Interval &it, int r) { return !it.cross_call || is_callee_saved(r); };
+  for (const auto &cur : intervals) {
+    // 释放已经结束的区间
+    for (auto it = active.begin(); it != active.end();) {
+      if ((*it)->end < cur.start) {
+        reg_free[result.reg[(*it)->value]] = true;
+        it = active.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    int chosen = -1;
+    int hint = func.hints.empty() ? -1 : func.hints[cur.value];
+    if (hint >= 0 && reg_free[hint] && usable(cur, hint)) {
+      chosen = hint;
+    } else {
+      // 不跨调用的值优先用 caller-saved, 省去 prologue 中的保存
+      for (int r : allocatable()) {
+        if (reg_free[r] && usable(cur, r)) {
+          chosen = r;
+          break;
+        }
+      }
+    }
+    if (chosen < 0) {
+      // 没有空闲寄存器, 溢出结束得最晚的区间
+      const Interval *victim = nullptr;
+      for (auto *a : active) {
+        if (usable(cur, result.reg[a->value]) && (victim == nullptr || a->end > victim->end)) victim = a;
+      }
+      if (victim == nullptr || victim->end <= cur.end) continue;
+      chosen = result.reg[victim->value];
+      result.reg[victim->value] = -1;
+      active.erase(std::find(active.begin(), active.end(), victim));
+    }
+    result.reg[cur.value] = chosen;
+    reg_free[chosen] = false;
+    if (is_callee_saved(chosen)) callee_used[chosen] = true;
+    active.push_back(&cur);
+  }
+  for (int r : allocatable()) {
+    if (callee_used[r]) result.used_callee_saved.push_back(r);
+  }
+  return result;
+}
+
+namespace {
+
+class IRC {
+  enum NodeState { PRECOLORED, INITIAL, SIMPLIFY, FREEZE, SPILL, SELECTED, COALESCED, COLORED, SPILLED };
+  enum MoveState { WORKLIST, ACTIVE, DONE };
+
+  const AllocFunc &func;
+  int n;
+  int K;
+  std::vector<int> caller_saved;
+  std::vector<NodeState> state;
+  std::vector<int> degree;
+  std::vector<int> alias;
+  std::vector<int> color;
+  std::vector<double> cost;
+  std::vector<std::vector<int>> adj_list;
+  std::unordered_set<uint64_t> adj_set;
+  std::vector<std::vector<int>> move_list;
+  std::vector<std::pair<int, int>> moves;
+  std::vector<MoveState> move_state;
+  std::vector<int> simplify_list, freeze_list, spill_list, move_worklist, select_stack;
+
+  bool precolored(int u) const { return u >= n; }
+  uint64_t key(int u, int v) const { return static_cast<uint64_t>(u) << 32 | static_cast<uint32_t>(v); }
+  bool adjacent(int u, int v) const { return adj_set.count(key(u, v)) != 0; }
+
+  void add_edge(int u, int v) {
+    if (u == v || adjacent(u, v)) return;
+    adj_set.insert(key(u, v));
+    adj_set.insert(key(v, u));
+    if (!precolored(u)) {
+      adj_list[u].push_back(v);
+      degree[u]++;
+    }
+    if (!precolored(v)) {
+      adj_list[v].push_back(u);
+      degree[v]++;
+    }
+  }
+
+  template <typename F>
+  void for_adjacent(int u, F f) {
+    for (int v : adj_list[u]) {
+      if (state[v] != SELECTED && state[v] != COALESCED) f(v);
+    }
+  }
+
+  template <typename F>
+  void for_node_moves(int u, F f) {
+    for (int m : move_list[u]) {
+      if (move_state[m] != DONE) f(m);
+    }
+  }
+
+  bool move_related(int u) {
+    for (int m : move_list[u]) {
+      if (move_state[m] != DONE) return true;
+    }
+    return false;
+  }
+
+  // 各个工作表都是惰性删除的, 取出时校验结点的当前状态
+  int pop(std::vector<int> &list, NodeState s) {
+    while (!list.empty()) {
+      int u = list.back();
+      list.pop_back();
+      if (state[u] == s) return u;
+    }
+    return -1;
+  }
+
+  bool has(std::vector<int> &list, NodeState s) {
+    while (!list.empty() && state[list.back()] != s) list.pop_back();
+    return !list.empty();
+  }
+
+  void push(int u, NodeState s) {
+    state[u] = s;
+    switch (s) {
+      case SIMPLIFY: simplify_list.push_back(u); break;
+      case FREEZE: freeze_list.push_back(u); break;
+      case SPILL: spill_list.push_back(u); break;
+      default: break;
+    }
+  }
+
+  int get_alias(int u) {
+    while (state[u] == COALESCED) u = alias[u];
+    return u;
+  }
+
+  void build(const Liveness &liveness) {
+    // 简单的循环深度估计: 块 b 跳回到块 h <= b 时, [h, b] 之间的块都在循环里
+    std::vector<int> depth(func.blocks.size(), 0);
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+      for (int s : func.blocks[b].succs) {
+        if (s <= static_cast<int>(b)) {
+          for (size_t k = s; k <= b; ++k) depth[k]++;
+        }
+      }
+    }
+    std::vector<uint64_t> live((n + 63) / 64, 0);
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+      const auto &block = func.blocks[b];
+      double weight = 1;
+      for (int d = 0; d < depth[b] && d < 6; ++d) weight *= 10;
+      for (int v : liveness.live_out[b]) Liveness::set(live, v);
+      for (int i = block.end - 1; i >= block.begin; --i) {
+        const auto &inst = func.insts[i];
+        for (int d : inst.defs) {
+          Liveness::for_each(live, [&](int l) { add_edge(d, l); });
+          for (int other : inst.defs) add_edge(d, other);
+        }
+        for (int d : inst.defs) {
+          Liveness::reset(live, d);
+          cost[d] += weight;
+        }
+        if (inst.is_call) {
+          Liveness::for_each(live, [&](int l) {
+            for (size_t k = 0; k < caller_saved.size(); ++k) add_edge(l, n + k);
+          });
+        }
+        for (int u : inst.uses) {
+          Liveness::set(live, u);
+          cost[u] += weight;
+        }
+      }
+      for (int v : liveness.live_in[b]) Liveness::reset(live, v);
+    }
+    for (const auto &copy : func.copies) {
+      if (copy.first == copy.second) continue;
+      int m = moves.size();
+      moves.push_back(copy);
+      move_state.push_back(WORKLIST);
+      move_list[copy.first].push_back(m);
+      move_list[copy.second].push_back(m);
+      move_worklist.push_back(m);
+    }
+  }
+
+  void make_worklist() {
+    for (int u = 0; u < n; ++u) {
+      if (degree[u] >= K) push(u, SPILL);
+      else if (move_related(u)) push(u, FREEZE);
+      else push(u, SIMPLIFY);
+    }
+  }
+
+  void enable_moves(int u) {
+    for_node_moves(u, [&](int m) {
+      if (move_state[m] == ACTIVE) {
+        move_state[m] = WORKLIST;
+        move_worklist.push_back(m);
+      }
+    });
+  }
+
+  void decrement_degree(int m) {
+    if (precolored(m)) return;
+    int d = degree[m]--;
+    if (d == K) {
+      enable_moves(m);
+      for_adjacent(m, [&](int v) { enable_moves(v); });
+      if (state[m] == SPILL) push(m, move_related(m) ? FREEZE : SIMPLIFY);
+    }
+  }
+
+  void simplify() {
+    int u = pop(simplify_list, SIMPLIFY);
+    if (u < 0) return;
+    state[u] = SELECTED;
+    select_stack.push_back(u);
+    for (int v : adj_list[u]) {
+      if (state[v] != SELECTED && state[v] != COALESCED) decrement_degree(v);
+    }
+  }
+
+  void add_worklist(int u) {
+    if (!precolored(u) && !move_related(u) && degree[u] < K && state[u] == FREEZE) push(u, SIMPLIFY);
+  }
+
+  bool ok(int t, int r) {
+    return precolored(t) || degree[t] < K || adjacent(t, r);
+  }
+
+  // Briggs: 合并后高度数的邻居少于 K 个
+  bool conservative(int u, int v) {
+    std::unordered_set<int> seen;
+    int k = 0;
+    auto count = [&](int t) {
+      if (seen.insert(t).second && (precolored(t) || degree[t] >= K)) k++;
+    };
+    for_adjacent(u, count);
+    for_adjacent(v, count);
+    return k < K;
+  }
+
+  void combine(int u, int v) {
+    state[v] = COALESCED;
+    alias[v] = u;
+    enable_moves(v);
+    // v 的传送接到 u 的后面; v 的表更长时把 u 的表插到它前面再交给 u, 避免一个结点依次合并上万个结点时反复复制长表
+    auto &moves_u = move_list[u], &moves_v = move_list[v];
+    if (moves_v.size() > moves_u.size()) {
+      moves_v.insert(moves_v.begin(), moves_u.begin(), moves_u.end());
+      moves_u.swap(moves_v);
+    } else {
+      moves_u.insert(moves_u.end(), moves_v.begin(), moves_v.end());
+    }
+    std::vector<int>().swap(moves_v);
+    cost[u] += cost[v];
+    std::vector<int> neighbors;
+    for_adjacent(v, [&](int t) { neighbors.push_back(t); });
+    for (int t : neighbors) {
+      add_edge(t, u);
+      decrement_degree(t);
+    }
+    if (degree[u] >= K && state[u] == FREEZE) push(u, SPILL);
+  }
+
+  void coalesce() {
+    int m = move_worklist.back();
+    move_worklist.pop_back();
+    if (move_state[m] != WORKLIST) return;
+    int x = get_alias(moves[m].first);
+    int y = get_alias(moves[m].second);
+    int u = x, v = y;
+    if (precolored(y)) std::swap(u, v);
+    move_state[m] = DONE;
+    if (u == v) {
+      add_worklist(u);
+    } else if (precolored(v) || adjacent(u, v)) {
+      add_worklist(u);
+      add_worklist(v);
+    } else {
+      bool george = false;
+      if (precolored(u)) {
+        george = true;
+        for_adjacent(v, [&](int t) { george = george && ok(t, u); });
+      }
+      if (george || (!precolored(u) && conservative(u, v))) {
+        combine(u, v);
+        add_worklist(u);
+      } else {
+        move_state[m] = ACTIVE;
+      }
+    }
+  }
+
+  void freeze_moves(int u) {
+    for_node_moves(u, [&](int m) {
+      int x = get_alias(moves[m].first);
+      int y = get_alias(moves[m].second);
+      int v = y == get_alias(u) ? x : y;
+      move_state[m] = DONE;
+      if (!precolored(v) && !move_related(v) && degree[v] < K && state[v] == FREEZE) push(v, SIMPLIFY);
+    });
+  }
+
+  void freeze() {
+    int u = pop(freeze_list, FREEZE);
+    if (u < 0) return;
+    push(u, SIMPLIFY);
+    freeze_moves(u);
+  }
+
+  void select_spill() {
+    int best = -1;
+    double best_cost = 0;
+    for (int u : spill_list) {
+      if (state[u] != SPILL) continue;
+      double c = cost[u] / (degree[u] + 1);
+      if (best < 0 || c < best_cost) {
+        best = u;
+        best_cost = c;
+      }
+    }
+    if (best < 0) {
+      spill_list.clear();
+      return;
+    }
+    push(best, SIMPLIFY);
+    freeze_moves(best);
+  }
+
+  void assign_colors(AllocResult &result) {
+    while (!select_stack.empty()) {
+      int u = select_stack.back();
+      select_stack.pop_back();
+      std::vector<bool> forbidden(REG_NUM, false);
+      for (int w : adj_list[u]) {
+        int a = get_alias(w);
+        if (state[a] == COLORED || precolored(a)) forbidden[color[a]] = true;
+      }
+      int chosen = -1;
+      int hint = func.hints.empty() ? -1 : func.hints[u];
+      if (hint >= 0 && !forbidden[hint]) chosen = hint;
+      // 偏向与传送相关且已着色的结点取同一颜色
+      for (int m : move_list[u]) {
+        if (chosen >= 0) break;
+        int x = get_alias(moves[m].first), y = get_alias(moves[m].second);
+        int other = x == u ? y : x;
+        if ((state[other] == COLORED || precolored(other)) && !forbidden[color[other]]) chosen = color[other];
+      }
+      for (int r : RegAllocator::allocatable()) {
+        if (chosen >= 0) break;
+        if (!forbidden[r]) chosen = r;
+      }
+      if (chosen < 0) {
+        state[u] = SPILLED;
+      } else {
+        state[u] = COLORED;
+        color[u] = chosen;
+      }
+    }
+    result.reg.assign(n, -1);
+    for (int u = 0; u < n; ++u) {
+      int a = get_alias(u);
+      if (state[a] == COLORED) result.reg[u] = color[a];
+    }
+  }
+
+public:
+  explicit IRC(const AllocFunc &f) : func(f), n(f.num_values) {
+    K = RegAllocator::allocatable().size();
+    for (int r : RegAllocator::allocatable()) {
+      if (!is_callee_saved(r)) caller_saved.push_back(r);
+    }
+    int total = n + caller_saved.size();
+    state.assign(total, INITIAL);
+    degree.assign(total, 0);
+    alias.assign(total, -1);
+    color.assign(total, -1);
+    cost.assign(total, 0);
+    adj_list.resize(total);
+    move_list.resize(total);
+    for (size_t k = 0; k < caller_saved.size(); ++k) {
+      state[n + k] = PRECOLORED;
+      color[n + k] = caller_saved[k];
+      degree[n + k] = INT_MAX / 2;
+    }
+  }
+
+  AllocResult run() {
+    Liveness liveness(func);
+    build(liveness);
+    make_worklist();
+    for (;;) {
+      if (has(simplify_list, SIMPLIFY)) simplify();
+      else if (!move_worklist.empty()) coalesce();
+      else if (has(freeze_list, FREEZE)) freeze();
+      else if (has(spill_list, SPILL)) select_spill();
+      else break;
+    }
+    AllocResult result;
+    assign_colors(result);
+    std::vector<bool> used(REG_NUM, false);
+    for (int r : result.reg) {
+      if (r >= 0 && is_callee_saved(r)) used[r] = true;
+    }
+    for (int r : RegAllocator::allocatable()) {
+      if (used[r]) result.used_callee_saved.push_back(r);
+    }
+    return result;
+  }
+};
+
+}
+
+AllocResult GraphColoringAllocator::allocate(const AllocFunc &func) {
+  return IRC(func).run();
+}
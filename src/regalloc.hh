@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// RISC-V 物理寄存器, 编号即硬件编号 x0 ~ x31
+enum Reg : int {
+  ZERO, RA, SP, GP, TP, T0, T1, T2,
+  S0, S1, A0, A1, A2, A3, A4, A5,
+  A6, A7, S2, S3, S4, S5, S6, S7,
+  S8, S9, S10, S11, T3, T4, T5, T6,
+  REG_NUM
+};
+
+const char *reg_name(int reg);
+bool is_callee_saved(int reg);
+
+/*
+ * 寄存器分配器的输入: 与具体 IR 无关的线性化函数
+ * - 每个需要位置的值 (指令结果, 函数参数) 都有一个 [0, num_values) 的编号
+ * - insts 按基本块顺序排列, blocks 记录每个块在 insts 中的区间 [begin, end) 和后继
+ * - 函数参数由入口块开头的一条只有 defs 的伪指令定义
+ * - is_call 的指令会破坏所有 caller-saved 寄存器
+ * - hints 是值的偏好寄存器 (参数 -> a_i, 调用结果 -> a0 ...), -1 表示没有偏好
+ * - copies 是希望分到同一寄存器的值对 (用于合并)
+ */
+struct AllocInst {
+  std::vector<int> defs;
+  std::vector<int> uses;
+  bool is_call = false;
+};
+
+struct AllocBlock {
+  int begin = 0;
+  int end = 0;
+  std::vector<int> succs;
+};
+
+struct AllocFunc {
+  int num_values = 0;
+  std::vector<AllocInst> insts;
+  std::vector<AllocBlock> blocks;
+  std::vector<int> hints;
+  std::vector<std::pair<int, int>> copies;
+};
+
+// 分配结果: reg[v] 为物理寄存器, -1 表示溢出到栈上
+struct AllocResult {
+  std::vector<int> reg;
+  std::vector<int> used_callee_saved;
+};
+
+/*
+ * 活跃变量分析, live_in / live_out 是每个块中活跃的值, 按编号升序排列
+ * 逐个值从向上暴露的使用处沿前驱回溯到定义处 (path exploration), 时间和内存与活跃集合的总大小成正比,
+ * 不随 块数 x 值数 增长; 块内逆序扫描时由分配器把 live_out 装进一个位图 (test / set / reset / for_each)
+ */
+class Liveness {
+public:
+  std::vector<std::vector<int>> live_in;
+  std::vector<std::vector<int>> live_out;
+  explicit Liveness(const AllocFunc &func);
+  static bool test(const std::vector<uint64_t> &set, int v) { return (set[v >> 6] >> (v & 63)) & 1; }
+  static void set(std::vector<uint64_t> &set, int v) { set[v >> 6] |= 1ull << (v & 63); }
+  static void reset(std::vector<uint64_t> &set, int v) { set[v >> 6] &= ~(1ull << (v & 63)); }
+  template <typename F>
+  static void for_each(const std::vector<uint64_t> &set, F f) {
+    for (size_t w = 0; w < set.size(); ++w) {
+      uint64_t bits = set[w];
+      while (bits) {
+        int b = __builtin_ctzll(bits);
+        f(static_cast<int>(w * 64 + b));
+        bits &= bits - 1;
+      }
+    }
+  }
+};
+
+// 为溢出的值分配栈槽, 同时活跃的值不共用槽; 返回每个值的槽号 (未溢出为 -1), num_slots 为槽数
+std::vector<int> assign_spill_slots(const AllocFunc &func, const std::vector<int> &reg, int &num_slots);
+
+class RegAllocator {
+public:
+  // 可分配的寄存器, caller-saved 在前; t0 ~ t3 保留给溢出值的装载、立即数和大偏移寻址
+  static const std::vector<int> &allocatable();
+  virtual ~RegAllocator() = default;
+  virtual AllocResult allocate(const AllocFunc &func) = 0;
+};
+
+// Poletto & Sarkar 线性扫描: 每个值一个 [start, end] 区间, 跨越调用的区间只能用 callee-saved 寄存器
+class LinearScanAllocator : public RegAllocator {
+  struct Interval {
+    int value;
+    int start;
+    int end;
+    bool cross_call;
+  };
+public:
+  AllocResult allocate(const AllocFunc &func) override;
+};
+
+/*
+ * George & Appel 迭代合并图着色 (Iterated Register Coalescing)
+ * 调用点处活跃的值与所有 caller-saved 预着色结点冲突, 溢出的值直接放在栈上,
+ * 由后端借助 t0 ~ t3 装载, 所以不需要改写程序后重新分配
+ */
+class GraphColoringAllocator : public RegAllocator {
+public:
+  AllocResult allocate(const AllocFunc &func) override;
+};
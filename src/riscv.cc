@@ -1,393 +1,793 @@
 #include "riscv.hh"
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <iostream>
 #include <random>
 #include <algorithm>
 
-int RiscV::calculate_function_size(koopa_raw_function_t func, bool &call) {
-  int size = 0;
+// 最多的调用参数个数, call 记录函数中是否有调用
+int RiscV::max_call_args(const ir::Function &func, bool &call) {
   int max_arg = 0;
-  for (size_t i = 0; i < func->bbs.len; ++i) {
-    auto bb_ptr = func->bbs.buffer[i];
-    size += calculate_bb_size(reinterpret_cast<koopa_raw_basic_block_t>(bb_ptr), call, max_arg);
-  }
-  size += max_arg * 4;
-  size += (func->params.len > 8 ? func->params.len - 8 : 0) * 4;
-  size += call ? 4 : 0;
-  return size;
-}
-
-int RiscV::calculate_bb_size(koopa_raw_basic_block_t bb, bool &call, int &max_arg) {
-  int size = 0;
-  for (size_t i = 0; i < bb->insts.len; ++i) {
-    auto inst_ptr = bb->insts.buffer[i];
-    if (reinterpret_cast<koopa_raw_value_t>(inst_ptr)->kind.tag == KOOPA_RVT_CALL) {
-      call = true;
-      max_arg = std::max(max_arg, static_cast<int>(reinterpret_cast<koopa_raw_value_t>(inst_ptr)->kind.data.call.args.len));
+  for (auto &block : func.blocks) {
+    for (int id : block.insts) {
+      const auto &inst = func.insts[id];
+      if (inst.op == ir::Op::Call) {
+        call = true;
+        max_arg = std::max(max_arg, static_cast<int>(inst.ops.size()));
+      }
+    }
+  }
+  return max_arg;
+}
+
+// 指令结果 (alloc 除外, 它的值就是 sp 上的固定偏移) 需要寄存器或栈上的位置
+bool RiscV::has_location(const ir::Inst &inst) {
+  return inst.ty != ir::Type::Unit && inst.op != ir::Op::Alloc;
+}
+
+void RiscV::Environment::initialize(int num_values, bool call) {
+  total_stack_size = 0;
+  has_call = call;
+  current_offset = 0;
+  address.assign(num_values, -1);
+  value_loc.assign(num_values, {Location::IMM, 0});
+  saved_regs.clear();
+}
+
+// 值编号直接使用 IR 中的指令编号
+AllocFunc RiscV::build_alloc_func(const ir::Function &func) {
+  AllocFunc alloc_func;
+  alloc_func.num_values = func.insts.size();
+  alloc_func.hints.assign(alloc_func.num_values, -1);
+  auto located = [&](const ir::Operand &op) {
+    return op.is_value() && has_location(func.insts[op.id]);
+  };
+
+  // 入口处的伪指令定义所有参数
+  AllocInst entry;
+  for (size_t i = 0; i < func.params.size(); ++i) {
+    entry.defs.push_back(func.params[i]);
+    if (i < 8) alloc_func.hints[func.params[i]] = A0 + i;
+  }
+  alloc_func.insts.push_back(entry);
+
+  for (size_t b = 0; b < func.blocks.size(); ++b) {
+    const auto &bb = func.blocks[b];
+    assert(!bb.dead);
+    AllocBlock block;
+    block.begin = b == 0 ? 0 : alloc_func.insts.size();
+    block.succs = bb.succs;
+    int fused = fused_compare(func, b);
+    for (int id : bb.insts) {
+      const auto &inst = func.insts[id];
+      // phi 在前驱的 jump 之前被赋值, 本身不产生指令
+      if (inst.op == ir::Op::Phi) continue;
+      // 与分支融合的比较不单独产生结果, 分支直接读取它的两个操作数
+      if (id == fused) continue;
+      if (inst.op == ir::Op::Br && fused >= 0) {
+        AllocInst branch;
+        for (auto &op : func.insts[fused].ops) {
+          if (located(op)) branch.uses.push_back(op.id);
+        }
+        alloc_func.insts.push_back(branch);
+        continue;
+      }
+      if (inst.op == ir::Op::Jump) {
+        AllocInst phi_copy;
+        for (auto &[phi, incoming] : phi_moves(func, b, inst.targets[0])) {
+          phi_copy.defs.push_back(phi);
+          if (!located(incoming)) continue;
+          phi_copy.uses.push_back(incoming.id);
+          alloc_func.copies.push_back({phi, incoming.id});
+        }
+        if (!phi_copy.defs.empty()) alloc_func.insts.push_back(phi_copy);
+      }
+      AllocInst alloc_inst;
+      alloc_inst.is_call = inst.op == ir::Op::Call;
+      for (size_t k = 0; k < inst.ops.size(); ++k) {
+        const auto &op = inst.ops[k];
+        if (!located(op)) continue;
+        alloc_inst.uses.push_back(op.id);
+        if (inst.op == ir::Op::Call && k < 8 && alloc_func.hints[op.id] < 0) alloc_func.hints[op.id] = A0 + k;
+        if (inst.op == ir::Op::Ret) alloc_func.hints[op.id] = A0;
+      }
+      if (has_location(inst)) {
+        alloc_inst.defs.push_back(id);
+        if (inst.op == ir::Op::Call) alloc_func.hints[id] = A0;
+      }
+      alloc_func.insts.push_back(alloc_inst);
     }
-    size += calculate_inst_size(reinterpret_cast<koopa_raw_value_t>(inst_ptr));
+    block.end = alloc_func.insts.size();
+    alloc_func.blocks.push_back(block);
   }
-  return size;
+  return alloc_func;
 }
 
-int RiscV::calculate_inst_size(koopa_raw_value_t inst) {
-  if (inst->kind.tag == KOOPA_RVT_ALLOC) {
-    return calculate_type_size(inst->ty->data.pointer.base);
+/*
+ * 块 block 以 br 结尾且条件是紧挨在它前面、只被它使用的比较时, 返回该比较,
+ * 后端把两者合成一条 blt / bge / beq ... 指令; 否则返回 -1
+ */
+int RiscV::fused_compare(const ir::Function &func, int block) {
+  const auto &insts = func.blocks[block].insts;
+  if (insts.size() < 2) return -1;
+  const auto &br = func.insts[insts.back()];
+  int cmp = insts[insts.size() - 2];
+  if (br.op != ir::Op::Br || br.ops[0] != ir::Operand::value(cmp) || func.uses[cmp].size() != 1) return -1;
+  switch (func.insts[cmp].op) {
+    case ir::Op::Eq: case ir::Op::Ne: case ir::Op::Lt: case ir::Op::Gt: case ir::Op::Le: case ir::Op::Ge: return cmp;
+    default: return -1;
   }
-  return calculate_type_size(inst->ty);
 }
 
-int RiscV::calculate_type_size(koopa_raw_type_t ty) {
-  switch (ty->tag) {
-    case KOOPA_RTT_INT32: return 4;
-    case KOOPA_RTT_UNIT: return 0;
-    case KOOPA_RTT_POINTER: return 4;
-    case KOOPA_RTT_ARRAY: return calculate_array_size(ty);
-    default: return 0;
+// 从块 pred 跳到 succ 时 succ 中各 phi 的 (phi, 来源值)
+std::vector<std::pair<int, ir::Operand>> RiscV::phi_moves(const ir::Function &func, int pred, int succ) {
+  std::vector<std::pair<int, ir::Operand>> moves;
+  for (int id : func.blocks[succ].insts) {
+    const auto &phi = func.insts[id];
+    if (phi.op != ir::Op::Phi) break;
+    for (size_t i = 0; i < phi.targets.size(); ++i) {
+      if (phi.targets[i] == pred) {
+        moves.push_back({id, phi.ops[i]});
+        break;
+      }
+    }
   }
+  return moves;
 }
 
-int RiscV::calculate_array_size(koopa_raw_type_t ty) {
-  if (ty->tag == KOOPA_RTT_ARRAY) {
-    return calculate_array_size(ty->data.array.base) * ty->data.array.len;
+RiscV::Location RiscV::location_of(const ir::Operand &op) {
+  if (op.is_const()) return {Location::IMM, op.id};
+  assert(op.is_value() && has_location(func->insts[op.id]));
+  return env.value_loc[op.id];
+}
+
+// 返回 sp 上偏移 addr 处的访存操作数, 超出 12 位立即数范围时借助 t3
+std::string RiscV::stack_operand(int addr) {
+  if (addr < 2048 && addr >= -2048) {
+    return std::to_string(addr) + "(sp)";
   }
-  return 4;
+  emit("li", {"t3", std::to_string(addr)});
+  emit("add", {"t3", "sp", "t3"});
+  return "0(t3)";
 }
 
-void RiscV::Environment::initialize(int size, bool call) {
-  total_stack_size = size;
-  has_call = call;
-  current_offset = 0;
-  address_map.clear();
+std::string RiscV::use_register(const ir::Operand &op, const std::string &scratch) {
+  Location loc = location_of(op);
+  switch (loc.kind) {
+    case Location::REG: return reg_name(loc.val);
+    case Location::STACK: emit("lw", {scratch, stack_operand(loc.val)}); break;
+    case Location::IMM:
+      if (loc.val == 0) return "zero";
+      emit("li", {scratch, std::to_string(loc.val)});
+      break;
+  }
+  return scratch;
 }
 
-int RiscV::Environment::get_address(koopa_raw_value_t raw) {
-  if (address_map.find(raw) != address_map.end()) {
-    return address_map[raw];
-  } else {
-    int size = calculate_inst_size(raw);
-    if (size == 0) return -1;
-    address_map[raw] = current_offset;
-    current_offset += size;
-    return address_map[raw];
+std::string RiscV::def_register(int value, const std::string &scratch) {
+  Location loc = env.value_loc[value];
+  return loc.kind == Location::REG ? reg_name(loc.val) : scratch;
+}
+
+void RiscV::emit(const std::string &op, std::vector<std::string> args) {
+  code.push_back({op, std::move(args), ""});
+}
+
+void RiscV::emit_label(const std::string &name) {
+  code.push_back({"", {}, name});
+}
+
+void RiscV::commit(int value, const std::string &reg) {
+  Location loc = env.value_loc[value];
+  if (loc.kind == Location::STACK) {
+    emit("sw", {reg, stack_operand(loc.val)});
   }
 }
 
-void RiscV::load_to_register(koopa_raw_value_t value, const std::string& reg) {
-  if (value->kind.tag == KOOPA_RVT_INTEGER) {
-    output_file << "  li " + reg + ", " + std::to_string(value->kind.data.integer.value) + "\n";
+void RiscV::emit_move(const Location &dst, const Location &src) {
+  if (dst == src) return;
+  if (dst.kind == Location::REG) {
+    std::string rd = reg_name(dst.val);
+    switch (src.kind) {
+      case Location::REG: emit("mv", {rd, reg_name(src.val)}); break;
+      case Location::STACK: emit("lw", {rd, stack_operand(src.val)}); break;
+      case Location::IMM: emit("li", {rd, std::to_string(src.val)}); break;
+    }
   } else {
-    int addr = env.get_address(value);
-    if (addr != -1) {
-      if (addr < 2048 && addr >= -2048) {
-        output_file << "  lw " + reg + ", " + std::to_string(addr) + "(sp)\n";
-      } else {
-        output_file << "  li t3, " + std::to_string(addr) + "\n";
-        output_file << "  add t3, sp, t3\n";
-        output_file << "  lw " + reg + ", 0(t3)\n";
+    assert(dst.kind == Location::STACK);
+    std::string rs;
+    switch (src.kind) {
+      case Location::REG: rs = reg_name(src.val); break;
+      case Location::STACK: rs = "t1"; emit("lw", {"t1", stack_operand(src.val)}); break;
+      case Location::IMM: rs = "t1"; emit("li", {"t1", std::to_string(src.val)}); break;
+    }
+    emit("sw", {rs, stack_operand(dst.val)});
+  }
+}
+
+// 并行赋值 (dst, src): 先做目标不再被读取的赋值, 剩下的都在环上, 用 t0 打破环
+void RiscV::emit_parallel_move(std::vector<std::pair<Location, Location>> moves) {
+  moves.erase(std::remove_if(moves.begin(), moves.end(), [](const std::pair<Location, Location> &m) {
+    return m.first == m.second;
+  }), moves.end());
+  while (!moves.empty()) {
+    bool progress = false;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      bool blocked = false;
+      for (size_t j = 0; j < moves.size(); ++j) {
+        if (j != i && moves[j].second == moves[i].first) {
+          blocked = true;
+          break;
+        }
+      }
+      if (!blocked) {
+        emit_move(moves[i].first, moves[i].second);
+        moves.erase(moves.begin() + i);
+        progress = true;
+        break;
+      }
+    }
+    if (!progress) {
+      Location tmp = {Location::REG, T0};
+      Location dst = moves.front().first;
+      emit_move(tmp, dst);
+      for (auto &m : moves) {
+        if (m.second == dst) m.second = tmp;
       }
-    } else {
-      assert(false);
     }
   }
 }
 
-void RiscV::store_to_stack(int addr, const std::string& reg) {
-  if (addr != -1) {
+// 指针值所在的寄存器: 全局变量用 la, 局部 alloc 由 sp 加偏移得到
+std::string RiscV::base_register(const ir::Operand &ptr, const std::string &scratch) {
+  if (ptr.kind == ir::Operand::GLOBAL) {
+    emit("la", {scratch, module->globals[ptr.id].name});
+    return scratch;
+  }
+  if (ptr.is_value() && func->insts[ptr.id].op == ir::Op::Alloc) {
+    int addr = env.address[ptr.id];
     if (addr < 2048 && addr >= -2048) {
-      output_file << "  sw " + reg + ", " + std::to_string(addr) + "(sp)\n";
+      emit("addi", {scratch, "sp", std::to_string(addr)});
     } else {
-      output_file << "  li t3, " + std::to_string(addr) + "\n";
-      output_file << "  add t3, sp, t3\n";
-      output_file << "  sw " + reg + ", 0(t3)\n";
+      emit("li", {"t3", std::to_string(addr)});
+      emit("add", {scratch, "sp", "t3"});
     }
-  } else {
-    assert(false);
+    return scratch;
   }
+  return use_register(ptr, scratch);
+}
+
+// 基本块的标签, 加上函数名避免不同函数中的同名块冲突
+std::string RiscV::label(int block) const {
+  return ".L" + func->name + "_" + func->blocks[block].name;
 }
 
-void RiscV::visit_raw_program(const koopa_raw_program_t &raw) {
-  if (raw.values.len != 0) {
-    output_file << "  .data\n";
-    visit_raw_slice(raw.values);
+void RiscV::visit_program(const ir::Module &module) {
+  // 可写的全局变量放在 .data, 只读的放在 .rodata
+  for (bool readonly : {false, true}) {
+    bool first = true;
+    for (auto &global : module.globals) {
+      if (global.readonly != readonly) continue;
+      if (first) output_file << (readonly ? "\n  .section .rodata\n" : "  .data\n");
+      first = false;
+      visit_global(global);
+    }
   }
   output_file << "\n  .text\n";
-  visit_raw_slice(raw.funcs);
+  for (auto &func : module.funcs) {
+    if (!func.is_decl) visit_function(func);
+  }
 }
 
-void RiscV::visit_raw_slice(const koopa_raw_slice_t &slice) {
-  for (size_t i = 0; i < slice.len; ++i) {
-    auto ptr = slice.buffer[i];
-    switch (slice.kind) {
-      case KOOPA_RSIK_FUNCTION: visit_raw_function(reinterpret_cast<const koopa_raw_function_t>(ptr)); break;
-      case KOOPA_RSIK_BASIC_BLOCK: visit_raw_basic_block(reinterpret_cast<koopa_raw_basic_block_t>(ptr)); break;
-      case KOOPA_RSIK_VALUE: visit_raw_value(reinterpret_cast<koopa_raw_value_t>(ptr)); break;
-      default: assert(false);
+void RiscV::visit_global(const ir::Global &global) {
+  output_file << "\n  .global " + global.name + "\n";
+  output_file << global.name + ":\n";
+  if (global.init.empty()) {
+    output_file << "  .zero " + std::to_string(global.size) + "\n";
+    return;
+  }
+  // 连续的零合并成一条 .zero, 其余每行最多 8 个字
+  const size_t per_line = 8;
+  for (size_t i = 0; i < global.init.size();) {
+    size_t j = i;
+    while (j < global.init.size() && global.init[j] == 0) ++j;
+    if (j - i >= 2) {
+      output_file << "  .zero " + std::to_string((j - i) * 4) + "\n";
+      i = j;
+      continue;
     }
+    output_file << "  .word " + std::to_string(global.init[i]);
+    for (++i; i < global.init.size() && i % per_line != 0; ++i) {
+      if (global.init[i] == 0 && i + 1 < global.init.size() && global.init[i + 1] == 0) break;
+      output_file << ", " + std::to_string(global.init[i]);
+    }
+    output_file << "\n";
   }
 }
 
-void RiscV::visit_raw_function(const koopa_raw_function_t &func) {
-  if (func->bbs.len == 0) return;
-  output_file << "\n  .globl  " << std::string(func->name + 1) + "\n";
-  output_file << std::string(func->name + 1) + ":\n";
+void RiscV::visit_function(const ir::Function &function) {
+  func = &function;
+  output_file << "\n  .globl  " << func->name + "\n";
+  output_file << func->name + ":\n";
   bool call = false;
-  int size = calculate_function_size(func, call);
-  size = (size + 15) / 16 * 16 * 2;
+  int max_arg = max_call_args(*func, call);
+  env.initialize(func->insts.size(), call);
+
+  AllocFunc alloc_func = build_alloc_func(*func);
+  std::unique_ptr<RegAllocator> allocator;
+  if (opt_level >= 2) {
+    allocator = std::make_unique<GraphColoringAllocator>();
+  } else {
+    allocator = std::make_unique<LinearScanAllocator>();
+  }
+  AllocResult alloc = allocator->allocate(alloc_func);
+
+  // 栈帧自底向上: 传给被调函数的第 9 个及以后的参数, 溢出值的栈槽, 局部变量 (小的在前, 偏移尽量落在 12 位立即数内),
+  // callee-saved 寄存器, ra
+  env.current_offset = (max_arg > 8 ? max_arg - 8 : 0) * 4;
+  int num_slots = 0;
+  std::vector<int> slot = assign_spill_slots(alloc_func, alloc.reg, num_slots);
+  for (size_t v = 0; v < func->insts.size(); ++v) {
+    if (!has_location(func->insts[v])) continue;
+    if (alloc.reg[v] >= 0) {
+      env.value_loc[v] = {Location::REG, alloc.reg[v]};
+    } else {
+      env.value_loc[v] = {Location::STACK, env.current_offset + slot[v] * 4};
+    }
+  }
+  env.current_offset += num_slots * 4;
+  std::vector<int> allocs;
+  for (auto &block : func->blocks) {
+    for (int id : block.insts) {
+      if (func->insts[id].op == ir::Op::Alloc) allocs.push_back(id);
+    }
+  }
+  std::stable_sort(allocs.begin(), allocs.end(), [&](int a, int b) { return func->insts[a].size < func->insts[b].size; });
+  for (int id : allocs) {
+    env.address[id] = env.current_offset;
+    env.current_offset += func->insts[id].size;
+  }
+  env.saved_regs = alloc.used_callee_saved;
+  int size = env.current_offset + env.saved_regs.size() * 4 + (call ? 4 : 0);
+  size = (size + 15) / 16 * 16;
+  env.total_stack_size = size;
+
   if (size < 2048 && size >= -2048) {
-    output_file << "  addi sp, sp, -" + std::to_string(size) + "\n";
+    emit("addi", {"sp", "sp", std::to_string(-size)});
   } else if (size > 0) {
-    output_file << "  li t0, -" + std::to_string(size) + "\n";
-    output_file << "  add sp, sp, t0\n";
+    emit("li", {"t0", std::to_string(-size)});
+    emit("add", {"sp", "sp", "t0"});
   }
   if (call) {
-    if (size - 4 < 2048 && size - 4 >= -2048)
-      output_file << "  sw ra, " + std::to_string(size - 4) + "(sp)\n";
-    else {
-      output_file << "  li t0, " + std::to_string(size - 4) + "\n";
-      output_file << "  add t0, sp, t0\n";
-      output_file << "  sw ra, 0(t0)\n";
+    emit("sw", {"ra", stack_operand(size - 4)});
+  }
+  for (size_t i = 0; i < env.saved_regs.size(); ++i) {
+    emit("sw", {std::string(reg_name(env.saved_regs[i])), stack_operand(env.saved_reg_offset(i))});
+  }
+
+  // 参数从 a0 ~ a7 和调用者栈帧底部搬到分配的位置
+  std::vector<std::pair<Location, Location>> moves;
+  for (size_t i = 0; i < func->params.size(); ++i) {
+    Location src = i < 8 ? Location{Location::REG, static_cast<int>(A0 + i)} : Location{Location::STACK, static_cast<int>(size + (i - 8) * 4)};
+    moves.push_back({env.value_loc[func->params[i]], src});
+  }
+  emit_parallel_move(moves);
+  for (size_t b = 0; b < func->blocks.size(); ++b) visit_block(b);
+
+  if (opt_level >= 1) peephole(code);
+  for (auto &inst : code) output_file << inst;
+  code.clear();
+}
+
+void RiscV::visit_block(int block) {
+  // 入口块紧跟在函数标签之后, 只有被跳转到时才需要自己的标签
+  if (block != 0 || !func->blocks[block].preds.empty())
+    emit_label(label(block));
+  int fused = fused_compare(*func, block);
+  for (int id : func->blocks[block].insts) {
+    const auto &inst = func->insts[id];
+    if (id == fused) continue;
+    if (inst.op == ir::Op::Br && fused >= 0) {
+      visit_compare_branch(inst, id, func->insts[fused]);
+      break;
     }
+    if (inst.op == ir::Op::Jump) {
+      std::vector<std::pair<Location, Location>> moves;
+      for (auto &[phi, incoming] : phi_moves(*func, block, inst.targets[0])) {
+        moves.push_back({env.value_loc[phi], location_of(incoming)});
+      }
+      emit_parallel_move(moves);
+    }
+    if (inst.op == ir::Op::Call && inst.tail) {
+      // 尾调用之后的 ret 不再需要
+      visit_tail_call(inst);
+      break;
+    }
+    visit_inst(id);
   }
-  env.initialize(size, call);
-  env.total_stack_size -= call ? 4 : 0;
-  env.current_offset += (func->params.len > 8 ? func->params.len - 8 : 0) * 4;
-  visit_raw_slice(func->bbs);
-}
-
-void RiscV::visit_raw_basic_block(const koopa_raw_basic_block_t &bb) {
-  std::string name = bb->name + 1;
-  if (name != "entry")
-    output_file << name << ":\n";
-  visit_raw_slice(bb->insts);
-}
-
-void RiscV::visit_raw_value(const koopa_raw_value_t &value) {
-  const auto &kind = value->kind;
-  int addr = env.get_address(value);
-  switch (kind.tag) {
-    case KOOPA_RVT_RETURN: visit_return(kind.data.ret); break;
-    case KOOPA_RVT_INTEGER: break;
-    case KOOPA_RVT_ALLOC: break;
-    case KOOPA_RVT_LOAD: visit_load(kind.data.load, addr); break;
-    case KOOPA_RVT_STORE: visit_store(kind.data.store); break;
-    case KOOPA_RVT_BINARY: visit_binary(kind.data.binary, addr); break;
-    case KOOPA_RVT_BRANCH: visit_branch(kind.data.branch); break;
-    case KOOPA_RVT_JUMP: visit_jump(kind.data.jump); break;
-    case KOOPA_RVT_CALL: visit_call(kind.data.call, addr); break;
-    case KOOPA_RVT_GLOBAL_ALLOC: handle_global_alloc(value); break;
-    case KOOPA_RVT_GET_ELEM_PTR: visit_get_elem_ptr(kind.data.get_elem_ptr, addr); break;
-    case KOOPA_RVT_GET_PTR: visit_get_ptr(kind.data.get_ptr, addr); break;
-    default: assert(false);
+}
+
+void RiscV::visit_inst(int id) {
+  const auto &inst = func->insts[id];
+  switch (inst.op) {
+    case ir::Op::Alloc:
+    case ir::Op::Phi: break;
+    case ir::Op::Load: visit_load(inst, id); break;
+    case ir::Op::Store: visit_store(inst, id); break;
+    case ir::Op::GetElemPtr:
+    case ir::Op::GetPtr: visit_get_ptr(inst, id); break;
+    case ir::Op::GlobalAddr: visit_global_addr(inst, id); break;
+    case ir::Op::Call: visit_call(inst, id); break;
+    case ir::Op::Br: visit_branch(inst, id); break;
+    case ir::Op::Jump: visit_jump(inst); break;
+    case ir::Op::Ret: visit_return(inst); break;
+    default:
+      if (ir::is_binary(inst.op)) {
+        visit_binary(inst, id);
+        break;
+      }
+      std::cerr << "RiscV: unsupported instruction " << ir::op_name(inst.op) << std::endl;
+      assert(false);
   }
 }
 
-void RiscV::visit_return(const koopa_raw_return_t &ret_value) {
-  if (ret_value.value != nullptr) {
-    load_to_register(ret_value.value, "a0");
+void RiscV::visit_return(const ir::Inst &inst) {
+  if (!inst.ops.empty()) {
+    emit_move({Location::REG, A0}, location_of(inst.ops[0]));
+  }
+  emit_epilogue();
+  emit("ret");
+}
+
+// 恢复 callee-saved 寄存器和 ra, 释放栈帧
+void RiscV::emit_epilogue() {
+  int size = env.total_stack_size;
+  for (size_t i = 0; i < env.saved_regs.size(); ++i) {
+    emit("lw", {std::string(reg_name(env.saved_regs[i])), stack_operand(env.saved_reg_offset(i))});
   }
   if (env.has_call) {
-    if (env.total_stack_size < 2048 && env.total_stack_size >= -2048)
-      output_file << "  lw ra, " + std::to_string(env.total_stack_size) + "(sp)\n";
-    else {
-      output_file << "  li t0, " + std::to_string(env.total_stack_size) + "\n";
-      output_file << "  add t0, sp, t0\n";
-      output_file << "  lw ra, 0(t0)\n";
-    }
+    emit("lw", {"ra", stack_operand(size - 4)});
   }
-  int size = env.total_stack_size;
-  size += env.has_call ? 4 : 0;
   if (size < 2048 && size >= -2048) {
-    output_file << "  addi sp, sp, " + std::to_string(size) + "\n";
+    emit("addi", {"sp", "sp", std::to_string(size)});
   } else if (size > 0) {
-    output_file << "  li t0, " + std::to_string(size) + "\n";
-    output_file << "  add sp, sp, t0\n";
-  }
-  output_file << "  ret\n";
-}
-
-void RiscV::visit_binary(const koopa_raw_binary_t &binary_value, int addr) {
-  std::string rd = "t0";
-  std::string rs1 = "t0";
-  std::string rs2 = "t1";
-  load_to_register(binary_value.lhs, rs1);
-  load_to_register(binary_value.rhs, rs2);
-  switch (binary_value.op) {
-    case KOOPA_RBO_ADD: output_file << "  add " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_SUB: output_file << "  sub " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_MUL: output_file << "  mul " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_DIV: output_file << "  div " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_MOD: output_file << "  rem " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_AND: output_file << "  and " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_OR: output_file << "  or " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_EQ: output_file << "  xor " + rd + ", " + rs1 + ", " + rs2 + "\n"; output_file << "  seqz " + rd + ", " + rd + "\n"; break;
-    case KOOPA_RBO_NOT_EQ: output_file << "  xor " + rd + ", " + rs1 + ", " + rs2 + "\n"; output_file << "  snez " + rd + ", " + rd + "\n"; break;
-    case KOOPA_RBO_GT: output_file << "  sgt " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_LT: output_file << "  slt " + rd + ", " + rs1 + ", " + rs2 + "\n"; break;
-    case KOOPA_RBO_GE: output_file << "  slt " + rd + ", " + rs1 + ", " + rs2 + "\n"; output_file << "  seqz " + rd + ", " + rd + "\n"; break;
-    case KOOPA_RBO_LE: output_file << "  sgt " + rd + ", " + rs1 + ", " + rs2 + "\n"; output_file << "  seqz " + rd + ", " + rd + "\n"; break;
+    emit("li", {"t0", std::to_string(size)});
+    emit("add", {"sp", "sp", "t0"});
+  }
+}
+
+void RiscV::visit_binary(const ir::Inst &inst, int id) {
+  ir::Operand lhs = inst.ops[0], rhs = inst.ops[1];
+  // 可交换的运算把常量换到右边
+  if (lhs.is_const() && !rhs.is_const() && ir::is_commutative(inst.op)) std::swap(lhs, rhs);
+  if (rhs.is_const() && visit_binary_imm(inst.op, lhs, rhs.id, id)) return;
+  std::string rs1 = use_register(lhs, "t0");
+  std::string rs2 = use_register(rhs, "t1");
+  std::string rd = def_register(id, "t0");
+  switch (inst.op) {
+    case ir::Op::Add: emit("add", {rd, rs1, rs2}); break;
+    case ir::Op::Sub: emit("sub", {rd, rs1, rs2}); break;
+    case ir::Op::Mul: emit("mul", {rd, rs1, rs2}); break;
+    case ir::Op::Div: emit("div", {rd, rs1, rs2}); break;
+    case ir::Op::Mod: emit("rem", {rd, rs1, rs2}); break;
+    case ir::Op::And: emit("and", {rd, rs1, rs2}); break;
+    case ir::Op::Or: emit("or", {rd, rs1, rs2}); break;
+    case ir::Op::Xor: emit("xor", {rd, rs1, rs2}); break;
+    case ir::Op::Shl: emit("sll", {rd, rs1, rs2}); break;
+    case ir::Op::Shr: emit("srl", {rd, rs1, rs2}); break;
+    case ir::Op::Sar: emit("sra", {rd, rs1, rs2}); break;
+    case ir::Op::Eq: emit("xor", {rd, rs1, rs2}); emit("seqz", {rd, rd}); break;
+    case ir::Op::Ne: emit("xor", {rd, rs1, rs2}); emit("snez", {rd, rd}); break;
+    case ir::Op::Gt: emit("sgt", {rd, rs1, rs2}); break;
+    case ir::Op::Lt: emit("slt", {rd, rs1, rs2}); break;
+    case ir::Op::Ge: emit("slt", {rd, rs1, rs2}); emit("seqz", {rd, rd}); break;
+    case ir::Op::Le: emit("sgt", {rd, rs1, rs2}); emit("seqz", {rd, rd}); break;
     default: break;
   }
-  store_to_stack(addr, rd);
+  commit(id, rd);
 }
 
-void RiscV::visit_store(const koopa_raw_store_t &store_value) {
-  if (store_value.dest->kind.tag == KOOPA_RVT_GLOBAL_ALLOC) {
-    output_file << "  la t1, " + std::string(store_value.dest->name + 1) + "\n";
-    load_to_register(store_value.value, "t0");
-    output_file << "  sw t0, 0(t1)\n";
-  } else if (store_value.dest->kind.tag == KOOPA_RVT_GET_ELEM_PTR || store_value.dest->kind.tag == KOOPA_RVT_GET_PTR) {
-    load_to_register(store_value.dest, "t1");
-    load_to_register(store_value.value, "t0");
-    output_file << "  sw t0, 0(t1)\n";
+void RiscV::visit_store(const ir::Inst &inst, int id) {
+  if (inst.size > 0) {
+    visit_fill(inst, id);
+    return;
+  }
+  std::string rs = use_register(inst.ops[0], "t0");
+  const auto &dest = inst.ops[1];
+  if (dest.is_value() && func->insts[dest.id].op == ir::Op::Alloc) {
+    emit("sw", {rs, stack_operand(env.address[dest.id])});
   } else {
-    int addr = env.get_address(store_value.dest);
-    if (store_value.value->kind.tag == KOOPA_RVT_FUNC_ARG_REF) {
-      if (store_value.value->kind.data.func_arg_ref.index < 8) {
-        store_to_stack(addr, "a" + std::to_string(store_value.value->kind.data.func_arg_ref.index));
+    std::string base = base_register(dest, "t1");
+    emit("sw", {rs, std::string("0(") + base + ")"});
+  }
+}
+
+/*
+ * 填充 dest 开始的 size 字节: 不超过 16 个字时直接展开, 否则 t0 从头走到 t1 (末尾), 每次迭代写 4 个字
+ * 循环标签处 t0 / t1 仍然活跃, 窥孔优化不会把临时寄存器在标签处当作死的
+ */
+void RiscV::visit_fill(const ir::Inst &inst, int id) {
+  const int unroll = 4;
+  int words = inst.size / 4;
+  std::string rs = use_register(inst.ops[0], "t2");
+  const auto &dest = inst.ops[1];
+  bool on_stack = dest.is_value() && func->insts[dest.id].op == ir::Op::Alloc;
+  if (words <= 4 * unroll) {
+    std::string base = on_stack ? "" : base_register(dest, "t0");
+    for (int k = 0; k < words; ++k) {
+      emit("sw", {rs, on_stack ? stack_operand(env.address[dest.id] + 4 * k) : std::to_string(4 * k) + "(" + base + ")"});
+    }
+    return;
+  }
+  std::string base = base_register(dest, "t0");
+  if (base != "t0") emit("mv", {"t0", base});
+  if (inst.size < 2048) {
+    emit("addi", {"t1", "t0", std::to_string(inst.size)});
+  } else {
+    emit("li", {"t1", std::to_string(inst.size)});
+    emit("add", {"t1", "t0", "t1"});
+  }
+  // 先写掉不足一轮的零头
+  int head = words % unroll;
+  for (int k = 0; k < head; ++k) emit("sw", {rs, std::to_string(4 * k) + "(t0)"});
+  if (head > 0) emit("addi", {"t0", "t0", std::to_string(4 * head)});
+  std::string loop = label(inst.block) + "_fill" + std::to_string(id);
+  emit_label(loop);
+  for (int k = 0; k < unroll; ++k) emit("sw", {rs, std::to_string(4 * k) + "(t0)"});
+  emit("addi", {"t0", "t0", std::to_string(4 * unroll)});
+  emit("bne", {"t0", "t1", loop});
+}
+
+/*
+ * 右操作数是常量 imm 时的指令选择: 12 位以内的常量使用立即数形式 (x - c 即 x + (-c), x <= c 即 x < c + 1),
+ * 乘以 2 的幂改为左移, 除以常量改为乘高位和移位; 不适用时返回 false, 由调用者使用寄存器形式
+ */
+bool RiscV::visit_binary_imm(ir::Op op, const ir::Operand &lhs, int imm, int id) {
+  long long v = op == ir::Op::Sub ? -static_cast<long long>(imm) : op == ir::Op::Le ? imm + 1LL : imm;
+  bool fits = v >= -2048 && v < 2048;
+  switch (op) {
+    case ir::Op::Add: case ir::Op::Sub: case ir::Op::And: case ir::Op::Or: case ir::Op::Xor:
+    case ir::Op::Lt: case ir::Op::Le: case ir::Op::Ge: case ir::Op::Eq: case ir::Op::Ne:
+      if (!fits) return false;
+      break;
+    case ir::Op::Shl: case ir::Op::Shr: case ir::Op::Sar: break;
+    case ir::Op::Mul:
+      if (imm <= 0 || (imm & (imm - 1)) != 0) return false;
+      break;
+    case ir::Op::Div: case ir::Op::Mod:
+      if (imm == 0 || imm == INT_MIN) return false;
+      break;
+    default: return false;
+  }
+  std::string rs = use_register(lhs, "t0");
+  std::string rd = def_register(id, "t0");
+  std::string c = std::to_string(v);
+  switch (op) {
+    case ir::Op::Add: case ir::Op::Sub: emit("addi", {rd, rs, c}); break;
+    case ir::Op::And: emit("andi", {rd, rs, c}); break;
+    case ir::Op::Or: emit("ori", {rd, rs, c}); break;
+    case ir::Op::Xor: emit("xori", {rd, rs, c}); break;
+    case ir::Op::Lt: case ir::Op::Le: emit("slti", {rd, rs, c}); break;
+    case ir::Op::Ge: emit("slti", {rd, rs, c}); emit("xori", {rd, rd, "1"}); break;
+    case ir::Op::Eq: case ir::Op::Ne:
+      if (imm != 0) {
+        emit("xori", {rd, rs, c});
+        rs = rd;
+      }
+      emit(op == ir::Op::Eq ? "seqz" : "snez", {rd, rs});
+      break;
+    case ir::Op::Shl: emit("slli", {rd, rs, std::to_string(imm & 31)}); break;
+    case ir::Op::Shr: emit("srli", {rd, rs, std::to_string(imm & 31)}); break;
+    case ir::Op::Sar: emit("srai", {rd, rs, std::to_string(imm & 31)}); break;
+    case ir::Op::Mul: emit("slli", {rd, rs, std::to_string(__builtin_ctz(imm))}); break;
+    default: emit_divide_by_constant(op == ir::Op::Mod, rs, rd, imm); break;
+  }
+  commit(id, rd);
+  return true;
+}
+
+/*
+ * 有符号除法的魔数 (Hacker's Delight 10-1): d >= 2 时 n / d == (mulh(n, magic) [+ n]) >> shift, 再对负数加 1,
+ * magic 为负时需要加上 n
+ */
+void RiscV::signed_magic(int d, int &magic, int &shift) {
+  const uint32_t two31 = 0x80000000u;
+  uint32_t ad = d;
+  uint32_t anc = two31 - 1 - two31 % ad;
+  int p = 31;
+  uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+  uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+  uint32_t delta;
+  do {
+    ++p;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      ++q1;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= ad) {
+      ++q2;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  magic = static_cast<int>(q2 + 1);
+  shift = p - 32;
+}
+
+/*
+ * rd = rs / d 或 rs % d (向零舍入, d 不为 0 和 INT_MIN), 按 |d| 计算商, d 为负时取反
+ * 只在最后一条指令写 rd, rd 可以和 rs 是同一个寄存器
+ */
+void RiscV::emit_divide_by_constant(bool rem, const std::string &rs, const std::string &rd, int d) {
+  int ad = d < 0 ? -d : d;
+  if (ad == 1) {
+    if (rem) emit("mv", {rd, "zero"});
+    else if (d > 0) emit("mv", {rd, rs});
+    else emit("sub", {rd, "zero", rs});
+    return;
+  }
+  if ((ad & (ad - 1)) == 0) {
+    // 负数先加上 2^k - 1, 使算术右移向零舍入
+    int k = __builtin_ctz(ad);
+    if (k == 1) {
+      emit("srli", {"t1", rs, "31"});
+    } else {
+      emit("srai", {"t1", rs, "31"});
+      emit("srli", {"t1", "t1", std::to_string(32 - k)});
+    }
+    emit("add", {"t1", rs, "t1"});
+    if (rem) {
+      if (k <= 11) {
+        emit("andi", {"t1", "t1", std::to_string(-ad)});
       } else {
-        if ((store_value.value->kind.data.func_arg_ref.index - 8) * 4 < 2048 && (store_value.value->kind.data.func_arg_ref.index - 8) * 4 >= -2048)
-          output_file << "  lw t0, " << (store_value.value->kind.data.func_arg_ref.index - 8) * 4 << "(sp)\n";
-        else {
-          output_file << "  li t3, " << (store_value.value->kind.data.func_arg_ref.index - 8) * 4 << "\n";
-          output_file << "  add t3, sp, t3\n";
-          output_file << "  lw t0, 0(t3)\n";
-        }
-        store_to_stack(addr, "t0");
+        emit("srai", {"t1", "t1", std::to_string(k)});
+        emit("slli", {"t1", "t1", std::to_string(k)});
       }
+      emit("sub", {rd, rs, "t1"});
+    } else if (d > 0) {
+      emit("srai", {rd, "t1", std::to_string(k)});
     } else {
-      load_to_register(store_value.value, "t0");
-      store_to_stack(addr, "t0");
+      emit("srai", {"t1", "t1", std::to_string(k)});
+      emit("sub", {rd, "zero", "t1"});
     }
+    return;
+  }
+  int magic, shift;
+  signed_magic(ad, magic, shift);
+  emit("li", {"t1", std::to_string(magic)});
+  emit("mulh", {"t1", rs, "t1"});
+  if (magic < 0) emit("add", {"t1", "t1", rs});
+  if (shift > 0) emit("srai", {"t1", "t1", std::to_string(shift)});
+  emit("srli", {"t2", rs, "31"});
+  if (rem) {
+    emit("add", {"t1", "t1", "t2"});
+    emit("li", {"t2", std::to_string(ad)});
+    emit("mul", {"t1", "t1", "t2"});
+    emit("sub", {rd, rs, "t1"});
+  } else if (d > 0) {
+    emit("add", {rd, "t1", "t2"});
+  } else {
+    emit("add", {"t1", "t1", "t2"});
+    emit("sub", {rd, "zero", "t1"});
   }
 }
 
-void RiscV::visit_load(const koopa_raw_load_t &load_value, int addr) {
-  std::string rs1 = "t0";
-  if (load_value.src->kind.tag == KOOPA_RVT_GLOBAL_ALLOC) {
-    output_file << "  la " + rs1 + ", " + std::string(load_value.src->name + 1) + "\n";
-    output_file << "  lw " + rs1 + ", 0(" + rs1 + ")\n";
-  } else if (load_value.src->kind.tag == KOOPA_RVT_GET_ELEM_PTR || load_value.src->kind.tag == KOOPA_RVT_GET_PTR) {
-    load_to_register(load_value.src, rs1);
-    output_file << "  lw " + rs1 + ", 0(" + rs1 + ")\n";
+void RiscV::visit_load(const ir::Inst &inst, int id) {
+  std::string rd = def_register(id, "t0");
+  const auto &src = inst.ops[0];
+  if (src.is_value() && func->insts[src.id].op == ir::Op::Alloc) {
+    emit("lw", {rd, stack_operand(env.address[src.id])});
   } else {
-    load_to_register(load_value.src, rs1);
+    std::string base = base_register(src, "t0");
+    emit("lw", {rd, std::string("0(") + base + ")"});
   }
-  store_to_stack(addr, rs1);
+  commit(id, rd);
 }
 
-void RiscV::visit_branch(const koopa_raw_branch_t &branch_value) {
-  load_to_register(branch_value.cond, "t0");
-  output_file << "  bnez t0, " + std::string(branch_value.true_bb->name + 1) + "_tmp" + "\n";
-  output_file << "  j " + std::string(branch_value.false_bb->name + 1) + "\n";
-  output_file << std::string(branch_value.true_bb->name + 1) + "_tmp:\n";
-  output_file << "  j " + std::string(branch_value.true_bb->name + 1) + "\n";
+void RiscV::visit_branch(const ir::Inst &inst, int id) {
+  // 通向含 phi 的块的边已被 split-critical-edges 拆开, 分支目标不会有 phi
+  for (int t : inst.targets) assert(func->insts[func->blocks[t].insts.front()].op != ir::Op::Phi);
+  std::string cond = use_register(inst.ops[0], "t0");
+  std::string tmp = label(inst.targets[0]) + "_tmp" + std::to_string(id);
+  emit("bnez", {cond, tmp});
+  emit("j", {label(inst.targets[1])});
+  emit_label(tmp);
+  emit("j", {label(inst.targets[0])});
+}
+
+// 比较和分支融合: 条件为真时跳到跳板, 由窥孔优化在距离允许时改成直接的 (反向) 条件分支
+void RiscV::visit_compare_branch(const ir::Inst &inst, int id, const ir::Inst &cmp) {
+  for (int t : inst.targets) assert(func->insts[func->blocks[t].insts.front()].op != ir::Op::Phi);
+  const char *name = nullptr;
+  switch (cmp.op) {
+    case ir::Op::Eq: name = "beq"; break;
+    case ir::Op::Ne: name = "bne"; break;
+    case ir::Op::Lt: name = "blt"; break;
+    case ir::Op::Gt: name = "bgt"; break;
+    case ir::Op::Le: name = "ble"; break;
+    case ir::Op::Ge: name = "bge"; break;
+    default: assert(false);
+  }
+  std::string rs1 = use_register(cmp.ops[0], "t0");
+  std::string rs2 = use_register(cmp.ops[1], "t1");
+  std::string tmp = label(inst.targets[0]) + "_tmp" + std::to_string(id);
+  emit(name, {rs1, rs2, tmp});
+  emit("j", {label(inst.targets[1])});
+  emit_label(tmp);
+  emit("j", {label(inst.targets[0])});
 }
 
-void RiscV::visit_jump(const koopa_raw_jump_t &jump_value) {
-  output_file << "  j " + std::string(jump_value.target->name + 1) + "\n";
+void RiscV::visit_jump(const ir::Inst &inst) {
+  emit("j", {label(inst.targets[0])});
 }
 
-void RiscV::visit_call(const koopa_raw_call_t &call_value, int addr) {
-  for (int i = 0; i < call_value.args.len && i < 8; ++i) {
-    auto arg_ptr = call_value.args.buffer[i];
-    load_to_register(reinterpret_cast<koopa_raw_value_t>(arg_ptr), "a" + std::to_string(i));
+// 尾调用: 实参就位后释放自己的栈帧, 被调函数直接返回到调用者的调用者
+void RiscV::visit_tail_call(const ir::Inst &inst) {
+  std::vector<std::pair<Location, Location>> moves;
+  for (size_t i = 0; i < inst.ops.size(); ++i) {
+    moves.push_back({{Location::REG, static_cast<int>(A0 + i)}, location_of(inst.ops[i])});
   }
-  bool call = false;
-  int size = calculate_function_size(call_value.callee, call);
-  size = (size + 15) / 16 * 16 * 2;
-  for (int i = 8; i < call_value.args.len; ++i) {
-    auto arg_ptr = call_value.args.buffer[i];
-    load_to_register(reinterpret_cast<koopa_raw_value_t>(arg_ptr), "t0");
-    store_to_stack((i - 8) * 4 - size, "t0");
-  }
-  output_file << "  call " + std::string(call_value.callee->name + 1) + "\n";
-  if (addr != -1) store_to_stack(addr, "a0");
-}
-
-void RiscV::handle_global_alloc(const koopa_raw_value_t &global_alloc_value) {
-  output_file << "\n  .global " + std::string(global_alloc_value->name + 1) + "\n";
-  output_file << std::string(global_alloc_value->name + 1) + ":\n";
-  if (global_alloc_value->kind.data.global_alloc.init->kind.tag == KOOPA_RVT_INTEGER) {
-    output_file << "  .word " + std::to_string(global_alloc_value->kind.data.global_alloc.init->kind.data.integer.value) + "\n";
-  } else if (global_alloc_value->kind.data.global_alloc.init->kind.tag == KOOPA_RVT_ZERO_INIT) {
-    output_file << "  .zero " + std::to_string(calculate_type_size(global_alloc_value->ty->data.pointer.base)) + "\n";
-  } else if (global_alloc_value->kind.data.global_alloc.init->kind.tag == KOOPA_RVT_AGGREGATE) {
-    visit_aggregate(global_alloc_value->kind.data.global_alloc.init->kind.data.aggregate);
-  }
-}
-
-void RiscV::visit_aggregate(const koopa_raw_aggregate_t &aggregate_value) {
-  for (size_t i = 0; i < aggregate_value.elems.len; ++i) {
-    auto elem_ptr = aggregate_value.elems.buffer[i];
-    koopa_raw_value_t value = reinterpret_cast<koopa_raw_value_t>(elem_ptr);
-    if (value->kind.tag == KOOPA_RVT_INTEGER) {
-      output_file << "  .word " + std::to_string(value->kind.data.integer.value) + "\n";
-    } else if (value->kind.tag == KOOPA_RVT_AGGREGATE) {
-      visit_aggregate(value->kind.data.aggregate);
-    } else {
-      assert(false);
-    }
+  emit_parallel_move(moves);
+  emit_epilogue();
+  emit("tail", {module->funcs[inst.callee].name});
+}
+
+void RiscV::visit_call(const ir::Inst &inst, int id) {
+  // 前 8 个参数放 a0 ~ a7, 其余放在当前栈帧底部, 被调函数从它的 sp + 栈帧大小处读取
+  std::vector<std::pair<Location, Location>> moves;
+  for (size_t i = 0; i < inst.ops.size(); ++i) {
+    Location dst = i < 8 ? Location{Location::REG, static_cast<int>(A0 + i)} : Location{Location::STACK, static_cast<int>((i - 8) * 4)};
+    moves.push_back({dst, location_of(inst.ops[i])});
   }
+  emit_parallel_move(moves);
+  emit("call", {module->funcs[inst.callee].name});
+  if (has_location(inst)) emit_move(env.value_loc[id], {Location::REG, A0});
 }
 
-void RiscV::visit_get_elem_ptr(const koopa_raw_get_elem_ptr_t &gep_value, int addr) {
-  if (gep_value.src->kind.tag == KOOPA_RVT_GLOBAL_ALLOC) {
-    output_file << "  la t0, " + std::string(gep_value.src->name + 1) + "\n";
-  } else {
-    int src_addr = env.get_address(gep_value.src);
-    if (src_addr != -1) {
-      if (src_addr < 2048 && src_addr >= -2048) {
-        output_file << "  addi t0, sp, " + std::to_string(src_addr) + "\n";
-      } else {
-        output_file << "  li t3, " + std::to_string(src_addr) + "\n";
-        output_file << "  add t0, sp, t3\n";
-      }
+void RiscV::visit_global_addr(const ir::Inst &inst, int id) {
+  std::string rd = def_register(id, "t0");
+  emit("la", {rd, module->globals[inst.ops[0].id].name});
+  commit(id, rd);
+}
+
+// getelemptr 和 getptr 都是 base + index * stride, 步长在构造 IR 时已经算好
+void RiscV::visit_get_ptr(const ir::Inst &inst, int id) {
+  std::string base = base_register(inst.ops[0], "t0");
+  std::string rd = def_register(id, "t0");
+  const auto &index = inst.ops[1];
+  int shift = inst.size > 0 && (inst.size & (inst.size - 1)) == 0 ? __builtin_ctz(inst.size) : -1;
+  if (index.is_const()) {
+    // 常量下标直接算出偏移
+    long long offset = static_cast<long long>(index.id) * inst.size;
+    if (offset < 2048 && offset >= -2048) {
+      emit("addi", {rd, base, std::to_string(offset)});
     } else {
-      assert(false);
+      emit("li", {"t1", std::to_string(static_cast<int>(offset))});
+      emit("add", {rd, base, "t1"});
     }
-    if (gep_value.src->kind.tag == KOOPA_RVT_GET_ELEM_PTR || gep_value.src->kind.tag == KOOPA_RVT_GET_PTR) {
-      output_file << "  lw t0, 0(t0)\n";
+  } else if (shift >= 0) {
+    std::string offset = use_register(index, "t1");
+    if (shift > 0) {
+      emit("slli", {"t1", offset, std::to_string(shift)});
+      offset = "t1";
     }
+    emit("add", {rd, base, offset});
+  } else {
+    std::string offset = use_register(index, "t1");
+    emit("li", {"t2", std::to_string(inst.size)});
+    emit("mul", {"t1", offset, "t2"});
+    emit("add", {rd, base, "t1"});
   }
-  load_to_register(gep_value.index, "t1");
-  int size = calculate_array_size(gep_value.src->ty->data.pointer.base->data.array.base);
-  output_file << "  li t2, " + std::to_string(size) + "\n";
-  output_file << "  mul t1, t1, t2\n";
-  output_file << "  add t0, t0, t1\n";
-  store_to_stack(addr, "t0");
+  commit(id, rd);
 }
 
-void RiscV::visit_get_ptr(const koopa_raw_get_ptr_t &gp_value, int addr) {
-  int src_addr = env.get_address(gp_value.src);
-  if (src_addr != -1) {
-    if (src_addr < 2048 && src_addr >= -2048) {
-      output_file << "  addi t0, sp, " + std::to_string(src_addr) + "\n";
-    } else {
-      output_file << "  li t3, " + std::to_string(src_addr) + "\n";
-      output_file << "  add t0, sp, t3\n";
-    }
-  } else {
-    assert(false);
-  }
-  output_file << "  lw t0, 0(t0)\n";
-  load_to_register(gp_value.index, "t1");
-  int size = calculate_array_size(gp_value.src->ty->data.pointer.base);
-  output_file << "  li t2, " + std::to_string(size) + "\n";
-  output_file << "  mul t1, t1, t2\n";
-  output_file << "  add t0, t0, t1\n";
-  store_to_stack(addr, "t0");
-}
-
-void RiscV::build(const std::string& ir) {
-  koopa_program_t program;
-  koopa_error_code_t ret = koopa_parse_from_string(ir.data(), &program);
-  assert(ret == KOOPA_EC_SUCCESS);
-  koopa_raw_program_builder_t builder = koopa_new_raw_program_builder();
-  koopa_raw_program_t raw = koopa_build_raw_program(builder, program);
-  koopa_delete_program(program);
-  visit_raw_program(raw);
+void RiscV::build(const ir::Module &module) {
+  this->module = &module;
+  visit_program(module);
   output_file.close();
-  koopa_delete_raw_program_builder(builder);
 }
@@ -4,51 +4,85 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include "koopa.h"
+#include "asm.hh"
+#include "ir.hh"
+#include "regalloc.hh"
 
 class RiscV {
+  // 值所在的位置: 寄存器, 栈上 (相对 sp 的偏移) 或立即数
+  struct Location {
+    enum Kind { REG, STACK, IMM } kind;
+    int val;
+    bool operator==(const Location &other) const { return kind == other.kind && val == other.val; }
+  };
+
   class Environment {
-    std::map<koopa_raw_value_t, int> address_map;
   public:
     bool has_call = false;
     int total_stack_size = 0;
     int current_offset = 0;
-    void initialize(int size, bool call);
-    int get_address(koopa_raw_value_t value);
+    std::vector<int> address;        // alloc 指令在栈帧中的偏移, 其余为 -1
+    std::vector<Location> value_loc; // 按值编号索引
+    std::vector<int> saved_regs;
+    void initialize(int num_values, bool call);
+    // 栈帧顶部依次是 ra (有调用时) 和 callee-saved 寄存器, 第 i 个寄存器的保存位置
+    int saved_reg_offset(size_t i) const { return total_stack_size - (has_call ? 8 : 4) - 4 * static_cast<int>(i); }
   };
 
   Environment env;
   std::ofstream output_file;
+  std::vector<AsmInst> code; // 当前函数的汇编, 函数结束时经过窥孔优化再输出
+  int opt_level;
+  const ir::Module *module = nullptr;
+  const ir::Function *func = nullptr;
+
+  static int max_call_args(const ir::Function &func, bool &call);
+  static bool has_location(const ir::Inst &inst);
+
+  static void signed_magic(int d, int &magic, int &shift);
+  static int fused_compare(const ir::Function &func, int block);
+  static std::vector<std::pair<int, ir::Operand>> phi_moves(const ir::Function &func, int pred, int succ);
+
+  AllocFunc build_alloc_func(const ir::Function &func);
+  Location location_of(const ir::Operand &op);
+  std::string stack_operand(int addr);
+  std::string use_register(const ir::Operand &op, const std::string &scratch);
+  std::string def_register(int value, const std::string &scratch);
+  void commit(int value, const std::string &reg);
+  void emit(const std::string &op, std::vector<std::string> args = {});
+  void emit_label(const std::string &name);
+  void emit_move(const Location &dst, const Location &src);
+  void emit_epilogue();
+  void emit_divide_by_constant(bool rem, const std::string &rs, const std::string &rd, int d);
+  void emit_parallel_move(std::vector<std::pair<Location, Location>> moves);
+  std::string base_register(const ir::Operand &ptr, const std::string &scratch);
+  std::string label(int block) const;
 
-  static int calculate_function_size(koopa_raw_function_t func, bool &call);
-  static int calculate_bb_size(koopa_raw_basic_block_t bb, bool &call, int &max_arg);
-  static int calculate_inst_size(koopa_raw_value_t value);
-  static int calculate_type_size(koopa_raw_type_t ty);
-  static int calculate_array_size(koopa_raw_type_t ty);
-
-  void load_to_register(koopa_raw_value_t value, const std::string& reg);
-  void store_to_stack(int addr, const std::string& reg);
-  void visit_raw_program(const koopa_raw_program_t &raw);
-  void visit_raw_slice(const koopa_raw_slice_t &slice);
-  void visit_raw_function(const koopa_raw_function_t &func);
-  void visit_raw_basic_block(const koopa_raw_basic_block_t &bb);
-  void visit_raw_value(const koopa_raw_value_t &value);
-  void visit_return(const koopa_raw_return_t &return_value);
-  void visit_binary(const koopa_raw_binary_t &binary_value, int addr);
-  void visit_load(const koopa_raw_load_t &load_value, int addr);
-  void visit_store(const koopa_raw_store_t &store_value);
-  void visit_branch(const koopa_raw_branch_t &branch_value);
-  void visit_jump(const koopa_raw_jump_t &jump_value);
-  void visit_call(const koopa_raw_call_t &call_value, int addr);
-  void handle_global_alloc(const koopa_raw_value_t &global_alloc_value);
-  void visit_aggregate(const koopa_raw_aggregate_t &aggregate_value);
-  void visit_get_elem_ptr(const koopa_raw_get_elem_ptr_t &get_elem_ptr_value, int addr);
-  void visit_get_ptr(const koopa_raw_get_ptr_t &get_ptr_value, int addr);
+  void visit_program(const ir::Module &module);
+  void visit_global(const ir::Global &global);
+  void visit_function(const ir::Function &func);
+  void visit_block(int block);
+  void visit_inst(int id);
+  void visit_return(const ir::Inst &inst);
+  void visit_binary(const ir::Inst &inst, int id);
+  bool visit_binary_imm(ir::Op op, const ir::Operand &lhs, int imm, int id);
+  void visit_load(const ir::Inst &inst, int id);
+  void visit_store(const ir::Inst &inst, int id);
+  void visit_fill(const ir::Inst &inst, int id);
+  void visit_branch(const ir::Inst &inst, int id);
+  void visit_compare_branch(const ir::Inst &inst, int id, const ir::Inst &cmp);
+  void visit_jump(const ir::Inst &inst);
+  void visit_call(const ir::Inst &inst, int id);
+  void visit_tail_call(const ir::Inst &inst);
+  void visit_get_ptr(const ir::Inst &inst, int id);
+  void visit_global_addr(const ir::Inst &inst, int id);
 
 public:
-  RiscV(const char *path) {
+  // opt_level >= 2 时使用图着色寄存器分配, 否则使用线性扫描
+  RiscV(const char *path, int level = 1) : opt_level(level) {
     output_file.open(path);
   }
-  void build(const std::string& ir);
+  void build(const ir::Module &module);
 };
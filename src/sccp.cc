@@ -0,0 +1,157 @@
+#include "passes.hh"
+#include <unordered_set>
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+// 格: 未定 (TOP) > 常量 > 不确定 (BOTTOM), 值只会沿格向下移动
+struct Lattice {
+  enum State { TOP, CONST, BOTTOM } state = TOP;
+  int value = 0;
+  bool operator==(const Lattice &other) const { return state == other.state && value == other.value; }
+};
+
+class Solver {
+  ir::Function &func;
+  std::vector<Lattice> lattice;
+  std::vector<char> executable;
+  std::unordered_set<long long> edges; // 已执行的边 from * 块数 + to
+  std::vector<std::pair<int, int>> cfg_work;
+  std::vector<int> ssa_work;
+
+  long long edge_key(int from, int to) const { return static_cast<long long>(from) * func.blocks.size() + to; }
+  bool edge_executable(int from, int to) const { return edges.count(edge_key(from, to)); }
+
+  Lattice get(const Operand &op) const {
+    if (op.is_const()) return {Lattice::CONST, op.id};
+    if (op.is_value()) return lattice[op.id];
+    return {Lattice::BOTTOM, 0};
+  }
+
+  void set(int id, Lattice value) {
+    if (lattice[id] == value) return;
+    lattice[id] = value;
+    ssa_work.push_back(id);
+  }
+
+  void visit_phi(int id) {
+    const auto &inst = func.insts[id];
+    Lattice result;
+    for (size_t i = 0; i < inst.ops.size(); ++i) {
+      if (!edge_executable(inst.targets[i], inst.block)) continue;
+      Lattice in = get(inst.ops[i]);
+      if (in.state == Lattice::TOP) continue;
+      if (in.state == Lattice::BOTTOM || (result.state == Lattice::CONST && result.value != in.value)) {
+        result = {Lattice::BOTTOM, 0};
+        break;
+      }
+      result = in;
+    }
+    set(id, result);
+  }
+
+  void visit_inst(int id) {
+    const auto &inst = func.insts[id];
+    if (inst.op == Op::Phi) {
+      visit_phi(id);
+    } else if (ir::is_binary(inst.op)) {
+      Lattice lhs = get(inst.ops[0]), rhs = get(inst.ops[1]);
+      if (lhs.state == Lattice::TOP || rhs.state == Lattice::TOP) return;
+      int value;
+      if (lhs.state == Lattice::CONST && rhs.state == Lattice::CONST && ir::fold_binary(inst.op, lhs.value, rhs.value, value)) {
+        set(id, {Lattice::CONST, value});
+      } else {
+        set(id, {Lattice::BOTTOM, 0});
+      }
+    } else if (inst.op == Op::Br) {
+      Lattice cond = get(inst.ops[0]);
+      if (cond.state == Lattice::TOP) return;
+      if (cond.state == Lattice::BOTTOM || cond.value) cfg_work.push_back({inst.block, inst.targets[0]});
+      if (cond.state == Lattice::BOTTOM || !cond.value) cfg_work.push_back({inst.block, inst.targets[1]});
+    } else if (inst.op == Op::Jump) {
+      cfg_work.push_back({inst.block, inst.targets[0]});
+    } else if (inst.ty != ir::Type::Unit) {
+      set(id, {Lattice::BOTTOM, 0});
+    }
+  }
+
+public:
+  explicit Solver(ir::Function &func)
+      : func(func), lattice(func.insts.size()), executable(func.blocks.size(), 0) {}
+
+  void solve() {
+    for (int param : func.params) lattice[param] = {Lattice::BOTTOM, 0};
+    executable[0] = 1;
+    for (int id : func.blocks[0].insts) visit_inst(id);
+    while (!cfg_work.empty() || !ssa_work.empty()) {
+      while (!cfg_work.empty()) {
+        auto [from, to] = cfg_work.back();
+        cfg_work.pop_back();
+        if (!edges.insert(edge_key(from, to)).second) continue;
+        if (!executable[to]) {
+          executable[to] = 1;
+          for (int id : func.blocks[to].insts) visit_inst(id);
+        } else {
+          // 新的前驱边只影响 phi
+          for (int id : func.blocks[to].insts) {
+            if (func.insts[id].op != Op::Phi) break;
+            visit_phi(id);
+          }
+        }
+      }
+      while (!ssa_work.empty()) {
+        int v = ssa_work.back();
+        ssa_work.pop_back();
+        for (int user : func.uses[v]) {
+          if (executable[func.insts[user].block]) visit_inst(user);
+        }
+      }
+    }
+  }
+
+  // 用常量替换值, 把条件确定的分支改为跳转, 返回是否有改动
+  bool rewrite() {
+    bool changed = false;
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+      if (!executable[b]) continue;
+      for (int id : std::vector<int>(func.blocks[b].insts)) {
+        if (lattice[id].state != Lattice::CONST || !ir::is_pure(func.insts[id].op)) continue;
+        func.replace_all_uses(id, Operand::constant(lattice[id].value));
+        func.remove_inst(id);
+        changed = true;
+      }
+      int term = func.terminator(b);
+      auto &inst = func.insts[term];
+      if (inst.op != Op::Br) continue;
+      Lattice cond = get(inst.ops[0]);
+      if (cond.state != Lattice::CONST) continue;
+      int taken = inst.targets[cond.value ? 0 : 1], other = inst.targets[cond.value ? 1 : 0];
+      if (other != taken) {
+        for (int id : func.blocks[other].insts) {
+          if (func.insts[id].op != Op::Phi) break;
+          func.remove_incoming(id, b);
+        }
+      }
+      func.set_operand(term, 0, Operand());
+      inst.ops.clear();
+      inst.op = Op::Jump;
+      inst.targets = {taken};
+      changed = true;
+    }
+    if (changed) {
+      func.compute_cfg();
+      func.remove_unreachable();
+    }
+    return changed;
+  }
+};
+
+} // namespace
+
+bool SCCP::run_on_function(ir::Module &, ir::Function &func) {
+  Solver solver(func);
+  solver.solve();
+  return solver.rewrite();
+}
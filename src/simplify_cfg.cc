@@ -0,0 +1,129 @@
+#include "passes.hh"
+#include <algorithm>
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+class Simplifier {
+  ir::Function &func;
+
+  void retarget(int term, int from, int to) {
+    for (auto &t : func.insts[term].targets) {
+      if (t == from) t = to;
+    }
+  }
+
+  // 只有一个来源的 phi 直接用该来源代替
+  bool remove_single_phis(int b) {
+    bool changed = false;
+    for (int id : std::vector<int>(func.blocks[b].insts)) {
+      auto &phi = func.insts[id];
+      if (phi.op != Op::Phi) break;
+      if (phi.ops.size() != 1) continue;
+      func.replace_all_uses(id, phi.ops[0]);
+      func.remove_inst(id);
+      changed = true;
+    }
+    return changed;
+  }
+
+  // br 的两个目标相同时改为 jump
+  bool fold_branch(int b) {
+    int term = func.terminator(b);
+    auto &inst = func.insts[term];
+    if (inst.op != Op::Br || inst.targets[0] != inst.targets[1]) return false;
+    func.set_operand(term, 0, Operand());
+    inst.ops.clear();
+    inst.op = Op::Jump;
+    inst.targets.pop_back();
+    return true;
+  }
+
+  // b 以 jump 结尾且是后继唯一的前驱时, 把后继并入 b
+  bool merge_successor(int b) {
+    int term = func.terminator(b);
+    if (func.insts[term].op != Op::Jump) return false;
+    int s = func.insts[term].targets[0];
+    if (s == b || s == 0 || func.blocks[s].preds.size() != 1) return false;
+    remove_single_phis(s);
+    func.remove_inst(term);
+    for (int id : func.blocks[s].insts) {
+      func.insts[id].block = b;
+      func.blocks[b].insts.push_back(id);
+    }
+    func.blocks[s].insts.clear();
+    // 后继的后继中的 phi 现在来自 b
+    for (int t : func.blocks[s].succs) {
+      for (int id : func.blocks[t].insts) {
+        if (func.insts[id].op != Op::Phi) break;
+        for (auto &pred : func.insts[id].targets) {
+          if (pred == s) pred = b;
+        }
+      }
+    }
+    func.blocks[s].dead = true;
+    return true;
+  }
+
+  // 只含 jump 的块 b: 让它的前驱直接跳到目标
+  bool skip_empty_block(int b) {
+    const auto &insts = func.blocks[b].insts;
+    if (b == 0 || insts.size() != 1 || func.insts[insts[0]].op != Op::Jump) return false;
+    int target = func.insts[insts[0]].targets[0];
+    if (target == b) return false;
+    const auto &target_preds = func.blocks[target].preds;
+    bool has_phi = func.insts[func.blocks[target].insts.front()].op == Op::Phi;
+    std::vector<int> moved;
+    for (int p : func.blocks[b].preds) {
+      // 前驱已经直接通向目标时, 目标中的 phi 无法区分两条边;
+      // 从分支通向含 phi 的块会形成关键边, 之后还要再拆开, 保留空块即可
+      if (has_phi && (func.insts[func.terminator(p)].op == Op::Br ||
+                      std::find(target_preds.begin(), target_preds.end(), p) != target_preds.end())) continue;
+      retarget(func.terminator(p), b, target);
+      moved.push_back(p);
+    }
+    if (moved.empty()) return false;
+    for (int id : func.blocks[target].insts) {
+      if (func.insts[id].op != Op::Phi) break;
+      Operand value;
+      for (size_t i = 0; i < func.insts[id].targets.size(); ++i) {
+        if (func.insts[id].targets[i] == b) value = func.insts[id].ops[i];
+      }
+      for (int p : moved) func.add_incoming(id, value, p);
+      if (moved.size() == func.blocks[b].preds.size()) func.remove_incoming(id, b);
+    }
+    return true;
+  }
+
+public:
+  explicit Simplifier(ir::Function &func) : func(func) {}
+
+  bool run() {
+    bool changed = func.remove_unreachable();
+    bool progress = true;
+    while (progress) {
+      progress = false;
+      for (size_t b = 0; b < func.blocks.size(); ++b) {
+        if (func.blocks[b].dead) continue;
+        bool local = remove_single_phis(b);
+        if (fold_branch(b) || merge_successor(b) || skip_empty_block(b)) {
+          func.compute_cfg();
+          local = true;
+        }
+        progress |= local;
+      }
+      if (func.remove_unreachable()) progress = true;
+      changed |= progress;
+    }
+    func.compact();
+    return changed;
+  }
+};
+
+} // namespace
+
+bool SimplifyCFG::run_on_function(ir::Module &, ir::Function &func) {
+  return Simplifier(func).run();
+}
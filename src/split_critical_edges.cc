@@ -0,0 +1,33 @@
+#include "passes.hh"
+
+using ir::Op;
+
+bool SplitCriticalEdges::run_on_function(ir::Module &, ir::Function &func) {
+  bool changed = false;
+  size_t n = func.blocks.size();
+  for (size_t b = 0; b < n; ++b) {
+    const auto &insts = func.blocks[b].insts;
+    if (insts.empty() || func.insts[insts.front()].op != Op::Phi) continue;
+    for (int pred : std::vector<int>(func.blocks[b].preds)) {
+      if (func.insts[func.terminator(pred)].op != Op::Br) continue;
+      // pred -> b 是关键边, 插入只含 jump 的新块
+      int mid = func.add_block(func.new_label("split"));
+      ir::Inst jump(Op::Jump);
+      jump.targets = {static_cast<int>(b)};
+      func.append(mid, jump);
+      for (auto &t : func.insts[func.terminator(pred)].targets) {
+        if (t == static_cast<int>(b)) t = mid;
+      }
+      for (int id : func.blocks[b].insts) {
+        auto &phi = func.insts[id];
+        if (phi.op != Op::Phi) break;
+        for (auto &t : phi.targets) {
+          if (t == pred) t = mid;
+        }
+      }
+      changed = true;
+    }
+  }
+  if (changed) func.compute_cfg();
+  return changed;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * 编译线程的栈预算
+ * - 嵌套的单目运算, 函数调用, 下标, 语句块和 else-if 链在 AST 和后端的遍历中仍是递归的, 编译在栈足够大的线程中进行
+ * - 分析栈的每一项最多对应一层嵌套, 实测每层最多用掉约 1.5 KiB 的栈 (-O0 的调试构建, 嵌套的语句块每层占一项)
+ *   按每项 2 KiB 限制分析栈的深度, 更深的输入报语法错误而不是在遍历时栈溢出
+ */
+constexpr size_t COMPILE_STACK_SIZE = size_t(1) << 30;
+constexpr size_t STACK_BYTES_PER_PARSE_DEPTH = 2048;
+
+// 分析栈的深度上限 (YYMAXDEPTH), 按实际用于编译的栈的大小设置
+inline size_t max_parse_depth = COMPILE_STACK_SIZE / STACK_BYTES_PER_PARSE_DEPTH;
@@ -0,0 +1,191 @@
+#include "passes.hh"
+#include <algorithm>
+#include <unordered_map>
+#include "loops.hh"
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+// 归纳变量: 每次迭代 phi = phi + step, next 是计算下一次迭代值的指令
+struct InductionVar {
+  int phi;
+  Operand init;
+  int step;
+  int next;
+};
+
+int log2_exact(int x) {
+  if (x <= 0 || (x & (x - 1))) return -1;
+  return __builtin_ctz(x);
+}
+
+class Reducer {
+  ir::Function &func;
+  DominatorTree dom;
+  LoopInfo info;
+  bool changed = false;
+
+  bool invariant(int loop, const Operand &op) const {
+    return !op.is_value() || func.insts[op.id].block < 0 || !info.contains(loop, func.insts[op.id].block);
+  }
+
+  // 已有的 preheader: 唯一的循环外前驱且只跳到 header
+  int preheader(int loop) const {
+    int found = -1;
+    for (int p : func.blocks[info.loops[loop].header].preds) {
+      if (info.contains(loop, p)) continue;
+      if (found >= 0) return -1;
+      found = p;
+    }
+    if (found < 0 || func.insts[func.terminator(found)].op != Op::Jump) return -1;
+    return found;
+  }
+
+  // header 中形如 i = phi [init, preheader], [i +/- c, latch] 的整数归纳变量
+  std::unordered_map<int, InductionVar> basic_ivs(int loop, int ph, int latch) const {
+    std::unordered_map<int, InductionVar> ivs;
+    for (int id : func.blocks[info.loops[loop].header].insts) {
+      const auto &phi = func.insts[id];
+      if (phi.op != Op::Phi) break;
+      if (phi.ty != ir::Type::I32 || phi.ops.size() != 2) continue;
+      int from_ph = phi.targets[0] == ph ? 0 : 1;
+      if (phi.targets[from_ph] != ph || phi.targets[1 - from_ph] != latch) continue;
+      const auto &next = phi.ops[1 - from_ph];
+      if (!next.is_value()) continue;
+      const auto &inc = func.insts[next.id];
+      int step;
+      if (inc.op == Op::Add && inc.ops[0] == Operand::value(id) && inc.ops[1].is_const()) {
+        step = inc.ops[1].id;
+      } else if (inc.op == Op::Add && inc.ops[1] == Operand::value(id) && inc.ops[0].is_const()) {
+        step = inc.ops[0].id;
+      } else if (inc.op == Op::Sub && inc.ops[0] == Operand::value(id) && inc.ops[1].is_const()) {
+        step = -inc.ops[1].id;
+      } else {
+        continue;
+      }
+      ivs[id] = {id, phi.ops[from_ph], step, next.id};
+    }
+    return ivs;
+  }
+
+  int insert_after(int anchor, const ir::Inst &inst) {
+    int b = func.insts[anchor].block;
+    const auto &list = func.blocks[b].insts;
+    int pos = std::find(list.begin(), list.end(), anchor) - list.begin();
+    return func.insert(b, pos + 1, inst);
+  }
+
+  /*
+   * 循环中的 base + index * stride, base 不变且 index 为 i + k, 或 base 为指针归纳变量且 index 不变,
+   * 改为新的指针归纳变量: preheader 中算出初值, 每次迭代在 i 递增处加上 step * stride
+   */
+  void reduce_loop(int loop) {
+    const auto &lp = info.loops[loop];
+    int ph = preheader(loop);
+    if (ph < 0 || lp.latches.size() != 1) return;
+    int latch = lp.latches[0];
+    auto ivs = basic_ivs(loop, ph, latch);
+    if (ivs.empty()) return;
+    std::unordered_map<int, InductionVar> ptr_ivs;
+    // 本函数新建的指令 (指针的递增) 不再处理
+    int original = func.insts.size();
+
+    for (int b : dom.rpo) {
+      if (!info.contains(loop, b)) continue;
+      for (int id : std::vector<int>(func.blocks[b].insts)) {
+        if (id >= original) continue;
+        const ir::Inst inst = func.insts[id]; // 插入指令会使引用失效
+        if (inst.op != Op::GetElemPtr && inst.op != Op::GetPtr) continue;
+        Operand base = inst.ops[0], index = inst.ops[1];
+        int stride = inst.size;
+        Operand init_base, init_index;
+        const InductionVar *from = nullptr;
+        int step = 0;
+        if (invariant(loop, base) && index.is_value()) {
+          int k = 0;
+          auto it = ivs.find(index.id);
+          const auto &def = func.insts[index.id];
+          if (it == ivs.end() && (def.op == Op::Add || def.op == Op::Sub) && def.ops[0].is_value() && def.ops[1].is_const()) {
+            it = ivs.find(def.ops[0].id);
+            k = def.op == Op::Add ? def.ops[1].id : -def.ops[1].id;
+          }
+          if (it == ivs.end()) continue;
+          from = &it->second;
+          init_base = base;
+          init_index = from->init;
+          if (k != 0) {
+            int folded;
+            if (init_index.is_const() && ir::fold_binary(Op::Add, init_index.id, k, folded)) {
+              init_index = Operand::constant(folded);
+            } else {
+              ir::Inst add(Op::Add, ir::Type::I32);
+              add.ops = {init_index, Operand::constant(k)};
+              init_index = Operand::value(func.insert_before_terminator(ph, add));
+            }
+          }
+          step = from->step * stride;
+        } else if (base.is_value() && ptr_ivs.count(base.id) && invariant(loop, index)) {
+          from = &ptr_ivs[base.id];
+          init_base = from->init;
+          init_index = index;
+          step = from->step;
+        } else {
+          continue;
+        }
+
+        ir::Inst init(inst.op, ir::Type::Ptr);
+        init.ops = {init_base, init_index};
+        init.size = stride;
+        int init_ptr = func.insert_before_terminator(ph, init);
+        int phi = func.insert(lp.header, 0, ir::Inst(Op::Phi, ir::Type::Ptr));
+        ir::Inst inc(Op::GetPtr, ir::Type::Ptr);
+        inc.ops = {Operand::value(phi), Operand::constant(step)};
+        inc.size = 1;
+        int next = insert_after(from->next, inc);
+        func.add_incoming(phi, Operand::value(init_ptr), ph);
+        func.add_incoming(phi, Operand::value(next), latch);
+        func.replace_all_uses(id, Operand::value(phi));
+        func.remove_inst(id);
+        ptr_ivs[phi] = {phi, Operand::value(init_ptr), step, next};
+        changed = true;
+      }
+    }
+  }
+
+  // 乘以 2 的幂改为左移
+  void reduce_multiplies() {
+    for (auto &block : func.blocks) {
+      for (int id : block.insts) {
+        auto &inst = func.insts[id];
+        if (inst.op != Op::Mul) continue;
+        if (inst.ops[0].is_const() && !inst.ops[1].is_const()) {
+          Operand lhs = inst.ops[0], rhs = inst.ops[1];
+          func.set_operand(id, 0, rhs);
+          func.set_operand(id, 1, lhs);
+        }
+        int shift = inst.ops[1].is_const() ? log2_exact(inst.ops[1].id) : -1;
+        if (shift < 0) continue;
+        inst.op = Op::Shl;
+        inst.ops[1] = Operand::constant(shift);
+        changed = true;
+      }
+    }
+  }
+
+public:
+  explicit Reducer(ir::Function &func) : func(func), dom(func), info(func, dom) {}
+
+  bool run() {
+    for (size_t l = 0; l < info.loops.size(); ++l) reduce_loop(l);
+    reduce_multiplies();
+    return changed;
+  }
+};
+
+} // namespace
+
+bool StrengthReduce::run_on_function(ir::Module &, ir::Function &func) {
+  return Reducer(func).run();
+}
@@ -10,165 +10,168 @@
 #include <iostream>
 #include <memory>
 #include <string>
-#include <stack>
 #include <string.h>
 #include "/root/compiler/sysy-make-template/ast/ast.hh"
-// 声明 lexer 函数和错误处理函数
-int yylex();
-void yyerror(std::unique_ptr<BaseAST> &ast, const char *s);
+#include "lexer.hh"
+#include "stack_budget.hh"
+// 声明错误处理函数
+void yyerror(BaseAST *&ast, const char *s);
 
-using namespace std;
+// 分析栈按需倍增, 默认上限 10000 层; 上限由编译所用的栈的大小得出, 超过时报 memory exhausted, yyparse 返回 2
+#define YYMAXDEPTH static_cast<ptrdiff_t>(max_parse_depth)
 
-/* enum class ListType { CONSTDEF, DECL, STMT }; */
-stack<List> global_stack;
+using namespace std;
 
 %}
 
 // 定义 parser 函数和错误处理函数的附加参数
-// 我们需要返回一个字符串作为 AST, 所以我们把附加参数定义成字符串的智能指针
-// 解析完成后, 我们要手动修改这个参数, 把它设置成解析得到的字符串
-%parse-param { std::unique_ptr<BaseAST> &ast }
+// 我们需要返回一个 AST, 所以我们把附加参数定义成 AST 指针的引用
+// 解析完成后, 我们要手动修改这个参数, 把它设置成解析得到的 AST, 节点都在 arena 中
+%parse-param { BaseAST *&ast }
 
 // yylval 的定义, 我们把它定义成了一个联合体 (union)
-// 因为 token 的值有的是字符串指针, 有的是整数，有的是ast指针
+// 因为 token 的值有的是运算符, 有的是整数，有的是ast指针
+// 各种列表直接在 List 中左递归地追加, 归约到使用它的产生式时再交给对应的 AST 节点
 
 %union {
-  std::string *str_val;
+  ExpOp op_val;
   int int_val;
+  int sym_val;
   BaseAST *ast_val;
+  FuncDefAST *func_val;
+  List *list_val;
 }
 
 // lexer 返回的所有 token 种类的声明
-// 注意 IDENT 和 INT_CONST 会返回 token 的值, 分别对应 str_val 和 int_val
+// 注意 IDENT 和 INT_CONST 会返回 token 的值, 分别对应 sym_val (驻留后的 Symbol id) 和 int_val
+// 运算符 token 的值是 ExpOp
 %token INT VOID RETURN CONST IF ELSE WHILE BREAK CONTINUE
-%token <str_val> IDENT UNARYOP ADDOP MULOP RELOP EQOP LOROP LANDOP
+%token <sym_val> IDENT
+%token <op_val> UNARYOP ADDOP MULOP RELOP EQOP LOROP LANDOP
 %token <int_val> INT_CONST
 
 // 非终结符的类型定义
-%type <ast_val> FuncDef FuncType Block Stmt BlockItem BlockItemList FuncFParams FuncFParam FuncRPParams
-%type <ast_val> Exp UnaryExp PrimaryExp MulExp AddExp RelExp EqExp LAndExp LOrExp LVal ConstExp ExpList ArrayExpList
-%type <ast_val> Decl ConstDecl BType ConstDef ConstDefList ConstInitVal ConstExpList  ConstInitValList
-%type <ast_val> VarDecl VarDef VarDefList InitVal InitValList
-%type <ast_val> CompUnit
+%type <ast_val> FuncDef Block Stmt FuncFParam
+%type <ast_val> Exp UnaryExp PrimaryExp MulExp AddExp RelExp EqExp LAndExp LOrExp LVal ConstExp
+%type <ast_val> Decl ConstDecl BType ConstDef ConstInitVal
+%type <ast_val> VarDecl VarDef InitVal
+%type <func_val> FuncHead
+%type <list_val> CompUnit FuncFParams FuncRParams BlockItemList ConstDefList VarDefList
+%type <list_val> ConstInitValList InitValList ConstDims ExpDims
 %type <int_val> Number
 
-%glr-parser
-
+// 文法是无冲突的 LALR(1) 文法, 唯一的移进/归约冲突 (悬空的 else) 由优先级解决
+%expect 0
 
-
-%nonassoc LOWER_THAN_ELSE
-%nonassoc ELSE
+%precedence LOWER_THAN_ELSE
+%precedence ELSE
 %%
 
-// 优化后的 CompUnit, 使用ast作为暂时存储右侧的CompUnit的缓存
-  CompUnit
+// 编译单元中的函数定义和全局声明按顺序放在同一个 List 中
+Program
+  : CompUnit {
+    auto items = $1;
+    ast = new CompUnitAST(*items);
+  }
+  ;
+
+CompUnit
   : FuncDef {
-    auto comp_unit = make_unique<CompUnitAST>();
-    comp_unit->type = CompUnitAST::Type::FUNCDEF;
-    comp_unit->option = CompUnitAST::Option::C0;
-    comp_unit->func_def_or_decl = unique_ptr<BaseAST>($1);
-    ast = move(comp_unit);
+    $$ = new List();
+    $$->emplace_back(ListType::FUNCDEF, $1);
+  }
+  | Decl {
+    $$ = new List();
+    $$->emplace_back(ListType::DECL, $1);
   }
   | CompUnit FuncDef {
-    auto comp_unit = make_unique<CompUnitAST>();
-    comp_unit->type = CompUnitAST::Type::FUNCDEF;
-    comp_unit->option = CompUnitAST::Option::C1;
-    comp_unit->func_def_or_decl = unique_ptr<BaseAST>($2);
-    comp_unit->other_comp_unit = move(ast);
-    ast = move(comp_unit);
+    $$ = $1;
+    $$->emplace_back(ListType::FUNCDEF, $2);
   }
   | CompUnit Decl {
-    auto comp_unit = make_unique<CompUnitAST>();
-    comp_unit->type = CompUnitAST::Type::DECL;
-    comp_unit->option = CompUnitAST::Option::C1;
-    comp_unit->func_def_or_decl = unique_ptr<BaseAST>($2);
-    comp_unit->other_comp_unit = move(ast);
-    ast = move(comp_unit);
-  }
-  | Decl {
-    auto comp_unit = make_unique<CompUnitAST>();
-    comp_unit->type = CompUnitAST::Type::DECL;
-    comp_unit->option = CompUnitAST::Option::C0;
-    comp_unit->func_def_or_decl = unique_ptr<BaseAST>($1);
-    ast = move(comp_unit);
-  }
-  | error {
-    yyerror(ast, "CompUnit");
+    $$ = $1;
+    $$->emplace_back(ListType::DECL, $2);
   }
-  ;  
+  ;
 
 FuncDef
-  : FuncType IDENT '(' ')' Block {
-    auto ast = new FuncDefAST();
-    ast->func_type = unique_ptr<BaseAST>($1);
-    ast->ident = *unique_ptr<string>($2);
-    ast->block = unique_ptr<BaseAST>($5);
+  : FuncHead ')' Block {
+    auto ast = $1;
+    ast->block = $3;
     ast->option = FuncDefAST::Option::F0;
     $$ = ast;
   }
-  | FuncType IDENT '(' {
-    global_stack.push(List());
-  } FuncFParams ')' Block {
+  | FuncHead FuncFParams ')' Block {
+    auto ast = $1;
+    auto func_f_params = $2;
+    ast->func_fparams = new FuncFParamsAST(*func_f_params);
+    ast->block = $4;
+    ast->option = FuncDefAST::Option::F1;
+    $$ = ast;
+  }
+  ;
 
+// int 函数的返回值类型与变量声明共用 BType, 这样读到 '(' 时才需要区分函数定义和变量声明
+FuncHead
+  : BType IDENT '(' {
+    auto btype = $1;
+    auto func_type = new FuncTypeAST();
+    func_type->type = "int";
     auto ast = new FuncDefAST();
-    ast->func_type = unique_ptr<BaseAST>($1);
-    ast->ident = *unique_ptr<string>($2);
-    auto _func_f_params = new FuncFParamsAST(global_stack.top());
-    global_stack.pop();
-    ast->func_fparams = unique_ptr<BaseAST>(_func_f_params);
-    ast->block = unique_ptr<BaseAST>($7);
-    ast->option = FuncDefAST::Option::F1;
+    ast->func_type = func_type;
+    ast->ident = Symbol($2);
+    $$ = ast;
+  }
+  | VOID IDENT '(' {
+    auto func_type = new FuncTypeAST();
+    func_type->type = "void";
+    auto ast = new FuncDefAST();
+    ast->func_type = func_type;
+    ast->ident = Symbol($2);
     $$ = ast;
   }
   ;
 
 FuncFParams
   : FuncFParam {
-    auto func_f_param = unique_ptr<BaseAST>($1);
-    global_stack.top().emplace_back(ListType::FUNCFPARAM, std::move(func_f_param));
+    $$ = new List();
+    $$->emplace_back(ListType::FUNCFPARAM, $1);
   }
   | FuncFParams ',' FuncFParam {
-    auto func_f_param = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::FUNCFPARAM, std::move(func_f_param));
+    $$ = $1;
+    $$->emplace_back(ListType::FUNCFPARAM, $3);
   }
   ;
 
-
 FuncFParam
   : BType IDENT {
-    auto btype = unique_ptr<BaseAST>($1);
-    auto ident = *unique_ptr<string>($2);
+    auto btype = $1;
+    auto ident = Symbol($2);
     auto const_exp_list = List();
     $$ = new FuncFParamAST(FuncFParamAST::Option::C0, ident, const_exp_list, btype);
   }
   | BType IDENT '[' ']' {
-    global_stack.push(List());
-  } ConstExpList {
-    auto btype = unique_ptr<BaseAST>($1);
-    auto ident = *unique_ptr<string>($2);
-    $$ = new FuncFParamAST(FuncFParamAST::Option::C1, ident, global_stack.top(), btype);
-    global_stack.pop();
-  } 
-  ;
-
-FuncRPParams
-  : {
-    global_stack.push(List());
-  } ExpList {
-    auto ast = new FuncRParamsAST(global_stack.top());
-    global_stack.pop();
-    $$ = ast;
+    auto btype = $1;
+    auto ident = Symbol($2);
+    auto const_exp_list = List();
+    $$ = new FuncFParamAST(FuncFParamAST::Option::C1, ident, const_exp_list, btype);
+  }
+  | BType IDENT '[' ']' ConstDims {
+    auto btype = $1;
+    auto ident = Symbol($2);
+    auto const_exp_list = $5;
+    $$ = new FuncFParamAST(FuncFParamAST::Option::C1, ident, *const_exp_list, btype);
   }
   ;
 
-ExpList
-  : ExpList ',' Exp {
-    auto exp = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::EXP, std::move(exp));
+FuncRParams
+  : Exp {
+    $$ = new List();
+    $$->emplace_back(ListType::EXP, $1);
   }
-  | Exp {
-    auto exp = unique_ptr<BaseAST>($1);
-    global_stack.top().emplace_back(ListType::EXP, std::move(exp));
+  | FuncRParams ',' Exp {
+    $$ = $1;
+    $$->emplace_back(ListType::EXP, $3);
   }
   ;
 // 同上, 不再解释
@@ -177,19 +180,6 @@ BType
     $$ = new BTypeAST("int");
   }
   ;
-
-FuncType
-  : INT {
-    auto ast = new FuncTypeAST();
-    ast->type = "int";
-    $$ = ast;
-  }
-  | VOID {
-    auto ast = new FuncTypeAST();
-    ast->type = "void";
-    $$ = ast;
-  }
-  ;
 /* 
 Decl          ::= ConstDecl;
 ConstDecl     ::= "const" BType ConstDefList  ";";
@@ -208,35 +198,32 @@ PrimaryExp    ::= "(" Exp ")" | LVal | Number;
 ConstExp      ::= Exp;
  */
 Block
-  : '{' {
-    global_stack.push(List());
-  } BlockItemList '}' {
-    $$ = new BlockAST(global_stack.top());
-    global_stack.pop();
+  : '{' BlockItemList '}' {
+    auto block_item_list = $2;
+    $$ = new BlockAST(*block_item_list);
   }
   | '{' '}' {
     $$ = new BlockAST();
   }
   ;
 
+// 块中的声明和语句直接放进 List, 用 ListType 区分
 BlockItemList
-  :
-  BlockItemList BlockItem 
-  | BlockItem
-  ;
-
-BlockItem
   : Decl {
-    auto decl = unique_ptr<BaseAST>($1);
-    auto ast = new BlockItemAST(decl, BlockItemAST::Type::DECL);
-    $$ = ast;
-    global_stack.top().emplace_back(ListType::BLOCKITEM, std::move(ast));
+    $$ = new List();
+    $$->emplace_back(ListType::DECL, $1);
   }
   | Stmt {
-    auto stmt = unique_ptr<BaseAST>($1);
-    auto ast = new BlockItemAST(stmt, BlockItemAST::Type::STMT);
-    $$ = ast;
-    global_stack.top().emplace_back(ListType::BLOCKITEM, std::move(ast));
+    $$ = new List();
+    $$->emplace_back(ListType::STMT, $1);
+  }
+  | BlockItemList Decl {
+    $$ = $1;
+    $$->emplace_back(ListType::DECL, $2);
+  }
+  | BlockItemList Stmt {
+    $$ = $1;
+    $$->emplace_back(ListType::STMT, $2);
   }
   ;
 
@@ -245,7 +232,7 @@ Stmt
     auto ast = new StmtAST();
     ast->type = StmtAST::Type::RETURN;
     ast->option = StmtAST::Option::EXP1;
-    ast->exp = unique_ptr<BaseAST>($2);
+    ast->exp = $2;
     $$ = ast;
   }
   | RETURN ';' {
@@ -256,21 +243,21 @@ Stmt
   }
 
   | LVal '=' Exp ';' {
-    auto lval = unique_ptr<BaseAST>($1);
-    auto exp = unique_ptr<BaseAST>($3);
+    auto lval = $1;
+    auto exp = $3;
     $$ = new StmtAST(lval, exp);
   }
   | Block {
     auto ast = new StmtAST();
     ast->type = StmtAST::Type::BLOCK;
-    ast->block = unique_ptr<BaseAST>($1);
+    ast->block = $1;
     $$ = ast;
   }
   | Exp ';' {
     auto ast = new StmtAST();
     ast->type = StmtAST::Type::EXP;
     ast->option = StmtAST::Option::EXP1;
-    ast->exp = unique_ptr<BaseAST>($1);
+    ast->exp = $1;
     $$ = ast;
   }
   | ';' {
@@ -282,23 +269,23 @@ Stmt
   | IF '(' Exp ')' Stmt %prec LOWER_THAN_ELSE{
     auto ast = new StmtAST();
     ast->type = StmtAST::Type::IF;
-    ast->exp = unique_ptr<BaseAST>($3);
-    ast->if_stmt = unique_ptr<BaseAST>($5);
+    ast->exp = $3;
+    ast->if_stmt = $5;
     $$ = ast;
   }
   | IF '(' Exp ')' Stmt ELSE Stmt {
     auto ast = new StmtAST();
     ast->type = StmtAST::Type::IFELSE;
-    ast->exp = unique_ptr<BaseAST>($3);
-    ast->if_stmt = unique_ptr<BaseAST>($5);
-    ast->else_stmt = unique_ptr<BaseAST>($7);
+    ast->exp = $3;
+    ast->if_stmt = $5;
+    ast->else_stmt = $7;
     $$ = ast;
   }
   | WHILE '(' Exp ')' Stmt {
     auto ast = new StmtAST();
     ast->type = StmtAST::Type::WHILE;
-    ast->exp = unique_ptr<BaseAST>($3);
-    ast->if_stmt = unique_ptr<BaseAST>($5);
+    ast->exp = $3;
+    ast->if_stmt = $5;
     $$ = ast;
   }
   | BREAK ';' {
@@ -319,326 +306,313 @@ Number
   }
   ;
 
+// 只有一个子表达式的产生式直接把子节点向上传, 不生成包装节点
 Exp
   : LOrExp {
-    auto ast = new ExpAST();
-    ast->lor_exp = unique_ptr<BaseAST>($1);
-    $$ = ast;
+    $$ = $1;
   }
   ;
 
 UnaryExp
   : PrimaryExp {
-    auto primary_exp = unique_ptr<BaseAST>($1);
-    $$ = new UnaryExpAST(primary_exp);
+    $$ = $1;
   }
   | UNARYOP UnaryExp {
-    auto op = unique_ptr<string>($1);
-    auto unary_exp = unique_ptr<BaseAST>($2);
-    $$ = new UnaryExpAST(*op, unary_exp);
+    auto unary_exp = $2;
+    $$ = new UnaryExpAST($1, unary_exp);
   }
   | ADDOP UnaryExp {
-    auto op = unique_ptr<string>($1);
-    auto unary_exp = unique_ptr<BaseAST>($2);
-    $$ = new UnaryExpAST(*op, unary_exp);
+    // 一元的 "+" 不改变值
+    if ($1 == ExpOp::ADD) {
+      $$ = $2;
+    } else {
+      auto unary_exp = $2;
+      $$ = new UnaryExpAST($1, unary_exp);
+    }
   }
   | IDENT '(' ')' {
-    auto ast = new UnaryExpAST();
-    ast->type = UnaryExpAST::Type::IDENT;
-    ast->option = UnaryExpAST::Option::F0;
-    ast->ident = *unique_ptr<string>($1);
-    $$ = ast;
+    $$ = new CallExpAST(Symbol($1));
   }
-  | IDENT '(' FuncRPParams ')' {
-    auto ast = new UnaryExpAST();
-    ast->type = UnaryExpAST::Type::IDENT;
-    ast->option = UnaryExpAST::Option::F1;
-    ast->ident = *unique_ptr<string>($1);
-    ast->func_r_params = unique_ptr<BaseAST>($3);
+  | IDENT '(' FuncRParams ')' {
+    auto ast = new CallExpAST(Symbol($1));
+    auto exp_list = $3;
+    ast->func_r_params = new FuncRParamsAST(*exp_list);
     $$ = ast;
   }
   ;
 
 PrimaryExp
   : '(' Exp ')' {
-    auto ast = new PrimaryExpAST();
-    ast->type = PrimaryExpAST::Type::EXP;
-    ast->exp_or_lval = unique_ptr<BaseAST>($2);
-    $$ = ast;
+    $$ = $2;
   }
   | Number {
-    $$ = new PrimaryExpAST($1);
+    $$ = new NumberAST($1);
   }
   | LVal {
-    auto ast = new PrimaryExpAST();
-    ast->type = PrimaryExpAST::Type::LVAL;
-    ast->exp_or_lval = unique_ptr<BaseAST>($1);
-    $$ = ast;
+    // 作为右值使用, 由 LValAST 自己决定是否需要 load
+    static_cast<LValAST *>($1)->load = true;
+    $$ = $1;
   }
   ;
 
 MulExp
   : UnaryExp {
-    auto unary_exp = unique_ptr<BaseAST>($1);
-    $$ = new MulExpAST(unary_exp);
+    $$ = $1;
   }
   | MulExp MULOP UnaryExp {
-    auto mul_exp = unique_ptr<BaseAST>($1);
-    auto op = unique_ptr<string>($2);
-    auto unary_exp = unique_ptr<BaseAST>($3);
-    $$ = new MulExpAST(mul_exp, *op, unary_exp);
+    auto lhs = $1;
+    auto rhs = $3;
+    $$ = new BinaryExpAST(lhs, $2, rhs);
   }
   ;
 
 AddExp
   : MulExp {
-    auto mul_exp = unique_ptr<BaseAST>($1);
-    $$ = new AddExpAST(mul_exp);
+    $$ = $1;
   }
   | AddExp ADDOP MulExp {
-    auto add_exp = unique_ptr<BaseAST>($1);
-    auto op = unique_ptr<string>($2);
-    auto mul_exp = unique_ptr<BaseAST>($3);
-    $$ = new AddExpAST(add_exp, *op, mul_exp);
+    auto lhs = $1;
+    auto rhs = $3;
+    $$ = new BinaryExpAST(lhs, $2, rhs);
   }
   ;
 
 RelExp
   : AddExp {
-    auto add_exp = unique_ptr<BaseAST>($1);
-    $$ = new RelExpAST(add_exp);
+    $$ = $1;
   }
   | RelExp RELOP AddExp {
-    auto rel_exp = unique_ptr<BaseAST>($1);
-    auto op = unique_ptr<string>($2);
-    auto add_exp = unique_ptr<BaseAST>($3);
-    $$ = new RelExpAST(rel_exp, *op, add_exp);
+    auto lhs = $1;
+    auto rhs = $3;
+    $$ = new BinaryExpAST(lhs, $2, rhs);
   }
   ;
 
 EqExp
   : RelExp {
-    auto rel_exp = unique_ptr<BaseAST>($1);
-    $$ = new EqExpAST(rel_exp);
+    $$ = $1;
   }
   | EqExp EQOP RelExp {
-    auto eq_exp = unique_ptr<BaseAST>($1);
-    auto op = unique_ptr<string>($2);
-    auto rel_exp = unique_ptr<BaseAST>($3);
-    $$ = new EqExpAST(eq_exp, *op, rel_exp);
+    auto lhs = $1;
+    auto rhs = $3;
+    $$ = new BinaryExpAST(lhs, $2, rhs);
   }
   ;
 
 LAndExp
   : EqExp {
-    auto eq_exp = unique_ptr<BaseAST>($1);
-    $$ = new LAndExpAST(eq_exp);
+    $$ = $1;
   }
   | LAndExp LANDOP EqExp {
-    auto land_exp = unique_ptr<BaseAST>($1);
-    auto op = unique_ptr<string>($2);
-    auto eq_exp = unique_ptr<BaseAST>($3);
-    $$ = new LAndExpAST(land_exp, *op, eq_exp);
+    auto lhs = $1;
+    auto rhs = $3;
+    $$ = new BinaryExpAST(lhs, $2, rhs);
   }
   ;
 
 LOrExp
   : LAndExp {
-    auto land_exp = unique_ptr<BaseAST>($1);
-    $$ = new LOrExpAST(land_exp);
+    $$ = $1;
   }
   | LOrExp LOROP LAndExp {
-    auto lor_exp = unique_ptr<BaseAST>($1);
-    auto op = unique_ptr<string>($2);
-    auto land_exp = unique_ptr<BaseAST>($3);
-    $$ = new LOrExpAST(lor_exp, *op, land_exp);
+    auto lhs = $1;
+    auto rhs = $3;
+    $$ = new BinaryExpAST(lhs, $2, rhs);
   }
   ;
 
 Decl
   : ConstDecl {
-    auto const_decl = unique_ptr<BaseAST>($1);
+    auto const_decl = $1;
     $$ = new DeclAST(const_decl, DeclAST::Type::CONST);
   }
   | VarDecl {
-    auto var_decl = unique_ptr<BaseAST>($1);
+    auto var_decl = $1;
     $$ = new DeclAST(var_decl, DeclAST::Type::VAR);
   }
   ;
 
 VarDecl
-  : BType {
-    global_stack.push(List());
-  } VarDefList ';' {
-     auto btype = unique_ptr<BaseAST>($1);
-     $$ = new VarDeclAST(global_stack.top(), btype);
-    global_stack.pop();
+  : BType VarDefList ';' {
+    auto btype = $1;
+    auto var_def_list = $2;
+    $$ = new VarDeclAST(*var_def_list, btype);
   }
   ;
+
 VarDefList
   : VarDefList ',' VarDef {
-    auto var_def = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::VARDEF, std::move(var_def));
+    $$ = $1;
+    $$->emplace_back(ListType::VARDEF, $3);
   }
   | VarDef {
-    auto var_def = unique_ptr<BaseAST>($1);
-    global_stack.top().emplace_back(ListType::VARDEF, std::move(var_def));
+    $$ = new List();
+    $$->emplace_back(ListType::VARDEF, $1);
   }
   ;
 
-ConstDecl 
-  : CONST BType {
-    global_stack.push(List());
-  } ConstDefList ';' {
-    auto btype = unique_ptr<BaseAST>($2);
-    $$ = new ConstDeclAST(global_stack.top(), btype);
-    global_stack.pop();
+ConstDecl
+  : CONST BType ConstDefList ';' {
+    auto btype = $2;
+    auto const_def_list = $3;
+    $$ = new ConstDeclAST(*const_def_list, btype);
   }
   ;
 
 ConstDefList
   : ConstDefList ',' ConstDef {
-    auto const_def = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::CONSTDEF, std::move(const_def));
+    $$ = $1;
+    $$->emplace_back(ListType::CONSTDEF, $3);
   }
   | ConstDef {
-    auto const_def = unique_ptr<BaseAST>($1);
-    global_stack.top().emplace_back(ListType::CONSTDEF, std::move(const_def));
+    $$ = new List();
+    $$->emplace_back(ListType::CONSTDEF, $1);
   }
-
-
+  ;
 
 ConstDef
-  : IDENT {
-    global_stack.push(List());
-  } ConstExpList '=' ConstInitVal {
-    auto ident = *unique_ptr<string>($1);
-    auto const_init_val = unique_ptr<BaseAST>($5);
-    $$ = new ConstDefAST(ident, global_stack.top(), const_init_val);
-    global_stack.pop();
+  : IDENT '=' ConstInitVal {
+    auto ident = Symbol($1);
+    auto const_exp_list = List();
+    auto const_init_val = $3;
+    $$ = new ConstDefAST(ident, const_exp_list, const_init_val);
+  }
+  | IDENT ConstDims '=' ConstInitVal {
+    auto ident = Symbol($1);
+    auto const_exp_list = $2;
+    auto const_init_val = $4;
+    $$ = new ConstDefAST(ident, *const_exp_list, const_init_val);
   }
   ;
 
-  
-
 VarDef
   : IDENT {
-    global_stack.push(List());
-  } ConstExpList {
-    auto ident = *unique_ptr<string>($1);
-    $$ = new VarDefAST(ident, global_stack.top());
-    global_stack.pop();
+    auto ident = Symbol($1);
+    auto const_exp_list = List();
+    $$ = new VarDefAST(ident, const_exp_list);
+  }
+  | IDENT ConstDims {
+    auto ident = Symbol($1);
+    auto const_exp_list = $2;
+    $$ = new VarDefAST(ident, *const_exp_list);
+  }
+  | IDENT '=' InitVal {
+    auto ident = Symbol($1);
+    auto const_exp_list = List();
+    auto init_val = $3;
+    $$ = new VarDefAST(ident, const_exp_list, init_val);
   }
-  | IDENT {
-    global_stack.push(List());
-  } ConstExpList '=' InitVal {
-    auto ident = *unique_ptr<string>($1);
-    auto init_val = unique_ptr<BaseAST>($5);
-    $$ = new VarDefAST(ident, global_stack.top(), init_val);
-    global_stack.pop();
+  | IDENT ConstDims '=' InitVal {
+    auto ident = Symbol($1);
+    auto const_exp_list = $2;
+    auto init_val = $4;
+    $$ = new VarDefAST(ident, *const_exp_list, init_val);
   }
   ;
 
-ConstExpList
-  : %empty
-  | ConstExpList '[' ConstExp ']' {
-    auto const_exp = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::CONSTEXP, std::move(const_exp));
+// 数组定义和数组形参中的各维长度: {"[" ConstExp "]"}, 至少一维
+ConstDims
+  : '[' ConstExp ']' {
+    $$ = new List();
+    $$->emplace_back(ListType::CONSTEXP, $2);
+  }
+  | ConstDims '[' ConstExp ']' {
+    $$ = $1;
+    $$->emplace_back(ListType::CONSTEXP, $3);
   }
   ;
 
 ConstInitVal
   : ConstExp {
-    auto const_exp = unique_ptr<BaseAST>($1);
+    auto const_exp = $1;
     $$ = new ConstInitValAST(const_exp);
   }
   | '{' '}' {
     auto const_init_val_list = List();
     $$ = new ConstInitValAST(const_init_val_list);
   }
-  | '{' {
-    global_stack.push(List());
-  } ConstInitValList '}' {
-    $$ = new ConstInitValAST(global_stack.top());
-    global_stack.pop();
+  | '{' ConstInitValList '}' {
+    auto const_init_val_list = $2;
+    $$ = new ConstInitValAST(*const_init_val_list);
   }
   ;
 
 ConstInitValList
   : ConstInitValList ',' ConstInitVal {
-    auto const_init_val = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::CONSTINITVAL, std::move(const_init_val));
+    $$ = $1;
+    $$->emplace_back(ListType::CONSTINITVAL, $3);
   }
   | ConstInitVal {
-    auto const_init_val = unique_ptr<BaseAST>($1);
-    global_stack.top().emplace_back(ListType::CONSTINITVAL, std::move(const_init_val));
+    $$ = new List();
+    $$->emplace_back(ListType::CONSTINITVAL, $1);
   }
   ;
 
 InitVal
   : Exp {
-    auto exp = unique_ptr<BaseAST>($1);
+    auto exp = $1;
     $$ = new InitValAST(exp);
   }
   | '{' '}' {
     auto init_val_list = List();
     $$ = new InitValAST(init_val_list);
   }
-  | '{' {
-    global_stack.push(List());
-  } InitValList '}' {
-    $$ = new InitValAST(global_stack.top());
-    global_stack.pop();
+  | '{' InitValList '}' {
+    auto init_val_list = $2;
+    $$ = new InitValAST(*init_val_list);
   }
+  ;
 
 InitValList
   : InitValList ',' InitVal {
-    auto init_val = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::INITVAL, std::move(init_val));
+    $$ = $1;
+    $$->emplace_back(ListType::INITVAL, $3);
   }
   | InitVal {
-    auto init_val = unique_ptr<BaseAST>($1);
-    global_stack.top().emplace_back(ListType::INITVAL, std::move(init_val));
+    $$ = new List();
+    $$->emplace_back(ListType::INITVAL, $1);
   }
   ;
 
 LVal
   : IDENT {
-    global_stack.push(List());
-  } ArrayExpList {
-    auto ident = *unique_ptr<string>($1);
-    $$ = new LValAST(ident, global_stack.top());
-    global_stack.pop();
+    auto ident = Symbol($1);
+    auto exp_list = List();
+    $$ = new LValAST(ident, exp_list);
+  }
+  | IDENT ExpDims {
+    auto ident = Symbol($1);
+    auto exp_list = $2;
+    $$ = new LValAST(ident, *exp_list);
   }
   ;
 
-ArrayExpList
-  : %empty
-  | ArrayExpList '[' Exp ']' {
-    auto exp = unique_ptr<BaseAST>($3);
-    global_stack.top().emplace_back(ListType::EXP, std::move(exp));
+// 数组访问的下标: {"[" Exp "]"}, 至少一维
+ExpDims
+  : '[' Exp ']' {
+    $$ = new List();
+    $$->emplace_back(ListType::EXP, $2);
+  }
+  | ExpDims '[' Exp ']' {
+    $$ = $1;
+    $$->emplace_back(ListType::EXP, $3);
   }
   ;
 
 ConstExp
   : Exp {
-    auto exp = unique_ptr<BaseAST>($1);
-    $$ = new ConstExpAST(exp);
+    $$ = $1;
   }
   ;
 %%
 
 // 定义错误处理函数, 其中第二个参数是错误信息
 // parser 如果发生错误 (例如输入的程序出现了语法错误), 就会调用这个函数
-/* void yyerror(unique_ptr<BaseAST> &ast, const char *s) {
+/* void yyerror(BaseAST *&ast, const char *s) {
   cerr << "error: " << s << endl;
 } */
 
-void yyerror(std::unique_ptr<BaseAST> &ast, const char *s) {
-  
-    extern int yylineno;    // defined and maintained in lex
-    extern char *yytext;    // defined and maintained in lex
-    extern int yycolno;     // defined and maintained in lex
+void yyerror(BaseAST *&ast, const char *s) {
 
     // ANSI颜色代码
     const std::string RED = "\033[31m";     // 设置颜色为红色
@@ -646,8 +620,8 @@ void yyerror(std::unique_ptr<BaseAST> &ast, const char *s) {
     const std::string RESET = "\033[0m";    // 重置颜色
 
     //fprintf(stderr, "ERROR: %s at symbol '%s' on line %d on col %d \n", s, yytext, yylineno1, yycolno);
-    std::cout << RED << "error: " << RESET << "at symbol " << RED << "'" << yytext << "'" << RESET
-              << " on line " << RED << yylineno << ":" << yycolno << RESET << std::endl;
+    std::cout << RED << "error: " << RESET << "at symbol " << RED << "'" << lexer.text() << "'" << RESET
+              << " on line " << RED << lexer.line() << ":" << lexer.col() << RESET << std::endl;
 
 }
 
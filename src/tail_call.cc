@@ -0,0 +1,99 @@
+#include "passes.hh"
+#include <algorithm>
+
+using ir::Op;
+using ir::Operand;
+
+namespace {
+
+// 指针是否指向本函数的栈帧 (局部数组), 这样的实参在尾调用时会失效
+bool points_to_frame(const ir::Function &func, Operand op) {
+  while (op.is_value()) {
+    const auto &inst = func.insts[op.id];
+    if (inst.op == Op::Alloc) return true;
+    if (inst.op != Op::GetElemPtr && inst.op != Op::GetPtr) return false;
+    op = inst.ops[0];
+  }
+  return false;
+}
+
+// 块 b 末尾紧跟 ret 的调用, 返回调用指令, 不是尾调用时返回 -1
+int tail_call_of(const ir::Module &module, const ir::Function &func, int b) {
+  const auto &list = func.blocks[b].insts;
+  if (list.size() < 2) return -1;
+  const auto &ret = func.insts[list.back()];
+  int call = list[list.size() - 2];
+  const auto &inst = func.insts[call];
+  if (ret.op != Op::Ret || inst.op != Op::Call) return -1;
+  // 库函数在外部实现, 只对本文件的函数做尾调用
+  if (module.funcs[inst.callee].is_decl) return -1;
+  if (!ret.ops.empty() && ret.ops[0] != Operand::value(call)) return -1;
+  if (inst.ops.size() > 8) return -1;
+  for (auto &op : inst.ops) {
+    if (points_to_frame(func, op)) return -1;
+  }
+  return call;
+}
+
+} // namespace
+
+bool TailCallElim::run(ir::Module &module) {
+  bool changed = false;
+  for (size_t f = 0; f < module.funcs.size(); ++f) {
+    auto &func = module.funcs[f];
+    if (func.is_decl) continue;
+    std::vector<int> self_calls;
+    for (size_t b = 0; b < func.blocks.size(); ++b) {
+      int call = tail_call_of(module, func, b);
+      if (call < 0) continue;
+      if (func.insts[call].callee == static_cast<int>(f)) {
+        self_calls.push_back(call);
+      } else if (!func.insts[call].tail) {
+        func.insts[call].tail = true;
+        changed = true;
+      }
+    }
+    if (self_calls.empty()) continue;
+    changed = true;
+
+    // 入口块的指令移到新的循环头 loop, 参数改为 loop 中的 phi
+    int loop = func.add_block(func.new_label("tailrec"));
+    std::vector<int> moved;
+    moved.swap(func.blocks[0].insts);
+    for (int id : moved) func.insts[id].block = loop;
+    func.blocks[loop].insts = moved;
+    for (int s : func.blocks[0].succs) {
+      for (int id : func.blocks[s].insts) {
+        if (func.insts[id].op != Op::Phi) break;
+        for (auto &t : func.insts[id].targets) {
+          if (t == 0) t = loop;
+        }
+      }
+    }
+    ir::Inst jump(Op::Jump);
+    jump.targets = {loop};
+    func.append(0, jump);
+    std::vector<int> phis;
+    for (size_t i = 0; i < func.params.size(); ++i) {
+      int phi = func.insert(loop, i, ir::Inst(Op::Phi, func.param_types[i]));
+      func.replace_all_uses(func.params[i], Operand::value(phi));
+      func.add_incoming(phi, Operand::value(func.params[i]), 0);
+      phis.push_back(phi);
+    }
+
+    // 自身的尾调用改为带着新实参跳回循环头
+    for (int call : self_calls) {
+      int b = func.insts[call].block;
+      std::vector<Operand> args = func.insts[call].ops;
+      func.remove_inst(func.terminator(b));
+      func.remove_inst(call);
+      func.append(b, jump);
+      for (size_t i = 0; i < phis.size(); ++i) func.add_incoming(phis[i], args[i], b);
+    }
+
+    std::vector<int> layout = {0, loop};
+    for (size_t b = 1; b + 1 < func.blocks.size(); ++b) layout.push_back(b);
+    func.reorder_blocks(layout);
+  }
+  return changed;
+}
@@ -0,0 +1,25 @@
+// const 全局数组在任何优化级别下都放进 .rodata (对它的写入会触发段错误),
+// 通过数组参数和库函数读取它, 常量下标的读取可以折叠为初值
+const int table[2][4] = {{1, 2, 3, 4}, {5, 6, 7, 8}};
+int counts[4];
+
+int sum_row(int row[]) {
+  int i = 0, s = 0;
+  while (i < 4) {
+    s = s + row[i];
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  int r = 0;
+  while (r < 2) {
+    counts[r] = sum_row(table[r]);
+    r = r + 1;
+  }
+  putarray(4, table[1]);
+  putint(counts[0] * 100 + counts[1] + table[1][2]);
+  putch(10);
+  return table[0][3];
+}
@@ -0,0 +1,21 @@
+// 强度削减把 a[i] 改写成指针 phi 之后, GVN 必须知道它指向 a:
+// 通过它的 store 要让缓存的 a[3] 失效, 否则循环中读到的是旧值
+int main() {
+  int a[10];
+  int i = 0;
+  while (i < 10) {
+    a[i] = i;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < 10) {
+    int x = a[3];
+    a[i] = x + 100;
+    s = s + a[3];
+    i = i + 1;
+  }
+  putint(s);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,44 @@
+// 叶函数没有 ra 槽, callee-saved 寄存器必须紧贴栈帧顶部保存,
+// 否则最低的那个会压在局部数组 a[3] 上. leaf 被调用两次以免被内联
+int leaf(int n) {
+  int a[4];
+  a[0] = n; a[1] = n + 1; a[2] = n + 2; a[3] = n + 3;
+  int v0 = n * 3;
+  int v1 = n * 5;
+  int v2 = n * 7;
+  int v3 = n * 9;
+  int v4 = n * 11;
+  int v5 = n * 13;
+  int v6 = n * 15;
+  int v7 = n * 17;
+  int v8 = n * 19;
+  int i = 0;
+  while (i < n) {
+    v0 = v0 + v1 * a[(i + 0) % 4];
+    v1 = v1 + v2 * a[(i + 1) % 4];
+    v2 = v2 + v3 * a[(i + 2) % 4];
+    v3 = v3 + v4 * a[(i + 3) % 4];
+    v4 = v4 + v5 * a[(i + 4) % 4];
+    v5 = v5 + v6 * a[(i + 5) % 4];
+    v6 = v6 + v7 * a[(i + 6) % 4];
+    v7 = v7 + v8 * a[(i + 7) % 4];
+    v8 = v8 + v0 * a[(i + 8) % 4];
+    a[i % 4] = a[(i + 3) % 4] + v0 % 7;
+    i = i + 1;
+  }
+  return v0 + v1 + v2 + v3 + v4 + v5 + v6 + v7 + v8 + a[0] + a[1] + a[2] + a[3];
+}
+
+int main() {
+  int s = 0, t = 1, i = 0;
+  int u0 = 3, u1 = 5, u2 = 7, u3 = 9, u4 = 11, u5 = 13, u6 = 15, u7 = 17, u8 = 19, u9 = 21, u10 = 23, u11 = 25;
+  while (i < 10) {
+    s = s + leaf(i) % 1000 + leaf(i + 1) % 7;
+    t = t * 3 % 10007 + u0 + u1 + u2 + u3 + u4 + u5 + u6 + u7 + u8 + u9 + u10 + u11;
+    u0 = u0 + 1; u1 = u1 + u0; u2 = u2 + u1; u3 = u3 + u2; u4 = u4 + u3; u5 = u5 + u4;
+    u6 = u6 + u5; u7 = u7 + u6; u8 = u8 + u7; u9 = u9 + u8; u10 = u10 + u9; u11 = u11 + u10;
+    i = i + 1;
+  }
+  putint(s); putch(32); putint(t % 10007); putch(10);
+  return 0;
+}
@@ -0,0 +1,53 @@
+#!/bin/bash
+# 回归测试: 按每种模式编译 tests 下的 SysY 程序, 链接 libsysy 后在 qemu 中运行,
+# 比较标准输出和返回值 (name.out 的最后一行是返回值, 与课程测试用例的格式相同)
+# name.gen 是生成 SysY 程序的脚本, 用于过大不便直接放进仓库的压力测试
+# 每次编译限制 2 GiB 虚拟内存 (包括编译线程预留的 1 GiB 栈) 和 60 秒
+# 用法: tests/run.sh [compiler], 需要 compiler-dev 镜像中的 clang, ld.lld 和 qemu-riscv32-static
+
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+COMPILER=${1:-$TEST_DIR/../build/compiler}
+MODES=("-riscv -O0" "-riscv" "-perf")
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+for gen in "$TEST_DIR"/*.gen; do
+  [ -f "$gen" ] && "$gen" > "$WORK/$(basename "$gen" .gen).c"
+done
+
+pass=0
+fail=0
+for src in "$TEST_DIR"/*.c "$WORK"/*.c; do
+  [ -f "$src" ] || continue
+  name=$(basename "$src" .c)
+  input=/dev/null
+  [ -f "$TEST_DIR/$name.in" ] && input=$TEST_DIR/$name.in
+  for mode in "${MODES[@]}"; do
+    asm=$WORK/$name.S
+    exe=$WORK/$name
+    if ! (ulimit -v 2097152 && timeout 60 $COMPILER $mode "$src" -o "$asm") ||
+       ! clang "$asm" -c -o "$exe.o" -target riscv32-unknown-linux-elf -march=rv32im -mabi=ilp32 ||
+       ! ld.lld "$exe.o" -L"$CDE_LIBRARY_PATH/riscv32" -lsysy -o "$exe"; then
+      echo "FAIL $name ($mode): build"
+      fail=$((fail + 1))
+      continue
+    fi
+    qemu-riscv32-static "$exe" < "$input" > "$WORK/$name.stdout"
+    code=$?
+    {
+      cat "$WORK/$name.stdout"
+      [ -s "$WORK/$name.stdout" ] && [ "$(tail -c 1 "$WORK/$name.stdout")" != "" ] && echo
+      echo "$code"
+    } > "$WORK/$name.actual"
+    if cmp -s "$WORK/$name.actual" "$TEST_DIR/$name.out"; then
+      pass=$((pass + 1))
+    else
+      echo "FAIL $name ($mode): output"
+      diff "$TEST_DIR/$name.out" "$WORK/$name.actual" | head -5
+      fail=$((fail + 1))
+    fi
+  done
+done
+echo "passed $pass, failed $fail"
+[ "$fail" -eq 0 ]